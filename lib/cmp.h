@@ -37,8 +37,8 @@
 
 /* ====== Version Information ====== */
 #define CMP_VERSION_MAJOR   0 /**< major part of the version ID */
-#define CMP_VERSION_MINOR   7 /**< minor part of the version ID */
-#define CMP_VERSION_RELEASE 2 /**< release part of the version ID */
+#define CMP_VERSION_MINOR   9 /**< minor part of the version ID */
+#define CMP_VERSION_RELEASE 0 /**< release part of the version ID */
 
 /**
  * @brief Complete version number
@@ -62,12 +62,33 @@
  */
 
 enum cmp_preprocessing {
-	CMP_PREPROCESS_NONE, /**< No preprocessing is applied to the data */
-	CMP_PREPROCESS_DIFF, /**< Differences between neighbouring values are computed */
-	CMP_PREPROCESS_IWT,  /**< Integer Wavelet Transform preprocessing */
-	CMP_PREPROCESS_MODEL /**< Subtracts a model based on previously compressed data,
-			      *   only allowed as a secondary preprocessing step
-			      */
+	CMP_PREPROCESS_NONE,   /**< No preprocessing is applied to the data */
+	CMP_PREPROCESS_DIFF,   /**< Differences between neighbouring values are computed */
+	CMP_PREPROCESS_IWT,    /**< Integer Wavelet Transform preprocessing */
+	CMP_PREPROCESS_MODEL,  /**< Subtracts a model based on previously compressed data,
+				*   only allowed as a secondary preprocessing step
+				*/
+	CMP_PREPROCESS_MED,    /**< Median edge detector (LOCO-I) prediction from the left,
+				*   upper and upper-left neighbours of a 2D frame
+				*/
+	CMP_PREPROCESS_IWT_2D, /**< Separable Integer Wavelet Transform over the rows and
+				*   columns of a 2D frame
+				*/
+	CMP_PREPROCESS_FIXED   /**< Fixed polynomial predictor of order 0 to 3 (see
+				*   fixed_order)
+				*/
+};
+
+
+/**
+ * @brief Available wavelet kernels for the integer wavelet transforms
+ */
+
+enum cmp_wavelet {
+	CMP_WAVELET_5_3,  /**< LeGall 5/3 lifting (default) */
+	CMP_WAVELET_HAAR, /**< Haar/S-transform; fastest, weakest decorrelation */
+	CMP_WAVELET_2_6,  /**< 2/6 (TS) transform; S-transform with a refined detail step */
+	CMP_WAVELET_9_7_M /**< 9/7-M integer approximation of the CDF 9/7 wavelet; best ratio */
 };
 
 
@@ -78,10 +99,61 @@ enum cmp_preprocessing {
 enum cmp_encoder_type {
 	CMP_ENCODER_UNCOMPRESSED, /**< Uncompressed mode */
 	CMP_ENCODER_GOLOMB_ZERO,  /**< Golomb encoder with zero escape mechanism */
-	CMP_ENCODER_GOLOMB_MULTI  /**< Golomb encoder with multi escape mechanism */
+	CMP_ENCODER_GOLOMB_MULTI, /**< Golomb encoder with multi escape mechanism */
+	CMP_ENCODER_BLOCK_RICE,   /**< Block adaptive Rice encoder; the encoder parameter
+				   *   is the block size in samples (1 to 64)
+				   */
+	CMP_ENCODER_ADAPTIVE_RICE, /**< Backward adaptive Rice encoder (LOCO-I style); the
+				    *   encoder parameter is the number of samples after
+				    *   which the adaptation statistics are halved (2 to 65535)
+				    */
+	CMP_ENCODER_PFOR,         /**< Patched frame-of-reference bit-packing encoder; the
+				   *   encoder parameter is the block size in samples
+				   *   (1 to 128)
+				   */
+	CMP_ENCODER_RANS,         /**< Interleaved rANS encoder with a static per-frame
+				   *   model; the encoder parameter is the number of
+				   *   interleaved states (1 to 8)
+				   */
+	CMP_ENCODER_EXP_GOLOMB    /**< Order-k Exponential-Golomb encoder without an
+				   *   escape mechanism; the encoder parameter is the
+				   *   order k (0 to 15)
+				   */
 };
 
 
+/**
+ * @brief Encoder parameter value to select the Golomb parameter automatically
+ *
+ * When used as primary_encoder_param or secondary_encoder_param with a Golomb
+ * encoder, the Golomb parameter is chosen for every compressed frame from the
+ * statistics of its preprocessed data. The chosen value is stored in the
+ * encoder_param field of the compression header.
+ */
+
+#define CMP_ENCODER_PARAM_AUTO UINT32_MAX
+
+
+/** Highest order of the CMP_PREPROCESS_FIXED predictor */
+#define CMP_FIXED_ORDER_MAX 3
+
+
+/**
+ * @brief Predictor order value to select the CMP_PREPROCESS_FIXED order
+ *	automatically
+ *
+ * The order with the smallest sum of residual magnitudes is chosen for every
+ * compressed frame. The chosen order is stored in the preprocess_param field
+ * of the compression header.
+ */
+
+#define CMP_FIXED_ORDER_AUTO UINT32_MAX
+
+
+/** Largest number of frames in a temporal wavelet group */
+#define CMP_TEMPORAL_GROUP_MAX 8
+
+
 /**
  * @brief Compression parameters
  *
@@ -97,7 +169,7 @@ struct cmp_params {
 	 */
 	enum cmp_preprocessing primary_preprocessing; /**< Preprocessing for the first pass */
 	enum cmp_encoder_type primary_encoder_type;   /**< Encoder used in the first pass */
-	uint32_t primary_encoder_param;               /**< Parameter for the primary encoder */
+	uint32_t primary_encoder_param; /**< Parameter for the primary encoder or CMP_ENCODER_PARAM_AUTO */
 	uint32_t primary_encoder_outlier; /**< Primary outlier parameter for CMP_ENCODER_GOLOMB_MULTI */
 
 	/*
@@ -106,13 +178,32 @@ struct cmp_params {
 	uint32_t secondary_iterations;                  /**< Max secondary passes (0 = disabled) */
 	enum cmp_preprocessing secondary_preprocessing; /**< Preprocessing for secondary passes */
 	enum cmp_encoder_type secondary_encoder_type;   /**< Encoder for secondary passes */
-	uint32_t secondary_encoder_param;               /**< Parameter for the secondary encoder */
+	uint32_t secondary_encoder_param; /**< Parameter for the secondary encoder or CMP_ENCODER_PARAM_AUTO */
 	uint32_t secondary_encoder_outlier; /**< Secondary outlier parameter for CMP_ENCODER_GOLOMB_MULTI */
 	uint32_t model_rate; /**< Model adaptation rate (used with CMP_PREPROCESS_MODEL) */
+	enum cmp_wavelet wavelet; /**< Wavelet kernel (used with CMP_PREPROCESS_IWT and _IWT_2D) */
+	uint32_t fixed_order; /**< Predictor order (used with CMP_PREPROCESS_FIXED) or CMP_FIXED_ORDER_AUTO */
+	uint32_t near_lossless_delta; /**< Maximum absolute error per sample (with CMP_PREPROCESS_NONE, _DIFF and _MODEL only), 0 = lossless */
+
+	/* Sample Format */
+	uint32_t n_bits; /**< Significant bits per sample (e.g. 12 or 14 for ADC data); 0 = all 16 bits */
+
+	/* Frame Geometry */
+	uint32_t width; /**< Row width of 2D frames in samples (used with CMP_PREPROCESS_MED and _IWT_2D), 0 = single row */
+
+	/* Temporal Decomposition */
+	uint32_t temporal_group_size; /**< Frames per group for cmp_compress_group(): 2, 4 or 8; 0 = disabled */
+	enum cmp_wavelet temporal_wavelet; /**< Wavelet kernel along the time axis (used with cmp_compress_group()) */
+
+	/* Packetized Output */
+	uint32_t packet_size; /**< Split the encoded data into independently decodable packets of this size in bytes (with CMP_PREPROCESS_NONE and _DIFF only), 0 = disabled */
 
 	/* Additional Options */
 	uint8_t checksum_enabled; /**< Enable checksum generation of original data if non-zero */
 	uint8_t uncompressed_fallback_enabled; /**< Fall back to uncompressed storage if compression is ineffective */
+	uint8_t zero_run_enabled; /**< Run-length code runs of zero residuals with the Golomb and Exp-Golomb encoders if non-zero */
+	uint8_t four_streams_enabled; /**< Split the encoded data into four interleaved, independently decodable streams if non-zero */
+	uint8_t compact_header_enabled; /**< Write a compact header holding only the frame-dependent fields if all other fields match the last full header of the sequence */
 };
 
 
@@ -134,6 +225,19 @@ struct cmp_context {
 	uint32_t model_size;      /**< Size of the model used in the model-based preprocessing */
 	uint32_t identifier;      /**< Identifier for the compression model */
 	uint8_t sequence_number; /**< Number of compression passes performed since the last reset */
+	uint8_t sequence_hdr[CMP_HDR_SIZE]; /**< Last full header of the sequence, reference of compact headers */
+};
+
+
+/**
+ * @brief Data type of the original uncompressed data
+ */
+
+enum cmp_type {
+	CMP_I16,         /**< Signed 16-bit integers */
+	CMP_I16_IN_I32,  /**< Signed 16-bit integers packed in 32-bit words */
+	CMP_U16,         /**< Unsigned 16-bit integers */
+	CMP_2xI16_IN_I32 /**< Two channels of signed 16-bit integers packed in 32-bit words */
 };
 
 
@@ -154,7 +258,11 @@ unsigned int cmp_is_error(uint32_t code);
  *
  * In this scenario the input data are not compressible. This function is
  * primarily useful for memory allocation purposes (destination buffer size).
- * Assumes a worst case configuration.
+ * Assumes a worst case configuration, including the channel table and the
+ * channel padding of CMP_2xI16_IN_I32 data.
+ *
+ * @note Packetized frames (packet_size) can be larger; use
+ *	cmp_compress_bound_params() for them.
  *
  * @param packed_size	packed size of the data in bytes (same as src_size,
  *			except for cmp_compress_i16_in_i32() where it's half)
@@ -167,6 +275,26 @@ unsigned int cmp_is_error(uint32_t code);
 uint32_t cmp_compress_bound(uint32_t packed_size);
 
 
+/**
+ * @brief Get the maximum compressed size in a worst-case scenario for the
+ *	given compression parameters
+ *
+ * Same as cmp_compress_bound(), but also covers packetized frames, where
+ * every packet of packet_size bytes holds at least one sample.
+ *
+ * @param params	pointer to the compression parameters used to compress
+ *			the data
+ * @param packed_size	packed size of the data in bytes (same as src_size,
+ *			except for cmp_compress_i16_in_i32() where it's half)
+ *
+ * @returns the compressed size in the worst-case scenario or an error if the
+ *	bound size is larger than the maximum compressed size
+ *	(CMP_HDR_MAX_COMPRESSED_SIZE), which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_bound_params(const struct cmp_params *params, uint32_t packed_size);
+
+
 /**
  * @brief Calculate the maximum buffer size required for uncompressed storage
  *
@@ -251,7 +379,8 @@ uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params
  *			8-byte aligned
  * @param dst_capacity	size of the dst buffer; may be any size, but
  *			cmp_compress_bound(src_size) is guaranteed to be large
- *			enough
+ *			enough (cmp_compress_bound_params(params, src_size)
+ *			with packetized output)
  * @param src		pointer to the data to compress
  * @param src_size	size of the data to compress, must be the same for every
  *			source buffer until the context is reset
@@ -279,6 +408,121 @@ uint32_t cmp_compress_i16_in_i32(struct cmp_context *ctx, void *dst, uint32_t ds
 				 const int32_t *src, uint32_t src_size);
 
 
+/**
+ * @brief Compresses two channels of 16-bit signed data packed in 32-bit words
+ *
+ * Same as cmp_compress_i16_in_i32() but both halves of each 32-bit word are
+ * compressed as two independent channels in a single call: channel 0 holds the
+ * lower and channel 1 the upper 16 bits. Every channel has its own
+ * preprocessing state and model in its half of the working buffer and is
+ * written as an own byte-aligned sub-stream, channel 0 first.
+ *
+ * @note The channels share the compression parameters; the configured frame
+ *	width is the width of a channel. The packed size of the data is the
+ *	same as src_size.
+ */
+
+uint32_t cmp_compress_2xi16_in_i32(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   const int32_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses sample elements spaced at a fixed byte distance
+ *
+ * Compresses one channel of an interleaved multi-channel buffer in place,
+ * without copying it out first. The element i is read from
+ * base + byte_offset + i * byte_stride; the result is the same as compressing
+ * a contiguous copy of the elements with the cmp_compress_*() function of
+ * the dtype.
+ *
+ * @param ctx		pointer to a compression context
+ * @param dst		the buffer to compress the data into, MUST be 8-byte
+ *			aligned
+ * @param dst_capacity	size of the dst buffer; see cmp_compress_i16()
+ * @param base		pointer to the interleaved buffer
+ * @param n_samples	number of elements to compress (16-bit samples for
+ *			CMP_I16 and CMP_U16, 32-bit words otherwise)
+ * @param byte_stride	distance between two elements in bytes; a multiple
+ *			of the element size
+ * @param byte_offset	offset of the first element from base in bytes; the
+ *			first element has to be aligned to its size
+ * @param dtype		type of the elements
+ *
+ * @returns the size of the compressed data or an error, which can be checked
+ *	using cmp_is_error()
+ */
+
+uint32_t cmp_compress_strided(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			      const void *base, uint32_t n_samples, uint32_t byte_stride,
+			      uint32_t byte_offset, enum cmp_type dtype);
+
+
+/**
+ * @brief Part of a frame held in a non-contiguous buffer
+ */
+
+struct cmp_segment {
+	const void *data; /**< Pointer to the samples of the segment, aligned to the sample size */
+	uint32_t size;    /**< Size of the segment in bytes; a multiple of the sample size */
+};
+
+
+/**
+ * @brief Compresses a 16-bit signed data frame made of non-contiguous segments
+ *
+ * Same as cmp_compress_i16() but the frame is gathered from an array of
+ * segments, e.g. per-row or per-DMA-descriptor buffers, without assembling it
+ * into a contiguous buffer first. The result, including the checksum, is the
+ * same as compressing the concatenated segments.
+ *
+ * @param ctx		pointer to a compression context
+ * @param dst		the buffer to compress the data into, MUST be 8-byte
+ *			aligned
+ * @param dst_capacity	size of the dst buffer; see cmp_compress_i16()
+ * @param segments	array of segments in frame order; empty segments are
+ *			skipped
+ * @param n_segments	number of segments
+ *
+ * @returns the size of the compressed data or an error, which can be checked
+ *	using cmp_is_error()
+ */
+
+uint32_t cmp_compress_i16v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			   const struct cmp_segment *segments, uint32_t n_segments);
+
+
+/**
+ * @brief Compresses a frame of 16-bit signed data packed in 32-bit words made
+ *	of non-contiguous segments
+ *
+ * Same as cmp_compress_i16v() but for the data of cmp_compress_i16_in_i32().
+ */
+
+uint32_t cmp_compress_i16_in_i32v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				  const struct cmp_segment *segments, uint32_t n_segments);
+
+
+/**
+ * @brief Compresses a dual-channel frame made of non-contiguous segments
+ *
+ * Same as cmp_compress_i16v() but for the data of cmp_compress_2xi16_in_i32().
+ */
+
+uint32_t cmp_compress_2xi16_in_i32v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				    const struct cmp_segment *segments, uint32_t n_segments);
+
+
+/**
+ * @brief Compresses an unsigned 16-bit data frame made of non-contiguous
+ *	segments
+ *
+ * Same as cmp_compress_i16v() but for uint16_t data.
+ */
+
+uint32_t cmp_compress_u16v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			   const struct cmp_segment *segments, uint32_t n_segments);
+
+
 /**
  * @brief Compresses an unsigned 16-bit data buffer
  *
@@ -289,6 +533,175 @@ uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capac
 			  const uint16_t *src, uint32_t src_size);
 
 
+/**
+ * @brief Destination receiving the compressed data chunk by chunk
+ */
+
+struct cmp_sink {
+	/**
+	 * Called with the next bytes of the compressed data whenever the chunk
+	 * buffer is full and once with the rest at the end of the frame; a
+	 * non-zero return value aborts the compression with CMP_ERR_DST_SINK
+	 */
+	int (*write)(void *opaque, const void *data, uint32_t size);
+	void *opaque;      /**< Passed unchanged to write() */
+	void *buf;         /**< Chunk buffer, MUST be 8-byte aligned */
+	uint32_t buf_size; /**< Size of the chunk buffer; a multiple of 8 */
+};
+
+
+/**
+ * Minimum size of the header buffer of cmp_compress_sink(); the stream table
+ * is larger than the channel table
+ */
+
+#define CMP_SINK_HDR_BUF_SIZE (CMP_HDR_SIZE + CMP_STREAM_TABLE_SIZE)
+
+
+/**
+ * @brief Compresses a data buffer passing the compressed data to a sink
+ *
+ * Instead of one dst buffer holding the whole frame, the frame is split into
+ * a small head, written into hdr_buf after the rest is known, and the data
+ * following it, which are passed chunk by chunk to the sink. The head holds
+ * the compression header and, for the four-stream and dual-channel layouts,
+ * the stream or channel table; the head followed by the data passed to the
+ * sink is the same frame the other compression functions produce.
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise()
+ * @param hdr_buf	buffer for the head of the frame, MUST be 8-byte aligned
+ * @param hdr_buf_size	size of hdr_buf; MUST be at least CMP_SINK_HDR_BUF_SIZE
+ * @param hdr_size	pointer where the size of the head is stored; may be
+ *			NULL
+ * @param sink		sink receiving the data following the head
+ * @param src		pointer to the data to compress
+ * @param src_size	size of the data to compress
+ * @param src_type	type of the data
+ *
+ * @note With the uncompressed fallback enabled, the data are analysed with
+ *	cmp_estimate_size() first, as data passed to the sink can not be
+ *	taken back.
+ *
+ * @returns the size of the compressed frame, the head included, or an error,
+ *	which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_sink(struct cmp_context *ctx, void *hdr_buf, uint32_t hdr_buf_size,
+			   uint32_t *hdr_size, const struct cmp_sink *sink, const void *src,
+			   uint32_t src_size, enum cmp_type src_type);
+
+
+/**
+ * @brief Compresses a group of frames with a temporal wavelet decomposition
+ *
+ * The src buffer holds temporal_group_size frames of the same size one after
+ * another. Every pixel is transformed along the time axis with the
+ * temporal_wavelet kernel, then every temporal subband is compressed as an own
+ * frame with the configured (spatial) preprocessing and encoder. The frames are
+ * written one after another into dst, the approximation subband first; every
+ * frame starts at an 8-byte aligned offset, the gaps are zero padded. The
+ * temporal fields of the frame headers tell which subband a frame holds.
+ * All subbands are compressed in the same primary or secondary pass and share
+ * the identifier and sequence number, so a group counts as one pass of the
+ * secondary_iterations.
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise() with a
+ *			temporal_group_size of 2 or more
+ * @param dst		the buffer to compress the subbands into, MUST be
+ *			8-byte aligned
+ * @param dst_capacity	size of the dst buffer; temporal_group_size times
+ *			cmp_compress_bound(frame size) rounded up to a
+ *			multiple of 8 is guaranteed to be large enough
+ * @param src		pointer to the frames to compress
+ * @param src_size	size of all frames in bytes
+ * @param src_type	type of the data (CMP_I16 and CMP_I16_IN_I32 frames are
+ *			compressed as CMP_I16 subbands, CMP_U16 frames as
+ *			CMP_U16 subbands; CMP_2xI16_IN_I32 is not supported)
+ *
+ * @note The working buffer needs room for the subbands; its size can be
+ *	calculated with cmp_cal_work_buf_size(params, frame size).
+ *
+ * @returns the size of all compressed frames including the padding or an
+ *	error, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_group(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			    const void *src, uint32_t src_size, enum cmp_type src_type);
+
+
+/**
+ * @brief Compresses a signed 16-bit data buffer to fit into a byte budget
+ *
+ * Uses cmp_estimate_size() to choose the settings of the next compression
+ * pass, so the data are compressed only once:
+ * - the encoder parameter is the configured one, the one selected with
+ *   CMP_ENCODER_PARAM_AUTO or, with a histogram buffer, the Golomb parameter
+ *   (and outlier parameter) around it with the fewest encoded bits, whichever
+ *   gives the smaller output;
+ * - if the output does not fit, the smallest near-lossless delta between the
+ *   configured near_lossless_delta and max_near_lossless_delta is chosen with
+ *   which the output fits.
+ * The chosen settings are stored in the compression header as usual; the
+ * parameters of the context are not changed.
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise()
+ * @param dst		the buffer to compress the src buffer into, MUST be
+ *			8-byte aligned
+ * @param budget	maximum compressed size in bytes; the dst buffer must be
+ *			at least this large
+ * @param src		pointer to the data to compress
+ * @param src_size	size of the data to compress
+ * @param max_near_lossless_delta	largest near-lossless delta that may be
+ *			used; 0 for lossless compression. Larger deltas are
+ *			only used with preprocessing supporting them and a
+ *			working buffer large enough for near-lossless
+ *			preprocessing
+ * @param hist_buf	buffer for searching the Golomb parameters of the
+ *			Golomb encoders, MUST be 4-byte aligned; may be NULL to
+ *			skip the search
+ * @param hist_buf_size	size of hist_buf; MUST be at least CMP_HIST_BUF_SIZE
+ *			if hist_buf is not NULL
+ *
+ * @returns the compressed size or an error, which can be checked using
+ *	cmp_is_error(); CMP_ERR_DST_TOO_SMALL if the data do not fit into the
+ *	budget
+ */
+
+uint32_t cmp_compress_i16_budget(struct cmp_context *ctx, void *dst, uint32_t budget,
+				 const int16_t *src, uint32_t src_size,
+				 uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+				 uint32_t hist_buf_size);
+
+
+/**
+ * @brief Compresses 16-bit signed data packed in 32-bit words to fit into a
+ *	byte budget
+ *
+ * Same as cmp_compress_i16_budget() but for int16_t data packed into int32_t
+ * words.
+ */
+
+uint32_t cmp_compress_i16_in_i32_budget(struct cmp_context *ctx, void *dst, uint32_t budget,
+					const int32_t *src, uint32_t src_size,
+					uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+					uint32_t hist_buf_size);
+
+
+/**
+ * @brief Compresses an unsigned 16-bit data buffer to fit into a byte budget
+ *
+ * Same as cmp_compress_i16_budget() but for uint16_t data.
+ */
+
+uint32_t cmp_compress_u16_budget(struct cmp_context *ctx, void *dst, uint32_t budget,
+				 const uint16_t *src, uint32_t src_size,
+				 uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+				 uint32_t hist_buf_size);
+
+
 /**
  * @brief Resets the compression context
  *
@@ -324,17 +737,6 @@ void cmp_deinitialise(struct cmp_context *ctx);
 
 
 /* ======  Compression Header Functions   ====== */
-/**
- * @brief Data type of the original uncompressed data
- */
-
-enum cmp_type {
-	CMP_I16,        /**< Signed 16-bit integers */
-	CMP_I16_IN_I32, /**< Signed 16-bit integers packed in 32-bit words */
-	CMP_U16         /**< Unsigned 16-bit integers */
-};
-
-
 /**
  * @brief Compression header fields
  *
@@ -355,6 +757,14 @@ struct cmp_hdr {
 	uint32_t encoder_outlier;
 	enum cmp_type original_dtype;
 	uint32_t preprocess_param;
+	uint32_t encoder_flags; /**< CMP_HDR_FLAG_* bits, see cmp_header.h */
+	uint32_t width; /**< Row width of the frame in samples, 0 = single row */
+	uint32_t temporal_levels; /**< log2 of the temporal group size, 0 = no temporal decomposition */
+	enum cmp_wavelet temporal_wavelet; /**< Wavelet kernel along the time axis */
+	uint32_t temporal_index; /**< Temporal subband held by the frame, 0 = approximation */
+	uint32_t near_lossless_delta; /**< Maximum absolute reconstruction error, 0 = lossless */
+	uint32_t n_bits; /**< Significant bits per sample, 0 = all 16 bits */
+	uint32_t packet_size; /**< Size of the packets in bytes, 0 = not packetized */
 };
 
 
@@ -367,6 +777,10 @@ struct cmp_hdr {
  * @param hdr		pointer to header structure to fill
  *
  * @note Only the version field is valid for headers with version 0.6 and earlier.
+ * @note A compact header only holds the compressed and original size, the
+ *	checksum, the sequence number and the temporal index; all other fields
+ *	of hdr are kept, so hdr has to hold the last full header of the
+ *	sequence.
  *
  * @returns the compression header size or an error, which can be checked using
  *	cmp_is_error()
@@ -382,7 +796,9 @@ uint32_t cmp_hdr_deserialize(const void *buf, uint32_t buf_size, struct cmp_hdr
  * @param src		pointer to the original uncompressed data buffer
  * @param src_size	size of the data buffer in bytes
  * @param src_type	type of the data; CMP_I16 and CMP_U16 are treated
- *			identically for checksum purposes
+ *			identically for checksum purposes; the two channels of
+ *			CMP_2xI16_IN_I32 data are hashed word by word, the
+ *			lower half first
  *
  * @returns an error code which can be checked using cmp_is_error()
  */
@@ -391,6 +807,53 @@ uint32_t cmp_hdr_checksum(uint32_t *checksum, const void *src, uint32_t src_size
 			  enum cmp_type src_type);
 
 
+/**
+ * @brief Entry of the chunk index of a chunked container
+ *
+ * See the chunked container layout in cmp_header.h.
+ */
+
+struct cmp_chunk_entry {
+	uint32_t compressed_size; /**< Size of the compressed frame of the chunk in bytes */
+	uint32_t original_size; /**< Size of the uncompressed data of the chunk in bytes */
+};
+
+
+/**
+ * @brief Serialize the chunk index and the trailer of a chunked container
+ *
+ * @param dst		buffer receiving the CMP_CHUNK_INDEX_SIZE(n_chunks)
+ *			bytes following the last frame of the container
+ * @param dst_capacity	size of the dst buffer
+ * @param entries	array with the entries of all chunks in container order
+ * @param n_chunks	number of chunks
+ *
+ * @returns the size of the chunk index including the trailer or an error,
+ *	which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_chunk_index_serialize(void *dst, uint32_t dst_capacity,
+				   const struct cmp_chunk_entry *entries, uint32_t n_chunks);
+
+
+/**
+ * @brief Deserialize the chunk index of a chunked container
+ *
+ * @param buf		buffer holding the end of the container, at least the
+ *			chunk index and the trailer
+ * @param buf_size	size of the buffer
+ * @param entries	array receiving the entries of all chunks; may be NULL
+ *			to query only the number of chunks
+ * @param max_chunks	number of entries the entries array can hold
+ *
+ * @returns the number of chunks or an error, which can be checked using
+ *	cmp_is_error()
+ */
+
+uint32_t cmp_chunk_index_deserialize(const void *buf, uint32_t buf_size,
+				     struct cmp_chunk_entry *entries, uint32_t max_chunks);
+
+
 /**
  * @brief Set the sequence identifier counter
  *
@@ -409,4 +872,92 @@ uint32_t cmp_hdr_checksum(uint32_t *checksum, const void *src, uint32_t src_size
 
 void cmp_hdr_set_identifier(uint32_t identifier);
 
+
+/* ======  Compression Analysis Functions   ====== */
+/**
+ * @brief Calculates the exact compressed size without compressing the data
+ *
+ * Returns the size the next call to a cmp_compress_*() function would return
+ * for the same data, assuming a destination buffer of cmp_compress_bound()
+ * size. No bits are written, which makes this function considerably faster
+ * than a real compression. Useful for parameter studies and capacity planning.
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise()
+ * @param src		pointer to the data to estimate
+ * @param src_size	size of the data in bytes
+ * @param src_type	type of the data (which cmp_compress_*() function would
+ *			be used)
+ *
+ * @note The compression context state (sequence number, model) is not
+ *	changed. The working buffer is used as scratch memory for preprocessing
+ *	steps that need it (e.g. CMP_PREPROCESS_IWT); this happens only when
+ *	the next compression would start a new sequence anyway.
+ *
+ * @returns the compressed size in bytes or an error, which can be checked
+ *	using cmp_is_error()
+ */
+
+uint32_t cmp_estimate_size(const struct cmp_context *ctx, const void *src, uint32_t src_size,
+			   enum cmp_type src_type);
+
+
+/**
+ * @brief Size of the histogram buffer needed by cmp_golomb_costs() in bytes
+ */
+
+#define CMP_HIST_BUF_SIZE (65536UL * sizeof(uint32_t))
+
+
+/**
+ * @brief Compressed sizes for one Golomb parameter
+ */
+
+struct cmp_golomb_cost {
+	uint32_t encoder_param; /**< Evaluated Golomb encoder parameter */
+	uint32_t zero_size;     /**< Compressed size with CMP_ENCODER_GOLOMB_ZERO */
+	uint32_t multi_size;    /**< Compressed size with CMP_ENCODER_GOLOMB_MULTI using multi_outlier */
+	uint32_t multi_outlier; /**< Outlier parameter giving the smallest multi_size */
+};
+
+
+/**
+ * @brief Calculates the exact compressed sizes for a range of Golomb
+ *	parameters in a single pass over the data
+ *
+ * The data are preprocessed once with the preprocessing of the next
+ * compression pass; a histogram of the mapped residuals is then used to
+ * calculate the compressed size for every Golomb parameter in
+ * [param_min, param_max] for CMP_ENCODER_GOLOMB_ZERO and
+ * CMP_ENCODER_GOLOMB_MULTI, including the best outlier parameter for the
+ * latter. This is much faster than compressing the data once per parameter.
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise()
+ * @param src		pointer to the data to analyse
+ * @param src_size	size of the data in bytes
+ * @param src_type	type of the data (which cmp_compress_*() function would
+ *			be used)
+ * @param hist_buf	pointer to a 4-byte aligned buffer for the histogram
+ * @param hist_buf_size	size of the histogram buffer in bytes; must be at
+ *			least CMP_HIST_BUF_SIZE
+ * @param param_min	smallest Golomb parameter to evaluate (>= 1)
+ * @param param_max	largest Golomb parameter to evaluate (<= 65535)
+ * @param costs		array with (param_max - param_min + 1) entries receiving
+ *			the results, ordered by the Golomb parameter
+ *
+ * @note The sizes do not consider the uncompressed fallback. Like
+ *	cmp_estimate_size(), the compression context state is not changed and
+ *	compact headers are taken into account. CMP_2xI16_IN_I32 data and
+ *	contexts with zero-run coding, the four-stream layout or packetized
+ *	output are not supported, as their sizes depend on the order of the
+ *	values.
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_golomb_costs(const struct cmp_context *ctx, const void *src, uint32_t src_size,
+			  enum cmp_type src_type, uint32_t *hist_buf, uint32_t hist_buf_size,
+			  uint32_t param_min, uint32_t param_max, struct cmp_golomb_cost *costs);
+
 #endif /* CMP_H */
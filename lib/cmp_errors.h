@@ -35,10 +35,13 @@ enum cmp_error {
 	CMP_ERR_DST_TOO_SMALL = 30, /**< Destination buffer is too small */
 	CMP_ERR_DST_NULL = 31,      /**< Destination buffer pointer is NULL */
 	CMP_ERR_DST_UNALIGNED = 32, /**< Destination buffer not correct aligned */
+	CMP_ERR_DST_SINK = 33,      /**< Destination sink failed to take the data */
 
-	CMP_ERR_SRC_SIZE_WRONG = 40,    /**< Source buffer size doesn't match expected size */
-	CMP_ERR_SRC_NULL = 41,          /**< Source buffer pointer is NULL */
-	CMP_ERR_SRC_SIZE_MISMATCH = 42, /**< Source data size changed with model preprocessing */
+	CMP_ERR_SRC_SIZE_WRONG = 40,      /**< Source buffer size doesn't match expected size */
+	CMP_ERR_SRC_NULL = 41,            /**< Source buffer pointer is NULL */
+	CMP_ERR_SRC_SIZE_MISMATCH = 42,   /**< Source data size changed with model preprocessing */
+	CMP_ERR_SRC_VALUE_TOO_LARGE = 43, /**< Source sample does not fit into the configured bit depth */
+	CMP_ERR_SRC_UNALIGNED = 44,       /**< Source samples not aligned to their size */
 
 	CMP_ERR_WORK_BUF_TOO_SMALL = 50, /**< Work buffer is too small */
 	CMP_ERR_WORK_BUF_NULL = 51,      /**< Work buffer is NULL but required */
@@ -46,6 +49,7 @@ enum cmp_error {
 
 	CMP_ERR_HDR_CMP_SIZE_TOO_LARGE = 60, /**< Compressed size exceeds header field limit */
 	CMP_ERR_HDR_ORIGINAL_TOO_LARGE = 61, /**< Original size exceeds header field limit */
+	CMP_ERR_HDR_CHUNK_INDEX = 62,        /**< Chunk index of a chunked container is corrupted */
 
 	CMP_ERR_CONTEXT_INVALID = 70,   /**< Invalid compression context */
 
@@ -24,11 +24,19 @@
 #define CMP_HDR_BITS_IDENTIFIER       32
 #define CMP_HDR_BITS_SEQUENCE_NUMBER  8
 #define CMP_HDR_BITS_PREPROCESSING    3
-#define CMP_HDR_BITS_ENCODER_TYPE     2
-#define CMP_HDR_BITS_ORIGINAL_DTYPE   3
+#define CMP_HDR_BITS_ENCODER_TYPE     3
+#define CMP_HDR_BITS_ORIGINAL_DTYPE   2
 #define CMP_HDR_BITS_ENCODER_PARAM    16
 #define CMP_HDR_BITS_ENCODER_OUTLIER  24
 #define CMP_HDR_BITS_PREPROCESS_PARAM 8
+#define CMP_HDR_BITS_ENCODER_FLAGS    8
+#define CMP_HDR_BITS_WIDTH            16
+#define CMP_HDR_BITS_TEMPORAL_LEVELS  2
+#define CMP_HDR_BITS_TEMPORAL_WAVELET 2
+#define CMP_HDR_BITS_TEMPORAL_INDEX   4
+#define CMP_HDR_BITS_NL_DELTA         8
+#define CMP_HDR_BITS_N_BITS           8
+#define CMP_HDR_BITS_PACKET_SIZE      16
 
 
 /*
@@ -44,13 +52,104 @@
 #define CMP_HDR_OFFSET_ENCODER_PARAM    18
 #define CMP_HDR_OFFSET_OUTLIER_PARAM    20
 #define CMP_HDR_OFFSET_PREPROCESS_PARAM 23
+#define CMP_HDR_OFFSET_ENCODER_FLAGS    24
+#define CMP_HDR_OFFSET_WIDTH            25
+#define CMP_HDR_OFFSET_TEMPORAL_FIELDS  27 /* combined: temporal levels, wavelet, subband index */
+#define CMP_HDR_OFFSET_NL_DELTA         28
+#define CMP_HDR_OFFSET_N_BITS           29
+#define CMP_HDR_OFFSET_PACKET_SIZE      30
+
+
+/*
+ * Bits of the encoder flags field
+ */
+#define CMP_HDR_FLAG_ZERO_RUN     0x01 /* runs of zero residuals are run-length coded */
+#define CMP_HDR_FLAG_FOUR_STREAMS 0x02 /* data is split into CMP_NUM_STREAMS streams */
+
+
+/*
+ * Four-stream layout: the header is followed by a stream table holding the
+ * byte sizes of the first CMP_NUM_STREAMS - 1 streams, followed by the
+ * byte-aligned streams; stream j holds the samples j, j + CMP_NUM_STREAMS, ...
+ * The size of the last stream is implied by the compressed size.
+ */
+#define CMP_NUM_STREAMS          4
+#define CMP_HDR_BITS_STREAM_SIZE 24
+#define CMP_STREAM_TABLE_SIZE    ((CMP_NUM_STREAMS - 1) * CMP_HDR_BITS_STREAM_SIZE / 8)
+
+
+/*
+ * Dual-channel layout of CMP_2xI16_IN_I32 data: the header is followed by a
+ * channel table holding the byte size of the first channel, followed by the
+ * byte-aligned channels; channel 0 holds the lower, channel 1 the upper 16 bits
+ * of each 32-bit word. The table is omitted for the uncompressed encoder, where
+ * the channel sizes are implied by the number of samples.
+ */
+#define CMP_NUM_CHANNELS       2
+#define CMP_CHANNEL_TABLE_SIZE ((CMP_NUM_CHANNELS - 1) * CMP_HDR_BITS_STREAM_SIZE / 8)
+
+
+/*
+ * Packetized layout: the header is followed by packets of packet_size bytes.
+ * Every packet starts with a packet header holding the index of its first
+ * sample, its number of samples and the sample preceding its first sample (0
+ * in the first packet), from which the DIFF preprocessing restarts. The
+ * samples follow, encoded with an own copy of the initialised encoder; the rest
+ * of the packet is zero padded. A packet can be decoded with the frame header
+ * alone.
+ */
+#define CMP_PACKET_BITS_INDEX     24
+#define CMP_PACKET_BITS_N_SAMPLES 16
+#define CMP_PACKET_BITS_STATE     16
+#define CMP_PACKET_HDR_SIZE \
+	((CMP_PACKET_BITS_INDEX + CMP_PACKET_BITS_N_SAMPLES + CMP_PACKET_BITS_STATE) / 8)
+#define CMP_PACKET_MAX_SAMPLES ((1UL << CMP_PACKET_BITS_N_SAMPLES) - 1)
+#define CMP_PACKET_MIN_SIZE    (CMP_PACKET_HDR_SIZE + 8) /* room for the largest codeword */
+
+
+/*
+ * Compact header: holds only the fields changing from frame to frame; all
+ * other fields are taken from the last full header of the sequence. It starts
+ * with a byte holding the compact marker, the checksum flag and the temporal
+ * index, followed by the sequence number, the compressed and the original size
+ * as variable-length integers and, if flagged, the checksum. A variable-length
+ * integer is coded in big-endian groups of 7 bits; the MSB of every byte but
+ * the last is set. The compressed size may be padded with leading zero groups.
+ * The first bit of a full header is always 0 as the version number stays below
+ * 2^15.
+ */
+#define CMP_HDR_COMPACT_MARKER        0x80 /* set in the first byte of a compact header */
+#define CMP_HDR_COMPACT_CHECKSUM      0x40 /* the compact header holds a checksum */
+#define CMP_HDR_COMPACT_TEMPORAL_MASK 0x0F /* temporal index bits of the first byte */
+#define CMP_HDR_VARINT_MAX_SIZE       ((CMP_HDR_BITS_COMPRESSED_SIZE + 6) / 7)
+#define CMP_HDR_COMPACT_MAX_SIZE \
+	(2 + 2 * CMP_HDR_VARINT_MAX_SIZE + CMP_HDR_BITS_CHECKSUM / 8)
+
+
+/*
+ * Chunked container for data too large for a single frame: the data are split
+ * into chunks, each compressed into an independent frame starting a new
+ * sequence. The frames are stored back to back, followed by the chunk index
+ * holding the compressed and the original size of every chunk and by the
+ * trailer holding the number of chunks and the container magic. All fields are
+ * 32-bit big-endian integers.
+ */
+#define CMP_CHUNK_MAGIC        0x41495243UL /* "AIRC" */
+#define CMP_CHUNK_ENTRY_SIZE   8
+#define CMP_CHUNK_TRAILER_SIZE 8
+#define CMP_CHUNK_INDEX_SIZE(n_chunks) \
+	((n_chunks) * CMP_CHUNK_ENTRY_SIZE + CMP_CHUNK_TRAILER_SIZE)
 
 
 /*
  * Maximum values that can be stored in the size fields
  */
+#define CMP_HDR_MAX_VERSION         ((1UL << (CMP_HDR_BITS_VERSION - 1)) - 1) /* see compact header */
 #define CMP_HDR_MAX_COMPRESSED_SIZE ((1UL << CMP_HDR_BITS_COMPRESSED_SIZE) - 1)
 #define CMP_HDR_MAX_ORIGINAL_SIZE   ((1UL << CMP_HDR_BITS_ORIGINAL_SIZE) - 1)
+#define CMP_HDR_MAX_WIDTH           ((1UL << CMP_HDR_BITS_WIDTH) - 1)
+#define CMP_HDR_MAX_NL_DELTA        ((1UL << CMP_HDR_BITS_NL_DELTA) - 1)
+#define CMP_HDR_MAX_PACKET_SIZE     ((1UL << CMP_HDR_BITS_PACKET_SIZE) - 1)
 
 
 /** Size of the compression header in bytes */
@@ -59,7 +158,10 @@
 	  CMP_HDR_BITS_CHECKSUM + CMP_HDR_BITS_IDENTIFIER + CMP_HDR_BITS_SEQUENCE_NUMBER +      \
 	  CMP_HDR_BITS_PREPROCESSING + CMP_HDR_BITS_ENCODER_TYPE + CMP_HDR_BITS_ENCODER_PARAM + \
 	  CMP_HDR_BITS_ENCODER_OUTLIER + CMP_HDR_BITS_ORIGINAL_DTYPE +                          \
-	  CMP_HDR_BITS_PREPROCESS_PARAM) /                                                      \
+	  CMP_HDR_BITS_PREPROCESS_PARAM + CMP_HDR_BITS_ENCODER_FLAGS + CMP_HDR_BITS_WIDTH +     \
+	  CMP_HDR_BITS_TEMPORAL_LEVELS + CMP_HDR_BITS_TEMPORAL_WAVELET +                        \
+	  CMP_HDR_BITS_TEMPORAL_INDEX + CMP_HDR_BITS_NL_DELTA + CMP_HDR_BITS_N_BITS +           \
+	  CMP_HDR_BITS_PACKET_SIZE) /                                                           \
 	 8)
 
 #endif /* CMP_HEADER_H */
@@ -13,6 +13,10 @@
  *        error_code = bitstream_write();
  * - Flush remaining bits to the buffer:
  *        bytes_written = bitstream_flush();
+ *
+ * A writer initialised with bitstream_writer_init_sink() passes its buffer to
+ * a sink whenever it is full, so the bitstream can be larger than the buffer;
+ * bitstream_sink_close() flushes it and passes the rest to the sink.
  */
 
 #ifndef CMP_BITSTREAM_WRITER_H
@@ -22,6 +26,7 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "../cmp.h"
 #include "../common/err_private.h"
 #include "../common/byteorder.h"
 
@@ -48,6 +53,8 @@ struct bitstream_writer {
 	uint8_t *ptr;         /**< Current write position */
 	uint8_t *end;         /**< End of the bitstream pointer */
 	uint32_t error;       /**< Sticky error code */
+	const struct cmp_sink *sink; /**< Takes the full buffer; NULL if not used */
+	uint32_t sunk;        /**< Number of bytes passed to the sink */
 };
 
 
@@ -82,6 +89,66 @@ static __inline uint32_t bitstream_writer_init(struct bitstream_writer *bs, void
 }
 
 
+/**
+ * @brief Initializes a bitstream writer passing its data to a sink
+ *
+ * The chunk buffer of the sink is used as bitstream buffer; whenever it is
+ * full, its content is passed to the sink and the buffer is reused.
+ *
+ * @param bs	pointer to an already allocated bitstream_writer structure
+ * @param sink	sink taking the bitstream; its chunk buffer has to be 8-byte
+ *		aligned and its size a multiple of 8
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t bitstream_writer_init_sink(struct bitstream_writer *bs,
+						    const struct cmp_sink *sink)
+{
+	uint32_t ret;
+
+	if (!bs)
+		return CMP_ERROR(INT_BITSTREAM);
+	if (!sink || !sink->write) {
+		memset(bs, 0, sizeof(*bs));
+		return bs->error = CMP_ERROR(DST_NULL);
+	}
+
+	ret = bitstream_writer_init(bs, sink->buf, sink->buf_size);
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (sink->buf_size < 8)
+		return bs->error = CMP_ERROR(DST_TOO_SMALL);
+	if (sink->buf_size % 8)
+		return bs->error = CMP_ERROR(DST_UNALIGNED);
+
+	bs->sink = sink;
+	return ret;
+}
+
+
+/**
+ * @brief Passes the written 64-bit words of the buffer to the sink and
+ *	empties the buffer
+ *
+ * @param bs	pointer to a bitstream_writer initialised with a sink
+ */
+
+static __inline void bitstream_drain(struct bitstream_writer *bs)
+{
+	uint32_t const size = (uint32_t)(bs->ptr - bs->start);
+
+	if (size == 0)
+		return;
+	if (bs->sink->write(bs->sink->opaque, bs->start, size) != 0) {
+		bs->error = CMP_ERROR(DST_SINK);
+		return;
+	}
+	bs->sunk += size;
+	bs->ptr = bs->start;
+}
+
+
 /**
  * @brief Stores a 64-bit integer as big-endian bytes
  *
@@ -164,6 +231,8 @@ static __inline void bitstream_add_bits32(struct bitstream_writer *bs, uint32_t
 	}
 
 	/* Slow path: need to flush cache */
+	if (bs->end - bs->ptr < 8 && bs->sink)
+		bitstream_drain(bs);
 	if (bs->end - bs->ptr >= 8) {
 		bs->cache <<= bs->bit_cap;
 		bs->cache |= value >> (nb_bits - bs->bit_cap);
@@ -172,12 +241,91 @@ static __inline void bitstream_add_bits32(struct bitstream_writer *bs, uint32_t
 		bs->ptr += 8;
 		bs->cache = value;
 		bs->bit_cap += 64 - nb_bits;
-	} else {
+	} else if (!cmp_is_error_int(bs->error)) {
 		bs->error = CMP_ERROR(DST_TOO_SMALL);
 	}
 }
 
 
+/**
+ * @brief Pads the bitstream with zero bits up to the next byte boundary
+ *
+ * @param bs	pointer to an initialised bitstream_writer structure
+ */
+
+static __inline void bitstream_pad_to_byte(struct bitstream_writer *bs)
+{
+	bitstream_add_bits32(bs, 0, bs->bit_cap % 8);
+}
+
+
+/**
+ * @brief Packs the lowest bits of an array of 16-bit values into the bitstream
+ *
+ * Equivalent to calling bitstream_add_bits32() with the lowest nb_bits bits of
+ * every value, but the cache is held in local variables and the capacity is
+ * checked once for the whole array, so the loop does no error checking.
+ *
+ * @note This function uses sticky error handling. Once an error occurs, subsequent
+ *	 calls are ignored. Possible error conditions can be tested with
+ *	 bitstream_error() or bitstream_flush().
+ *
+ * @param bs		pointer to initialized bitstream_writer
+ * @param src		source buffer of values to pack
+ * @param nb_values	number of values to pack
+ * @param nb_bits	number of bits written per value; must be <= 16
+ */
+
+static __inline void bitstream_add_packed_u16_array(struct bitstream_writer *bs,
+						    const uint16_t *src, uint32_t nb_values,
+						    unsigned int nb_bits)
+{
+	uint32_t const mask = (1U << nb_bits) - 1;
+	uint64_t cache;
+	unsigned int bit_cap;
+	uint8_t *ptr;
+	uint32_t i;
+
+	if (cmp_is_error_int(bitstream_error(bs)))
+		return;
+
+	if (nb_bits > 16 || !src) {
+		bs->error = CMP_ERROR(INT_BITSTREAM);
+		return;
+	}
+	if (nb_bits == 0)
+		return;
+
+	/* the slow path handles the end of the buffer and the sink */
+	if ((uint64_t)nb_values * nb_bits / 64 + 1 > (size_t)(bs->end - bs->ptr) / 8) {
+		for (i = 0; i < nb_values; i++)
+			bitstream_add_bits32(bs, src[i] & mask, nb_bits);
+		return;
+	}
+
+	cache = bs->cache;
+	bit_cap = bs->bit_cap;
+	ptr = bs->ptr;
+	for (i = 0; i < nb_values; i++) {
+		uint32_t const value = src[i] & mask;
+
+		if (nb_bits < bit_cap) {
+			cache = (cache << nb_bits) | value;
+			bit_cap -= nb_bits;
+		} else {
+			cache = (cache << bit_cap) | (value >> (nb_bits - bit_cap));
+			put_be64_aligned(ptr, cache);
+			ptr += 8;
+			cache = value;
+			bit_cap += 64 - nb_bits;
+		}
+	}
+	bs->cache = cache;
+	bs->bit_cap = bit_cap;
+	bs->ptr = ptr;
+}
+
+
 /**
  * @brief Write an array of 16-bit values as big-endian to the bitstream
  *
@@ -211,7 +359,13 @@ static __inline void bitstream_add_be16_array(struct bitstream_writer *bs, const
 	}
 
 	if (nb_samples > (size_t)(bs->end - bs->ptr) / sizeof(int16_t)) {
-		bs->error = CMP_ERROR(DST_TOO_SMALL);
+		if (!bs->sink) {
+			bs->error = CMP_ERROR(DST_TOO_SMALL);
+			return;
+		}
+		/* the samples span several sink buffers */
+		for (i = 0; i < nb_samples; i++)
+			bitstream_add_bits32(bs, (uint16_t)src16[i], 16);
 		return;
 	}
 
@@ -277,7 +431,13 @@ static __inline void bitstream_add_be16_in_32_array(struct bitstream_writer *bs,
 	}
 
 	if (nb_samples > (size_t)(bs->end - bs->ptr) / sizeof(int16_t)) {
-		bs->error = CMP_ERROR(DST_TOO_SMALL);
+		if (!bs->sink) {
+			bs->error = CMP_ERROR(DST_TOO_SMALL);
+			return;
+		}
+		/* the samples span several sink buffers */
+		for (i = 0; i < nb_samples; i++)
+			bitstream_add_bits32(bs, (uint16_t)src16_in_32[i], 16);
 		return;
 	}
 
@@ -305,8 +465,8 @@ static __inline void bitstream_add_be16_in_32_array(struct bitstream_writer *bs,
  *
  * @param bs	pointer to a initialised bitstream_writer structure
  *
- * @returns written bytes to bitstream or an error code, which can be checked
- *	using cmp_is_error()
+ * @returns written bytes to bitstream, including the bytes passed to a sink,
+ *	or an error code, which can be checked using cmp_is_error()
  */
 
 static __inline uint32_t bitstream_flush(struct bitstream_writer *bs)
@@ -317,6 +477,12 @@ static __inline uint32_t bitstream_flush(struct bitstream_writer *bs)
 	if (cmp_is_error_int(bitstream_error(bs)))
 		return bitstream_error(bs);
 
+	if (bs->sink && bs->end - bs->ptr < 8) {
+		bitstream_drain(bs);
+		if (cmp_is_error_int(bs->error))
+			return bs->error;
+	}
+
 	cursor = bs->ptr;
 	bytes = (64 - bs->bit_cap + 7) / 8;
 	if (bytes) {
@@ -330,7 +496,7 @@ static __inline uint32_t bitstream_flush(struct bitstream_writer *bs)
 		}
 	}
 
-	return (uint32_t)(cursor - bs->start);
+	return bs->sunk + (uint32_t)(cursor - bs->start);
 }
 
 
@@ -339,8 +505,9 @@ static __inline uint32_t bitstream_flush(struct bitstream_writer *bs)
  *
  * @param bs	pointer to the initialised bitstream_writer structure
  *
- * @returns total bytes effectively written including non-flushed cached bits or
- *	an error code, which can be checked using cmp_is_error()
+ * @returns total bytes effectively written including non-flushed cached bits and
+ *	the bytes passed to a sink or an error code, which can be checked using
+ *	cmp_is_error()
  */
 
 static __inline uint32_t bitstream_size(const struct bitstream_writer *bs)
@@ -348,13 +515,131 @@ static __inline uint32_t bitstream_size(const struct bitstream_writer *bs)
 	if (cmp_is_error_int(bitstream_error(bs)))
 		return bitstream_error(bs);
 
-	return (uint32_t)(bs->ptr - bs->start) + (64 - (uint32_t)bs->bit_cap + 7) / 8;
+	return bs->sunk + (uint32_t)(bs->ptr - bs->start) + (64 - (uint32_t)bs->bit_cap + 7) / 8;
+}
+
+
+/**
+ * @brief Flushes a bitstream writer initialised with a sink and passes the
+ *	rest of the bitstream to the sink
+ *
+ * The last byte may be padded with zeros; no bits must be added afterwards.
+ *
+ * @param bs	pointer to a bitstream_writer initialised with a sink
+ *
+ * @returns the total number of bytes passed to the sink or an error code,
+ *	which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t bitstream_sink_close(struct bitstream_writer *bs)
+{
+	uint32_t const size = bitstream_flush(bs);
+	uint32_t rest;
+
+	if (cmp_is_error_int(size))
+		return size;
+	if (!bs->sink)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
+
+	rest = size - bs->sunk;
+
+	if (rest && bs->sink->write(bs->sink->opaque, bs->start, rest) != 0)
+		return bs->error = CMP_ERROR(DST_SINK);
+	bs->sunk += rest;
+	bs->ptr = bs->start;
+	bs->bit_cap = 64;
+	return size;
+}
+
+
+/**
+ * @brief Splits off the end of the free buffer of a writer into a second
+ *	writer
+ *
+ * The writer keeps writing into the lower part of its buffer, the second
+ * writer into the upper part; bitstream_join() appends the bitstream of the
+ * second writer to the one of the writer again.
+ *
+ * @note Not possible for a bitstream_writer initialised with a sink
+ *
+ * @param bs		pointer to the initialised bitstream_writer structure
+ * @param second	pointer to the bitstream_writer structure to initialise
+ *			for the upper part
+ * @param second_size	minimum size of the upper part in bytes
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t bitstream_split(struct bitstream_writer *bs,
+					 struct bitstream_writer *second, uint32_t second_size)
+{
+	uint8_t *mid;
+	uint32_t ret;
+
+	if (cmp_is_error_int(bitstream_error(bs)))
+		return bitstream_error(bs);
+	if (bs->sink)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
+	if ((size_t)(bs->end - bs->ptr) < second_size)
+		return bs->error = CMP_ERROR(DST_TOO_SMALL);
+
+	/* the upper part has to start 8-byte aligned like the buffer */
+	mid = bs->start + ((size_t)(bs->end - bs->start - second_size) & ~(CMP_DST_ALIGNMENT - 1));
+	if (mid < bs->ptr)
+		return bs->error = CMP_ERROR(DST_TOO_SMALL);
+
+	ret = bitstream_writer_init(second, mid, (uint32_t)(bs->end - mid));
+	if (cmp_is_error_int(ret))
+		return bs->error = ret;
+	bs->end = mid;
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Appends the bitstream of a second writer split off with
+ *	bitstream_split() and takes back its buffer
+ *
+ * @param bs		pointer to the writer, has to be at a byte boundary
+ * @param second	pointer to the split off writer
+ *
+ * @returns the total written size in bytes or an error code, which can be
+ *	checked using cmp_is_error()
+ */
+
+static __inline uint32_t bitstream_join(struct bitstream_writer *bs,
+					struct bitstream_writer *second)
+{
+	uint32_t const size = bitstream_flush(bs);
+	uint32_t const second_size = bitstream_flush(second);
+	uint32_t tail;
+
+	if (cmp_is_error_int(size))
+		return size;
+	if (cmp_is_error_int(second_size))
+		return bs->error = second_size;
+	if (bs->bit_cap % 8 || bs->end != second->start)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
+
+	/* the flush put the cached bytes in front of the place of the data */
+	memmove(bs->start + size, second->start, second_size);
+	bs->end = second->end;
+	bs->ptr = bs->start + ((size + second_size) & ~(CMP_DST_ALIGNMENT - 1));
+
+	/* load the last incomplete word into the cache again */
+	bs->cache = 0;
+	for (tail = 0; bs->ptr + tail < bs->start + size + second_size; tail++)
+		bs->cache = bs->cache << 8 | bs->ptr[tail];
+	bs->bit_cap = 64 - 8 * tail;
+	return size + second_size;
 }
 
 
 /**
  * @brief Reset the bitstream writer to the beginning of its buffer
  *
+ * @note Not possible for a bitstream_writer initialised with a sink
+ *
  * @param bs	pointer to the initialised bitstream_writer structure
  *
  * @returns an error code, which can be checked using cmp_is_error()
@@ -366,6 +651,8 @@ static __inline uint32_t bitstream_rewind(struct bitstream_writer *bs)
 
 	if (cmp_is_error_int(ret))
 		return ret;
+	if (bs->sink)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
 
 	return bitstream_writer_init(bs, bs->start, (uint32_t)(bs->end - bs->start));
 }
@@ -46,6 +46,8 @@ const char *cmp_get_error_string(enum cmp_error code)
 		return "Destination buffer pointer is NULL";
 	case CMP_ERR_DST_UNALIGNED:
 		return "Destination buffer pointer is unaligned";
+	case CMP_ERR_DST_SINK:
+		return "Destination sink failed to take the compressed data";
 
 	case CMP_ERR_SRC_SIZE_WRONG:
 		return "Source buffer size is invalid";
@@ -53,6 +55,10 @@ const char *cmp_get_error_string(enum cmp_error code)
 		return "Source buffer pointer is NULL";
 	case CMP_ERR_SRC_SIZE_MISMATCH:
 		return "Source data size changed using model preprocessing; not allowed until reset";
+	case CMP_ERR_SRC_VALUE_TOO_LARGE:
+		return "Source sample does not fit into the configured number of bits per sample";
+	case CMP_ERR_SRC_UNALIGNED:
+		return "Source samples are not aligned to their size";
 
 	case CMP_ERR_WORK_BUF_TOO_SMALL:
 		return "Work buffer is too small";
@@ -65,6 +71,8 @@ const char *cmp_get_error_string(enum cmp_error code)
 		return "Compressed size exceeds header field limit";
 	case CMP_ERR_HDR_ORIGINAL_TOO_LARGE:
 		return "Original size exceeds header field limit";
+	case CMP_ERR_HDR_CHUNK_INDEX:
+		return "Chunk index of the chunked container is corrupted";
 
 	case CMP_ERR_CONTEXT_INVALID:
 		return "Compression context uninitialised or corrupted";
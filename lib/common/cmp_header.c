@@ -30,6 +30,9 @@ uint32_t cmp_hdr_serialize(struct bitstream_writer *bs, const struct cmp_hdr *hd
 	if (!hdr)
 		return CMP_ERROR(INT_HDR);
 
+	if (hdr->version > CMP_HDR_MAX_VERSION)
+		return CMP_ERROR(INT_HDR);
+
 	if (hdr->compressed_size > CMP_HDR_MAX_COMPRESSED_SIZE)
 		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
 
@@ -54,6 +57,14 @@ uint32_t cmp_hdr_serialize(struct bitstream_writer *bs, const struct cmp_hdr *hd
 	bitstream_add_bits32(bs, hdr->encoder_param, CMP_HDR_BITS_ENCODER_PARAM);
 	bitstream_add_bits32(bs, hdr->encoder_outlier, CMP_HDR_BITS_ENCODER_OUTLIER);
 	bitstream_add_bits32(bs, hdr->preprocess_param, CMP_HDR_BITS_PREPROCESS_PARAM);
+	bitstream_add_bits32(bs, hdr->encoder_flags, CMP_HDR_BITS_ENCODER_FLAGS);
+	bitstream_add_bits32(bs, hdr->width, CMP_HDR_BITS_WIDTH);
+	bitstream_add_bits32(bs, hdr->temporal_levels, CMP_HDR_BITS_TEMPORAL_LEVELS);
+	bitstream_add_bits32(bs, hdr->temporal_wavelet, CMP_HDR_BITS_TEMPORAL_WAVELET);
+	bitstream_add_bits32(bs, hdr->temporal_index, CMP_HDR_BITS_TEMPORAL_INDEX);
+	bitstream_add_bits32(bs, hdr->near_lossless_delta, CMP_HDR_BITS_NL_DELTA);
+	bitstream_add_bits32(bs, hdr->n_bits, CMP_HDR_BITS_N_BITS);
+	bitstream_add_bits32(bs, hdr->packet_size, CMP_HDR_BITS_PACKET_SIZE);
 
 	end_size = bitstream_flush(bs);
 	if (cmp_is_error_int(end_size))
@@ -63,6 +74,118 @@ uint32_t cmp_hdr_serialize(struct bitstream_writer *bs, const struct cmp_hdr *hd
 }
 
 
+/* number of bytes of the variable-length integer coding value */
+static unsigned int varint_size(uint32_t value)
+{
+	unsigned int size = 1;
+
+	while (size < CMP_HDR_VARINT_MAX_SIZE && value >> (7 * size))
+		size++;
+	return size;
+}
+
+
+/* adds value as variable-length integer of size bytes */
+static void add_varint(struct bitstream_writer *bs, uint32_t value, unsigned int size)
+{
+	while (size--) {
+		uint32_t const group = (value >> (7 * size)) & 0x7F;
+
+		bitstream_add_bits32(bs, size ? group | 0x80 : group, 8);
+	}
+}
+
+
+uint32_t cmp_hdr_compact_size(const struct cmp_hdr *hdr, uint32_t size_limit)
+{
+	uint32_t size = 2 + varint_size(size_limit) + varint_size(hdr->original_size);
+
+	if (hdr->checksum)
+		size += CMP_HDR_BITS_CHECKSUM / 8;
+	return size;
+}
+
+
+uint32_t cmp_hdr_serialize_compact(struct bitstream_writer *bs, const struct cmp_hdr *hdr,
+				   uint32_t size_limit)
+{
+	uint32_t start_size, end_size;
+	uint32_t first_byte = CMP_HDR_COMPACT_MARKER;
+
+	if (!hdr)
+		return CMP_ERROR(INT_HDR);
+
+	if (size_limit > CMP_HDR_MAX_COMPRESSED_SIZE || hdr->compressed_size > size_limit)
+		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+	if (hdr->original_size > CMP_HDR_MAX_ORIGINAL_SIZE)
+		return CMP_ERROR(HDR_ORIGINAL_TOO_LARGE);
+
+	if (hdr->temporal_index > CMP_HDR_COMPACT_TEMPORAL_MASK)
+		return CMP_ERROR(INT_HDR);
+
+	start_size = bitstream_size(bs);
+	if (cmp_is_error_int(start_size))
+		return start_size;
+
+	if (hdr->checksum)
+		first_byte |= CMP_HDR_COMPACT_CHECKSUM;
+	bitstream_add_bits32(bs, first_byte | hdr->temporal_index, 8);
+	bitstream_add_bits32(bs, hdr->sequence_number, CMP_HDR_BITS_SEQUENCE_NUMBER);
+	/* padded to the width of the size limit that it can be patched in place */
+	add_varint(bs, hdr->compressed_size, varint_size(size_limit));
+	add_varint(bs, hdr->original_size, varint_size(hdr->original_size));
+	if (hdr->checksum)
+		bitstream_add_bits32(bs, hdr->checksum, CMP_HDR_BITS_CHECKSUM);
+
+	end_size = bitstream_flush(bs);
+	if (cmp_is_error_int(end_size))
+		return end_size;
+
+	return end_size - start_size;
+}
+
+
+uint32_t cmp_hdr_patch_compressed_size(void *frame, uint32_t frame_size, uint32_t compressed_size)
+{
+	uint8_t *start = frame;
+	uint32_t size;
+
+	if (!frame || frame_size < 1)
+		return CMP_ERROR(INT_HDR);
+
+	if (compressed_size > CMP_HDR_MAX_COMPRESSED_SIZE)
+		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+	if (!(start[0] & CMP_HDR_COMPACT_MARKER)) {
+		if (frame_size < CMP_HDR_SIZE)
+			return CMP_ERROR(INT_HDR);
+		start[CMP_HDR_OFFSET_COMPRESSED_SIZE + 0] = (uint8_t)(compressed_size >> 16);
+		start[CMP_HDR_OFFSET_COMPRESSED_SIZE + 1] = (uint8_t)(compressed_size >> 8);
+		start[CMP_HDR_OFFSET_COMPRESSED_SIZE + 2] = (uint8_t)compressed_size;
+		return CMP_ERROR(NO_ERROR);
+	}
+
+	/* keep the width of the size already in place */
+	start += 2;
+	for (size = 1;; size++) {
+		if (size > CMP_HDR_VARINT_MAX_SIZE || 2 + size > frame_size)
+			return CMP_ERROR(INT_HDR);
+		if (!(start[size - 1] & 0x80))
+			break;
+	}
+	if (compressed_size >> (7 * size))
+		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+	while (size--) {
+		uint32_t const group = (compressed_size >> (7 * size)) & 0x7F;
+
+		*start++ = (uint8_t)(size ? group | 0x80 : group);
+	}
+	return CMP_ERROR(NO_ERROR);
+}
+
+
 /* clang-format off */
 static uint16_t extract_u16be(const uint8_t *buf)
 {
@@ -89,15 +212,69 @@ static uint32_t extract_u32be(const uint8_t *buf)
 /* clang-format on */
 
 
+/*
+ * extracts a variable-length integer; returns its number of bytes or 0 if it
+ * is not terminated within buf_size bytes
+ */
+static uint32_t extract_varint(const uint8_t *buf, uint32_t buf_size, uint32_t *value)
+{
+	uint32_t i;
+
+	*value = 0;
+	for (i = 0; i < buf_size && i < CMP_HDR_VARINT_MAX_SIZE; i++) {
+		*value = *value << 7 | (buf[i] & 0x7FU);
+		if (!(buf[i] & 0x80))
+			return i + 1;
+	}
+	return 0;
+}
+
+
+/* fills the fields of a compact header; the others stay untouched */
+static uint32_t deserialize_compact(const uint8_t *start, uint32_t src_size, struct cmp_hdr *hdr)
+{
+	uint32_t pos = 2, n;
+
+	if (src_size < pos)
+		return CMP_ERROR(INT_HDR);
+
+	hdr->temporal_index = start[0] & CMP_HDR_COMPACT_TEMPORAL_MASK;
+	hdr->sequence_number = start[1];
+
+	n = extract_varint(start + pos, src_size - pos, &hdr->compressed_size);
+	if (n == 0)
+		return CMP_ERROR(INT_HDR);
+	pos += n;
+
+	n = extract_varint(start + pos, src_size - pos, &hdr->original_size);
+	if (n == 0)
+		return CMP_ERROR(INT_HDR);
+	pos += n;
+
+	hdr->checksum = 0;
+	if (start[0] & CMP_HDR_COMPACT_CHECKSUM) {
+		if (src_size - pos < CMP_HDR_BITS_CHECKSUM / 8)
+			return CMP_ERROR(INT_HDR);
+		hdr->checksum = extract_u32be(start + pos);
+		pos += CMP_HDR_BITS_CHECKSUM / 8;
+	}
+
+	return pos;
+}
+
+
 uint32_t cmp_hdr_deserialize(const void *src, uint32_t src_size, struct cmp_hdr *hdr)
 {
 	const uint8_t *start = src;
 	uint8_t prepros_enc_type_odt;
+	uint8_t temporal_fields;
 
 	if (!hdr)
 		return CMP_ERROR(INT_HDR);
 	if (!src)
 		return CMP_ERROR(INT_HDR);
+	if (src_size > 0 && start[0] & CMP_HDR_COMPACT_MARKER)
+		return deserialize_compact(start, src_size, hdr);
 	if (src_size < CMP_HDR_SIZE)
 		return CMP_ERROR(INT_HDR);
 	memset(hdr, 0x00, sizeof(*hdr));
@@ -113,17 +290,97 @@ uint32_t cmp_hdr_deserialize(const void *src, uint32_t src_size, struct cmp_hdr
 
 	prepros_enc_type_odt = start[CMP_HDR_OFFSET_PED_FIELDS];
 	hdr->preprocessing = (prepros_enc_type_odt >> 5) & 0x7;
-	hdr->encoder_type = (prepros_enc_type_odt >> 3) & 0x3;
-	hdr->original_dtype = prepros_enc_type_odt & 0x7;
+	hdr->encoder_type = (prepros_enc_type_odt >> 2) & 0x7;
+	hdr->original_dtype = prepros_enc_type_odt & 0x3;
 
 	hdr->encoder_param = extract_u16be(start + CMP_HDR_OFFSET_ENCODER_PARAM);
 	hdr->encoder_outlier = extract_u24be(start + CMP_HDR_OFFSET_OUTLIER_PARAM);
 	hdr->preprocess_param = start[CMP_HDR_OFFSET_PREPROCESS_PARAM];
+	hdr->encoder_flags = start[CMP_HDR_OFFSET_ENCODER_FLAGS];
+	hdr->width = extract_u16be(start + CMP_HDR_OFFSET_WIDTH);
+
+	temporal_fields = start[CMP_HDR_OFFSET_TEMPORAL_FIELDS];
+	hdr->temporal_levels = (temporal_fields >> 6) & 0x3;
+	hdr->temporal_wavelet = (temporal_fields >> 4) & 0x3;
+	hdr->temporal_index = temporal_fields & 0xF;
+	hdr->near_lossless_delta = start[CMP_HDR_OFFSET_NL_DELTA];
+	hdr->n_bits = start[CMP_HDR_OFFSET_N_BITS];
+	hdr->packet_size = extract_u16be(start + CMP_HDR_OFFSET_PACKET_SIZE);
 
 	return CMP_HDR_SIZE;
 }
 
 
+static void put_u32be(uint8_t *buf, uint32_t value)
+{
+	buf[0] = (uint8_t)(value >> 24);
+	buf[1] = (uint8_t)(value >> 16);
+	buf[2] = (uint8_t)(value >> 8);
+	buf[3] = (uint8_t)value;
+}
+
+
+uint32_t cmp_chunk_index_serialize(void *dst, uint32_t dst_capacity,
+				   const struct cmp_chunk_entry *entries, uint32_t n_chunks)
+{
+	uint8_t *p = dst;
+	uint32_t i;
+
+	if (cmp_is_error_int(dst_capacity))
+		return CMP_ERROR(GENERIC);
+	if (!dst)
+		return CMP_ERROR(DST_NULL);
+	if (!entries && n_chunks > 0)
+		return CMP_ERROR(SRC_NULL);
+	if (dst_capacity < CMP_CHUNK_TRAILER_SIZE ||
+	    n_chunks > (dst_capacity - CMP_CHUNK_TRAILER_SIZE) / CMP_CHUNK_ENTRY_SIZE)
+		return CMP_ERROR(DST_TOO_SMALL);
+
+	for (i = 0; i < n_chunks; i++) {
+		put_u32be(p, entries[i].compressed_size);
+		put_u32be(p + 4, entries[i].original_size);
+		p += CMP_CHUNK_ENTRY_SIZE;
+	}
+	put_u32be(p, n_chunks);
+	put_u32be(p + 4, CMP_CHUNK_MAGIC);
+
+	return CMP_CHUNK_INDEX_SIZE(n_chunks);
+}
+
+
+uint32_t cmp_chunk_index_deserialize(const void *buf, uint32_t buf_size,
+				     struct cmp_chunk_entry *entries, uint32_t max_chunks)
+{
+	const uint8_t *trailer, *p;
+	uint32_t n_chunks, i;
+
+	if (!buf)
+		return CMP_ERROR(SRC_NULL);
+	if (buf_size < CMP_CHUNK_TRAILER_SIZE)
+		return CMP_ERROR(HDR_CHUNK_INDEX);
+
+	trailer = (const uint8_t *)buf + buf_size - CMP_CHUNK_TRAILER_SIZE;
+	if (extract_u32be(trailer + 4) != CMP_CHUNK_MAGIC)
+		return CMP_ERROR(HDR_CHUNK_INDEX);
+	n_chunks = extract_u32be(trailer);
+	if (n_chunks > (buf_size - CMP_CHUNK_TRAILER_SIZE) / CMP_CHUNK_ENTRY_SIZE ||
+	    cmp_is_error_int(n_chunks))
+		return CMP_ERROR(HDR_CHUNK_INDEX);
+	if (!entries)
+		return n_chunks;
+	if (n_chunks > max_chunks)
+		return CMP_ERROR(DST_TOO_SMALL);
+
+	p = trailer - n_chunks * CMP_CHUNK_ENTRY_SIZE;
+	for (i = 0; i < n_chunks; i++) {
+		entries[i].compressed_size = extract_u32be(p);
+		entries[i].original_size = extract_u32be(p + 4);
+		p += CMP_CHUNK_ENTRY_SIZE;
+	}
+	return n_chunks;
+}
+
+
 uint32_t cmp_hdr_checksum_int(const struct sample_desc *desc)
 {
 	uint32_t i;
@@ -133,7 +390,8 @@ uint32_t cmp_hdr_checksum_int(const struct sample_desc *desc)
 	 * Fast path: on big-endian systems with contiguous data, we can hash
 	 * directly without byte swapping.
 	 */
-	if (!XXH_CPU_LITTLE_ENDIAN && (desc->dtype == CMP_I16 || desc->dtype == CMP_U16))
+	if (!XXH_CPU_LITTLE_ENDIAN && (desc->dtype == CMP_I16 || desc->dtype == CMP_U16) &&
+	    desc->stride == sizeof(uint16_t) && !desc->segments)
 		return XXH32(desc->data, desc->num_samples * sizeof(uint16_t), CHECKSUM_SEED);
 
 	/*
@@ -23,7 +23,9 @@
 #define CHECKSUM_SEED 419764627
 
 
-compile_time_assert(CMP_HDR_SIZE == 24, cmp_header_size_must_be_24_bytes);
+compile_time_assert(CMP_HDR_SIZE == 32, cmp_header_size_must_be_32_bytes);
+compile_time_assert(CMP_VERSION_NUMBER <= CMP_HDR_MAX_VERSION, version_must_not_set_compact_marker);
+compile_time_assert(CMP_HDR_COMPACT_MAX_SIZE < CMP_HDR_SIZE, compact_header_must_be_smaller);
 
 
 /**
@@ -39,6 +41,50 @@ compile_time_assert(CMP_HDR_SIZE == 24, cmp_header_size_must_be_24_bytes);
 uint32_t cmp_hdr_serialize(struct bitstream_writer *bs, const struct cmp_hdr *hdr);
 
 
+/**
+ * @brief serialize the frame-dependent fields of a header as compact header
+ *
+ * @param bs		Pointer to a initialized bitstream writer structure
+ * @param hdr		Pointer to header structure to serialize
+ * @param size_limit	largest compressed size the frame can have; sets the
+ *			width of the compressed size field
+ *
+ * @returns the compact header size or an error, which can be checked using
+ *	cmp_is_error()
+ */
+
+uint32_t cmp_hdr_serialize_compact(struct bitstream_writer *bs, const struct cmp_hdr *hdr,
+				   uint32_t size_limit);
+
+
+/**
+ * @brief Calculates the size of a compact header
+ *
+ * @param hdr		Pointer to the header structure
+ * @param size_limit	largest compressed size the frame can have
+ *
+ * @returns the size cmp_hdr_serialize_compact() writes
+ */
+
+uint32_t cmp_hdr_compact_size(const struct cmp_hdr *hdr, uint32_t size_limit);
+
+
+/**
+ * @brief Overwrites the compressed size of a serialized full or compact header
+ *
+ * The width of a compact compressed size field is kept.
+ *
+ * @param frame			pointer to the serialized header
+ * @param frame_size		size of the frame buffer
+ * @param compressed_size	compressed size to write
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_hdr_patch_compressed_size(void *frame, uint32_t frame_size,
+				       uint32_t compressed_size);
+
+
 /**
  * @brief Calculates data checksum
  *
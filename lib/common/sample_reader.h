@@ -1,24 +1,54 @@
 #ifndef SAMPLE_READER_H
 #define SAMPLE_READER_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "../cmp.h"
+#include "../cmp_header.h"
 #include "err_private.h"
 
 
+/* cursor over the segments of non-contiguous sample data */
+struct sample_segments {
+	const struct cmp_segment *segments;
+	uint32_t n_segments;
+	uint32_t current;       /* segment of the last read */
+	uint32_t current_start; /* byte position of the current segment in the data */
+};
+
+
 struct sample_desc {
 	const void *data;
 	uint32_t num_samples;
-	uint8_t stride;
+	uint32_t stride; /* byte distance between the 16- or 32-bit sample elements */
+	uint8_t shift;   /* bit position of a sample in a 32-bit word */
 	enum cmp_type dtype;
+	uint32_t width; /* samples per row of a 2D frame */
+	struct sample_segments *segments; /* non-contiguous data if not NULL; data is unused */
 };
 
 
+/* size of a sample element in bytes; the elements of CMP_2xI16_IN_I32 data hold two samples */
+static __inline uint32_t sample_element_size(enum cmp_type dtype)
+{
+	switch (dtype) {
+	case CMP_I16:
+	case CMP_U16:
+		return sizeof(int16_t);
+	case CMP_I16_IN_I32:
+	case CMP_2xI16_IN_I32:
+		return sizeof(int32_t);
+	default:
+		return 0;
+	}
+}
+
+
 static __inline uint32_t sample_read_src_init(struct sample_desc *src_desc, const void *src,
 					      uint32_t src_size, enum cmp_type src_type)
 {
-	uint8_t stride;
+	uint32_t stride;
 
 	if (!src)
 		return CMP_ERROR(SRC_NULL);
@@ -26,30 +56,181 @@ static __inline uint32_t sample_read_src_init(struct sample_desc *src_desc, cons
 	if (src_size == 0)
 		return CMP_ERROR(SRC_SIZE_WRONG);
 
-	switch (src_type) {
-	case CMP_I16:
-	case CMP_U16:
-		stride = sizeof(int16_t);
-		break;
-	case CMP_I16_IN_I32:
-		stride = sizeof(int32_t);
-		break;
-	default:
+	stride = sample_element_size(src_type);
+	if (stride == 0)
 		return CMP_ERROR(SRC_SIZE_WRONG);
-	};
 
 	if (src_size % stride != 0)
 		return CMP_ERROR(SRC_SIZE_WRONG);
 
 	src_desc->data = src;
 	src_desc->num_samples = src_size / stride;
+	if (src_type == CMP_2xI16_IN_I32)
+		src_desc->num_samples *= 2;
 	src_desc->stride = stride;
+	src_desc->shift = 0;
 	src_desc->dtype = src_type;
+	src_desc->width = src_desc->num_samples;
+	src_desc->segments = NULL;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Initialises the descriptor of sample elements spaced byte_stride
+ *	bytes apart, e.g. one channel of an interleaved multi-channel buffer
+ *
+ * @param src_desc	pointer to the descriptor to initialise
+ * @param base		pointer to the buffer holding the samples
+ * @param n_elements	number of sample elements to read
+ * @param byte_stride	distance between two elements in bytes
+ * @param byte_offset	offset of the first element from base in bytes
+ * @param src_type	type of the sample elements
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t sample_read_strided_init(struct sample_desc *src_desc, const void *base,
+						  uint32_t n_elements, uint32_t byte_stride,
+						  uint32_t byte_offset, enum cmp_type src_type)
+{
+	uint32_t const element_size = sample_element_size(src_type);
+	uint32_t const samples_per_element = src_type == CMP_2xI16_IN_I32 ? 2 : 1;
+	const uint8_t *data;
+
+	if (!base)
+		return CMP_ERROR(SRC_NULL);
+
+	if (n_elements == 0 || element_size == 0 || byte_stride < element_size)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	if ((uint64_t)n_elements * samples_per_element * sizeof(int16_t) >
+	    CMP_HDR_MAX_ORIGINAL_SIZE)
+		return CMP_ERROR(HDR_ORIGINAL_TOO_LARGE);
+
+	data = (const uint8_t *)base + byte_offset;
+	if ((uintptr_t)data % element_size != 0 || byte_stride % element_size != 0)
+		return CMP_ERROR(SRC_UNALIGNED);
+
+	src_desc->data = data;
+	src_desc->num_samples = n_elements * samples_per_element;
+	src_desc->stride = byte_stride;
+	src_desc->shift = 0;
+	src_desc->dtype = src_type;
+	src_desc->width = src_desc->num_samples;
+	src_desc->segments = NULL;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Initialises the descriptor of sample data split into non-contiguous
+ *	segments, which are read as if they were one contiguous buffer
+ *
+ * @param src_desc	pointer to the descriptor to initialise
+ * @param cursor	pointer to the segment cursor used by the descriptor;
+ *			has to outlive the descriptor
+ * @param segments	array of segments in data order
+ * @param n_segments	number of segments
+ * @param src_type	type of the data
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t sample_read_segments_init(struct sample_desc *src_desc,
+						   struct sample_segments *cursor,
+						   const struct cmp_segment *segments,
+						   uint32_t n_segments, enum cmp_type src_type)
+{
+	uint32_t const element_size = sample_element_size(src_type);
+	uint64_t src_size = 0;
+	uint32_t j, ret;
+
+	if (!segments)
+		return CMP_ERROR(SRC_NULL);
+
+	if (n_segments == 0 || element_size == 0)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	for (j = 0; j < n_segments; j++) {
+		if (!segments[j].data)
+			return CMP_ERROR(SRC_NULL);
+		if (segments[j].size % element_size != 0)
+			return CMP_ERROR(SRC_SIZE_WRONG);
+		if ((uintptr_t)segments[j].data % element_size != 0)
+			return CMP_ERROR(SRC_UNALIGNED);
+		src_size += segments[j].size;
+	}
+	if (src_size > UINT32_MAX)
+		return CMP_ERROR(HDR_ORIGINAL_TOO_LARGE);
+
+	ret = sample_read_src_init(src_desc, segments[0].data, (uint32_t)src_size, src_type);
+	if (cmp_is_error_int(ret) || n_segments == 1)
+		return ret;
+
+	cursor->segments = segments;
+	cursor->n_segments = n_segments;
+	cursor->current = 0;
+	cursor->current_start = 0;
+	src_desc->data = NULL;
+	src_desc->segments = cursor;
 
 	return CMP_ERROR(NO_ERROR);
 }
 
 
+/**
+ * @brief Initialises the descriptor of one channel of CMP_2xI16_IN_I32 data
+ *
+ * @param ch_desc	pointer to the channel descriptor to initialise
+ * @param src_desc	pointer to the descriptor of the CMP_2xI16_IN_I32 data
+ * @param channel	channel to describe; 0 for the lower, 1 for the upper
+ *			16 bits of each 32-bit word
+ */
+
+static __inline void sample_read_channel_init(struct sample_desc *ch_desc,
+					      const struct sample_desc *src_desc,
+					      unsigned int channel)
+{
+	ch_desc->data = src_desc->data;
+	ch_desc->num_samples = src_desc->num_samples / 2;
+	ch_desc->stride = src_desc->stride;
+	ch_desc->shift = channel ? 16 : 0;
+	ch_desc->dtype = CMP_I16_IN_I32;
+	ch_desc->width = ch_desc->num_samples;
+	ch_desc->segments = src_desc->segments;
+}
+
+
+/**
+ * @brief Looks up a byte position of non-contiguous sample data
+ *
+ * The cursor is moved from the segment of the last read, so reading the data
+ * in (about) ascending order is cheap.
+ *
+ * @param cursor	pointer to the segment cursor
+ * @param pos		byte position in the data; has to be in range
+ *
+ * @returns the address of the byte
+ */
+
+static __inline const uint8_t *sample_segments_addr(struct sample_segments *cursor, uint32_t pos)
+{
+	while (pos < cursor->current_start) {
+		cursor->current--;
+		cursor->current_start -= cursor->segments[cursor->current].size;
+	}
+	while (pos - cursor->current_start >= cursor->segments[cursor->current].size) {
+		cursor->current_start += cursor->segments[cursor->current].size;
+		cursor->current++;
+	}
+	return (const uint8_t *)cursor->segments[cursor->current].data +
+	       (pos - cursor->current_start);
+}
+
+
 /**
  * @brief Reads a 16-bit signed integer from the sample data
  *
@@ -61,13 +242,26 @@ static __inline uint32_t sample_read_src_init(struct sample_desc *src_desc, cons
 
 static __inline int16_t sample_read_i16(const struct sample_desc *desc, uint32_t i)
 {
-	const void *addr = (const uint8_t *)desc->data + (i * desc->stride);
+	const uint8_t *addr;
+	uint32_t shift = desc->shift;
 
-	/* Assume samples size == stride size */
-	if (desc->stride == sizeof(int32_t))
-		return (int16_t)(*(const uint32_t *)addr & 0xFFFFU);
+	if (desc->dtype == CMP_I16 || desc->dtype == CMP_U16) {
+		if (!desc->segments)
+			return *(const int16_t *)((const uint8_t *)desc->data +
+						  (size_t)i * desc->stride);
+		return *(const int16_t *)sample_segments_addr(desc->segments, i * desc->stride);
+	}
 
-	return *(const int16_t *)addr;
+	/* both samples of a dual-channel word, the lower half first */
+	if (desc->dtype == CMP_2xI16_IN_I32) {
+		shift = (i & 1) * 16;
+		i /= 2;
+	}
+	if (!desc->segments)
+		addr = (const uint8_t *)desc->data + (size_t)i * desc->stride;
+	else
+		addr = sample_segments_addr(desc->segments, i * desc->stride);
+	return (int16_t)((*(const uint32_t *)addr >> shift) & 0xFFFFU);
 }
 
 
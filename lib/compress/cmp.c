@@ -50,7 +50,9 @@ uint32_t cmp_compress_bound(uint32_t packed_size)
 	if (packed_size > CMP_HDR_MAX_ORIGINAL_SIZE)
 		return (CMP_ERROR(HDR_ORIGINAL_TOO_LARGE));
 
-	bound = CMP_HDR_SIZE + cmp_encoder_max_compressed_size(packed_size);
+	/* the channel table and the channel padding of CMP_2xI16_IN_I32 data */
+	bound = CMP_HDR_SIZE + cmp_encoder_max_compressed_size(packed_size) +
+		CMP_CHANNEL_TABLE_SIZE + CMP_NUM_CHANNELS;
 
 	if (bound > CMP_HDR_MAX_COMPRESSED_SIZE)
 		return (CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE));
@@ -59,24 +61,61 @@ uint32_t cmp_compress_bound(uint32_t packed_size)
 }
 
 
-uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_size)
+uint32_t cmp_compress_bound_params(const struct cmp_params *params, uint32_t packed_size)
 {
-	const struct preprocessing_method *preprocess;
-	uint32_t primary_work_buf_size, secondary_work_buf_size;
+	uint32_t const bound = cmp_compress_bound(packed_size);
+	uint64_t packet_bound;
 
 	if (params == NULL)
 		return CMP_ERROR(GENERIC);
+	if (cmp_is_error_int(bound) || params->packet_size == 0)
+		return bound;
+
+	/* every packet holds at least one sample */
+	packet_bound = CMP_HDR_SIZE +
+		       (uint64_t)DIV_ROUND_UP(packed_size, sizeof(int16_t)) * params->packet_size;
+	if (packet_bound > CMP_HDR_MAX_COMPRESSED_SIZE)
+		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+	return packet_bound > bound ? (uint32_t)packet_bound : bound;
+}
+
+
+/* non-zero if the temporal group size is 0 (disabled), 2, 4 or 8 */
+static int temporal_group_size_is_valid(uint32_t group_size)
+{
+	return group_size == 0 || (group_size >= 2 && group_size <= CMP_TEMPORAL_GROUP_MAX &&
+				   (group_size & (group_size - 1)) == 0);
+}
+
+
+/* returns the (near-lossless if delta is non-zero) preprocessing method or NULL */
+static const struct preprocessing_method *get_preprocessing(enum cmp_preprocessing type,
+							     uint32_t near_lossless_delta)
+{
+	if (near_lossless_delta != 0)
+		return preprocessing_near_lossless_get_method(type);
+	return preprocessing_get_method(type);
+}
+
+
+/* work buffer size needed by the (spatial) preprocessing of a frame */
+static uint32_t preprocess_work_buf_size(const struct cmp_params *params, uint32_t src_size)
+{
+	const struct preprocessing_method *preprocess;
+	uint32_t primary_work_buf_size, secondary_work_buf_size;
 
 	if (params->primary_preprocessing == CMP_PREPROCESS_MODEL)
 		return CMP_ERROR(PARAMS_INVALID);
 
-	preprocess = preprocessing_get_method(params->primary_preprocessing);
+	preprocess = get_preprocessing(params->primary_preprocessing, params->near_lossless_delta);
 	if (preprocess == NULL)
 		return CMP_ERROR(PARAMS_INVALID);
 	primary_work_buf_size = preprocess->get_work_buf_size(src_size);
 
 	if (params->secondary_iterations) {
-		preprocess = preprocessing_get_method(params->secondary_preprocessing);
+		preprocess = get_preprocessing(params->secondary_preprocessing,
+					       params->near_lossless_delta);
 		if (preprocess == NULL)
 			return CMP_ERROR(PARAMS_INVALID);
 		secondary_work_buf_size = preprocess->get_work_buf_size(src_size);
@@ -88,6 +127,34 @@ uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_siz
 }
 
 
+uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_size)
+{
+	uint32_t work_buf_size;
+	uint64_t temporal_work_buf_size;
+
+	if (params == NULL)
+		return CMP_ERROR(GENERIC);
+
+	work_buf_size = preprocess_work_buf_size(params, src_size);
+	if (cmp_is_error_int(work_buf_size))
+		return work_buf_size;
+
+	if (!temporal_group_size_is_valid(params->temporal_group_size))
+		return CMP_ERROR(PARAMS_INVALID);
+	if (params->temporal_group_size == 0)
+		return work_buf_size;
+
+	/* the temporal subbands are stored behind the preprocessing data */
+	temporal_work_buf_size = ROUND_UP_TO_NEXT_2(work_buf_size) +
+				 (uint64_t)params->temporal_group_size * ROUND_UP_TO_NEXT_2(src_size);
+	if (temporal_work_buf_size > UINT32_MAX ||
+	    cmp_is_error_int((uint32_t)temporal_work_buf_size))
+		return CMP_ERROR(PARAMS_INVALID);
+
+	return (uint32_t)temporal_work_buf_size;
+}
+
+
 /** Maximum allowed model adaptation rate parameter  */
 #define CMP_MAX_MODEL_RATE 16
 
@@ -119,6 +186,7 @@ static int16_t update_model(int16_t data, int16_t model, int model_rate, enum cm
 	switch (dtype) {
 	case CMP_I16:
 	case CMP_I16_IN_I32:
+	case CMP_2xI16_IN_I32:
 		return update_model_16(data, model, model_rate);
 	case CMP_U16:
 	default:
@@ -134,6 +202,51 @@ static int model_is_needed(const struct cmp_params *params)
 }
 
 
+/* non-zero if the preprocessing is a wavelet transform */
+static int uses_wavelet(enum cmp_preprocessing preprocessing)
+{
+	return preprocessing == CMP_PREPROCESS_IWT || preprocessing == CMP_PREPROCESS_IWT_2D;
+}
+
+
+static int wavelet_is_needed(const struct cmp_params *params)
+{
+	return uses_wavelet(params->primary_preprocessing) ||
+	       (uses_wavelet(params->secondary_preprocessing) && params->secondary_iterations != 0);
+}
+
+
+/* number of bits per sample selected by the parameters */
+static uint32_t sample_n_bits(const struct cmp_params *params)
+{
+	if (params->n_bits == 0)
+		return CMP_NUM_BITS_PER_SAMPLE;
+	return params->n_bits;
+}
+
+
+/* non-zero if the preprocessing can restart at every packet */
+static int is_packetizable(enum cmp_preprocessing preprocessing)
+{
+	return preprocessing == CMP_PREPROCESS_NONE || preprocessing == CMP_PREPROCESS_DIFF;
+}
+
+
+/* the uncompressed storage is not packetized */
+static int fallback_is_enabled(const struct cmp_params *params)
+{
+	return params->uncompressed_fallback_enabled && params->packet_size == 0;
+}
+
+
+static int fixed_order_is_needed(const struct cmp_params *params)
+{
+	return params->primary_preprocessing == CMP_PREPROCESS_FIXED ||
+	       (params->secondary_preprocessing == CMP_PREPROCESS_FIXED &&
+		params->secondary_iterations != 0);
+}
+
+
 uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params, void *work_buf,
 			uint32_t work_buf_size)
 {
@@ -171,6 +284,50 @@ uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params
 	if (model_is_needed(params) && params->model_rate > CMP_MAX_MODEL_RATE)
 		return CMP_ERROR(PARAMS_INVALID);
 
+	if (wavelet_is_needed(params) && params->wavelet > CMP_WAVELET_9_7_M)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (fixed_order_is_needed(params) && params->fixed_order > CMP_FIXED_ORDER_MAX &&
+	    params->fixed_order != CMP_FIXED_ORDER_AUTO)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (params->width > CMP_HDR_MAX_WIDTH)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (params->temporal_group_size != 0) {
+		if (params->temporal_wavelet > CMP_WAVELET_9_7_M)
+			return CMP_ERROR(PARAMS_INVALID);
+		/* the model would mix the different temporal subbands */
+		if (model_is_needed(params))
+			return CMP_ERROR(PARAMS_INVALID);
+		/* the inverse temporal transform would not bound the error */
+		if (params->near_lossless_delta != 0)
+			return CMP_ERROR(PARAMS_INVALID);
+	}
+
+	if (params->near_lossless_delta > CMP_HDR_MAX_NL_DELTA)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (params->packet_size != 0) {
+		if (params->packet_size < CMP_PACKET_MIN_SIZE ||
+		    params->packet_size > CMP_HDR_MAX_PACKET_SIZE)
+			return CMP_ERROR(PARAMS_INVALID);
+		/* the packet header only holds the state of the DIFF preprocessing */
+		if (!is_packetizable(params->primary_preprocessing) ||
+		    (params->secondary_iterations &&
+		     !is_packetizable(params->secondary_preprocessing)))
+			return CMP_ERROR(PARAMS_INVALID);
+		if (params->near_lossless_delta != 0)
+			return CMP_ERROR(PARAMS_INVALID);
+	}
+
+	if (params->n_bits > CMP_NUM_BITS_PER_SAMPLE)
+		return CMP_ERROR(PARAMS_INVALID);
+	/* the residuals of the transforms do not wrap around at the bit depth */
+	if (sample_n_bits(params) < CMP_NUM_BITS_PER_SAMPLE &&
+	    (wavelet_is_needed(params) || params->temporal_group_size != 0))
+		return CMP_ERROR(PARAMS_INVALID);
+
 	work_buf_size_needed = cmp_cal_work_buf_size(params, min_src_size);
 	if (cmp_is_error_int(work_buf_size_needed))
 		return work_buf_size_needed;
@@ -194,254 +351,2004 @@ uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params
 }
 
 
-/* fast shortcut for uncompressed data; assume model has sufficient size*/
-static void write_uncompressed(struct bitstream_writer *bs, const struct sample_desc *src_desc,
-			       int16_t *model)
+/**
+ * @brief Parameters used for a single compression pass
+ */
+
+struct cmp_pass_params {
+	enum cmp_preprocessing preprocessing;
+	uint32_t preprocess_param;
+	uint32_t near_lossless_delta;
+	uint32_t n_bits;
+	enum cmp_encoder_type encoder_type;
+	uint32_t encoder_param;
+	uint32_t outlier;
+	uint32_t packet_size;
+};
+
+
+/* splits the source data into rows of the configured width */
+static void apply_frame_width(struct sample_desc *src_desc, const struct cmp_params *params)
 {
-	switch (src_desc->dtype) {
-	case CMP_I16:
-	case CMP_U16:
-		bitstream_add_be16_array(bs, src_desc->data, src_desc->num_samples);
-		if (model)
-			memcpy(model, src_desc->data, get_packed_size(src_desc));
-		break;
-	case CMP_I16_IN_I32:
-		bitstream_add_be16_in_32_array(bs, src_desc->data, src_desc->num_samples);
-		if (model) {
-			uint32_t i;
+	if (params->width != 0 && params->width < src_desc->num_samples)
+		src_desc->width = params->width;
+}
 
-			for (i = 0; i < src_desc->num_samples; i++)
-				model[i] = sample_read_i16(src_desc, i);
-		}
-		break;
+
+/**
+ * @brief Samples of a channel with the part of the working buffer holding
+ *	its preprocessing state and model
+ */
+
+struct cmp_channel {
+	struct sample_desc desc;
+	void *work_buf;
+	uint32_t work_buf_size;
+	uint32_t n_values; /* number of values returned by the preprocessing */
+};
+
+
+/**
+ * @brief Splits the source data into the channels compressed independently
+ *
+ * CMP_2xI16_IN_I32 data are split into CMP_NUM_CHANNELS channels, each getting
+ * an equal part of the working buffer; all other data form a single channel
+ * using the whole working buffer.
+ *
+ * @param ctx		pointer to a compression context
+ * @param src_desc	source data descriptor pointer
+ * @param channels	array of CMP_NUM_CHANNELS channels to set up
+ *
+ * @returns the number of channels
+ */
+
+static unsigned int get_channels(const struct cmp_context *ctx,
+				 const struct sample_desc *src_desc, struct cmp_channel *channels)
+{
+	/* an even part size keeps the parts 2-byte aligned */
+	uint32_t const part_size = (ctx->work_buf_size / CMP_NUM_CHANNELS) & ~1U;
+	unsigned int c;
+
+	if (src_desc->dtype != CMP_2xI16_IN_I32) {
+		channels[0].desc = *src_desc;
+		channels[0].work_buf = ctx->work_buf;
+		channels[0].work_buf_size = ctx->work_buf_size;
+		channels[0].n_values = 0;
+		return 1;
 	}
+
+	for (c = 0; c < CMP_NUM_CHANNELS; c++) {
+		sample_read_channel_init(&channels[c].desc, src_desc, c);
+		apply_frame_width(&channels[c].desc, &ctx->params);
+		channels[c].work_buf = ctx->work_buf ? (uint8_t *)ctx->work_buf + c * part_size
+						     : NULL;
+		channels[c].work_buf_size = part_size;
+		channels[c].n_values = 0;
+	}
+	return CMP_NUM_CHANNELS;
 }
 
 
-/* Main compression loop */
-static uint32_t compress_engine(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-				const struct sample_desc *src_desc)
+/* non-zero if the working buffer of every channel can hold its model */
+static int channels_hold_model(const struct cmp_channel *channels, unsigned int n_channels)
 {
-	uint32_t i, ret, n_values;
-	enum cmp_preprocessing selected_preprocessing;
-	enum cmp_encoder_type selected_encoder_type;
-	uint32_t selected_encoder_param;
-	uint32_t selected_outlier;
-	struct bitstream_writer bs;
-	struct cmp_encoder enc;
-	const struct preprocessing_method *preprocess;
-	int16_t *model = NULL;
-	struct cmp_hdr hdr = { 0 };
-	uint32_t compress_bound;
+	unsigned int c;
 
-	if (ctx->sequence_number == 0 || ctx->sequence_number > ctx->params.secondary_iterations) {
-		ret = cmp_reset(ctx);
-		if (cmp_is_error_int(ret))
-			return ret;
-		selected_preprocessing = ctx->params.primary_preprocessing;
-		selected_encoder_type = ctx->params.primary_encoder_type;
-		selected_encoder_param = ctx->params.primary_encoder_param;
-		selected_outlier = ctx->params.primary_encoder_outlier;
-		ctx->model_size = get_packed_size(src_desc);
-	} else {
-		selected_preprocessing = ctx->params.secondary_preprocessing;
-		selected_encoder_type = ctx->params.secondary_encoder_type;
-		selected_encoder_param = ctx->params.secondary_encoder_param;
-		selected_outlier = ctx->params.secondary_encoder_outlier;
-		/*
-		 * When using model preprocessing the size of the data to
-		 * compression is not allowed to change unit a reset.
-		 */
-		if (model_is_needed(&ctx->params) && get_packed_size(src_desc) != ctx->model_size)
-			return CMP_ERROR(SRC_SIZE_MISMATCH);
-	}
+	for (c = 0; c < n_channels; c++)
+		if (channels[c].work_buf_size < get_packed_size(&channels[c].desc))
+			return 0;
+	return 1;
+}
 
-	if (model_is_needed(&ctx->params)) {
-		if (ctx->work_buf_size < get_packed_size(src_desc))
-			return CMP_ERROR(WORK_BUF_TOO_SMALL);
-		model = ctx->work_buf;
-	}
 
-	ret = bitstream_writer_init(&bs, dst, dst_capacity);
-	if (cmp_is_error_int(ret))
-		return ret;
+/* the next compression uses the primary parameters if this returns non-zero */
+static int is_primary_pass(const struct cmp_context *ctx)
+{
+	return ctx->sequence_number == 0 ||
+	       ctx->sequence_number > ctx->params.secondary_iterations;
+}
 
-	ret = cmp_encoder_init(&enc, selected_encoder_type, selected_encoder_param,
-			       selected_outlier);
-	if (cmp_is_error_int(ret))
-		return ret;
 
-	hdr.version = CMP_VERSION_NUMBER;
-	hdr.original_size = get_packed_size(src_desc);
-	hdr.compressed_size = 0; /* place holder, not know right now */
-	if (ctx->params.checksum_enabled)
-		hdr.checksum = cmp_hdr_checksum_int(src_desc);
-	else
-		hdr.checksum = 0;
-	hdr.identifier = ctx->identifier;
-	hdr.sequence_number = ctx->sequence_number;
-	hdr.preprocessing = selected_preprocessing;
-	hdr.encoder_type = selected_encoder_type;
-	hdr.original_dtype = src_desc->dtype;
-	if (selected_preprocessing == CMP_PREPROCESS_MODEL)
-		hdr.preprocess_param = ctx->params.model_rate;
-	else
-		hdr.preprocess_param = ctx->params.secondary_iterations;
-	if (selected_encoder_type != CMP_ENCODER_UNCOMPRESSED) {
-		hdr.encoder_param = selected_encoder_param;
-		hdr.encoder_outlier = enc.outlier;
+static void get_pass_params(const struct cmp_context *ctx, const struct sample_desc *src_desc,
+			    struct cmp_pass_params *pass)
+{
+	if (is_primary_pass(ctx)) {
+		pass->preprocessing = ctx->params.primary_preprocessing;
+		pass->encoder_type = ctx->params.primary_encoder_type;
+		pass->encoder_param = ctx->params.primary_encoder_param;
+		pass->outlier = ctx->params.primary_encoder_outlier;
+	} else {
+		pass->preprocessing = ctx->params.secondary_preprocessing;
+		pass->encoder_type = ctx->params.secondary_encoder_type;
+		pass->encoder_param = ctx->params.secondary_encoder_param;
+		pass->outlier = ctx->params.secondary_encoder_outlier;
 	}
-	ret = cmp_hdr_serialize(&bs, &hdr);
-	if (cmp_is_error_int(ret))
-		return ret;
 
-	if (selected_preprocessing == CMP_PREPROCESS_NONE &&
-	    selected_encoder_type == CMP_ENCODER_UNCOMPRESSED) {
-		write_uncompressed(&bs, src_desc, model);
-	} else {
-		compress_bound = cmp_compress_bound(get_packed_size(src_desc));
-		if (cmp_is_error_int(compress_bound))
-			compress_bound = ~0U;
+	pass->near_lossless_delta = ctx->params.near_lossless_delta;
+	pass->n_bits = sample_n_bits(&ctx->params);
+	pass->packet_size = ctx->params.packet_size;
+
+	if (pass->preprocessing == CMP_PREPROCESS_MODEL)
+		pass->preprocess_param = ctx->params.model_rate;
+	else if (uses_wavelet(pass->preprocessing))
+		pass->preprocess_param = ctx->params.wavelet;
+	else if (pass->preprocessing == CMP_PREPROCESS_FIXED)
+		pass->preprocess_param = ctx->params.fixed_order == CMP_FIXED_ORDER_AUTO
+						 ? preprocessing_fixed_select_order(src_desc)
+						 : ctx->params.fixed_order;
+	else
+		pass->preprocess_param = ctx->params.secondary_iterations;
+}
 
-		preprocess = preprocessing_get_method(selected_preprocessing);
-		if (preprocess == NULL)
-			return CMP_ERROR(PARAMS_INVALID);
 
-		n_values = preprocess->init(src_desc, ctx->work_buf, ctx->work_buf_size);
-		if (cmp_is_error_int(n_values))
-			return n_values;
+/* parameter for the init() function of the preprocessing method of a pass */
+static uint32_t init_param(const struct cmp_pass_params *pass)
+{
+	if (pass->near_lossless_delta != 0)
+		return pass->near_lossless_delta;
+	return pass->preprocess_param;
+}
 
-		for (i = 0; i < n_values; i++) {
-			int16_t const value = preprocess->process(i, src_desc, ctx->work_buf);
 
-			cmp_encoder_encode_s16(&enc, value, &bs);
-			if (dst_capacity < compress_bound)
-				if (cmp_is_error_int(bitstream_error(&bs)))
-					break;
+/* non-zero if the data are copied without preprocessing and encoding */
+static int is_raw_copy(const struct cmp_pass_params *pass)
+{
+	return pass->preprocessing == CMP_PREPROCESS_NONE &&
+	       pass->encoder_type == CMP_ENCODER_UNCOMPRESSED && pass->near_lossless_delta == 0 &&
+	       pass->n_bits == CMP_NUM_BITS_PER_SAMPLE && pass->packet_size == 0;
+}
 
-			if (model) {
-				if (ctx->sequence_number == 0)
-					model[i] = sample_read_i16(src_desc, i);
-				else
-					model[i] = update_model(sample_read_i16(src_desc, i),
-								model[i],
-								(int)ctx->params.model_rate,
-								src_desc->dtype);
-			}
-		}
+
+/**
+ * @brief Selects the encoder parameter for CMP_ENCODER_PARAM_AUTO
+ *
+ * Makes a first pass over the preprocessed data to get the mean of the mapped
+ * values, from which the Golomb parameter is derived. The channels share the
+ * parameter, so the mean is taken over all of them.
+ *
+ * @param pass		parameters of the current compression pass
+ * @param preprocess	initialised preprocessing method of the pass
+ * @param channels	channels with the initialised preprocessing state
+ * @param n_channels	number of channels
+ *
+ * @returns the selected encoder parameter
+ */
+
+static uint32_t select_encoder_param(const struct cmp_pass_params *pass,
+				     const struct preprocessing_method *preprocess,
+				     const struct cmp_channel *channels, unsigned int n_channels)
+{
+	uint64_t sum = 0;
+	uint32_t i, n_values = 0;
+	unsigned int c;
+
+	if (pass->encoder_type == CMP_ENCODER_UNCOMPRESSED)
+		return 0; /* parameter is not used */
+
+	/* the other encoders select their coding parameters themselves */
+	if (pass->encoder_type == CMP_ENCODER_BLOCK_RICE)
+		return CMP_BLOCK_RICE_DEFAULT_SIZE;
+	if (pass->encoder_type == CMP_ENCODER_ADAPTIVE_RICE)
+		return CMP_ADAPTIVE_RICE_DEFAULT_RESET;
+	if (pass->encoder_type == CMP_ENCODER_PFOR)
+		return CMP_PFOR_DEFAULT_SIZE;
+	if (pass->encoder_type == CMP_ENCODER_RANS)
+		return CMP_RANS_DEFAULT_STATES;
+
+	for (c = 0; c < n_channels; c++) {
+		const struct cmp_channel *ch = &channels[c];
+
+		for (i = 0; i < ch->n_values; i++)
+			sum += cmp_encoder_map_s16(preprocess->process(i, &ch->desc, ch->work_buf),
+						   pass->n_bits);
+		n_values += ch->n_values;
 	}
 
-	hdr.compressed_size = bitstream_flush(&bs);
-	if (cmp_is_error_int(hdr.compressed_size))
-		return hdr.compressed_size;
+	if (pass->encoder_type == CMP_ENCODER_EXP_GOLOMB)
+		return cmp_encoder_exp_golomb_k_from_mean(sum, n_values);
+	return cmp_encoder_golomb_par_from_mean(sum, n_values);
+}
 
-	/*
-	 * Now that we have the final compressed size, rewind the bitstream and
-	 * re-serialize the header with the correct cmp_size.
-	 */
-	ret = bitstream_rewind(&bs);
-	if (cmp_is_error_int(ret))
-		return ret;
-	ret = cmp_hdr_serialize(&bs, &hdr);
-	if (cmp_is_error_int(ret))
-		return ret;
 
-	ctx->sequence_number++;
-	return hdr.compressed_size;
+/*
+ * passes the preprocessed values first, first + step, ... to encoders with a
+ * static per-frame model
+ */
+static void train_encoder(struct cmp_encoder *enc, const struct preprocessing_method *preprocess,
+			  const struct sample_desc *src_desc, void *work_buf, uint32_t first,
+			  uint32_t n_values, uint32_t step)
+{
+	uint32_t i;
+
+	if (!cmp_encoder_needs_training(enc))
+		return;
+
+	for (i = first; i < n_values; i += step)
+		cmp_encoder_train_s16(enc, preprocess->process(i, src_desc, work_buf));
 }
 
 
-/* implements uncompressed fallback */
-static uint32_t cmp_compress_generic(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-				     const struct sample_desc *src_desc)
+/**
+ * @brief Updates the model with the i-th sample as the decompressor sees it
+ *
+ * The samples have to be updated in ascending order; with near-lossless
+ * preprocessing the reconstructed samples are used, so that the model does not
+ * drift away from the one of the decompressor.
+ *
+ * @param ctx		pointer to a compression context
+ * @param pass		parameters of the current compression pass
+ * @param preprocess	initialised preprocessing method of the pass
+ * @param ch		channel of the sample; its working buffer holds the model
+ * @param i		index of the sample
+ */
+
+static void update_model_sample(const struct cmp_context *ctx,
+				const struct cmp_pass_params *pass,
+				const struct preprocessing_method *preprocess,
+				const struct cmp_channel *ch, uint32_t i)
 {
-	uint32_t uncompressed_size = CMP_HDR_SIZE + get_packed_size(src_desc);
-	enum cmp_preprocessing saved_preprocessing;
-	enum cmp_encoder_type saved_encoder_type;
-	uint32_t ret;
+	const struct sample_desc *src_desc = &ch->desc;
+	int16_t *model = ch->work_buf;
+	int16_t sample;
 
-	if (ctx == NULL)
-		return CMP_ERROR(GENERIC);
+	if (pass->near_lossless_delta == 0) {
+		sample = sample_read_i16(src_desc, i);
+	} else {
+		int16_t prediction = 0;
 
-	if (ctx->magic != CMP_MAGIC)
-		return CMP_ERROR(CONTEXT_INVALID);
+		if (pass->preprocessing == CMP_PREPROCESS_MODEL)
+			prediction = model[i];
+		/* the model already holds the reconstruction of the previous sample */
+		else if (pass->preprocessing == CMP_PREPROCESS_DIFF && i > 0)
+			prediction = model[i - 1];
 
-	if (cmp_is_error_int(dst_capacity))
-		return CMP_ERROR(GENERIC);
+		sample = preprocessing_near_lossless_reconstruct(
+			prediction, preprocess->process(i, src_desc, ch->work_buf),
+			pass->near_lossless_delta, src_desc->dtype);
+	}
 
-	/* Skip fallback if disabled or output buffer too small for uncompressed */
-	if (!ctx->params.uncompressed_fallback_enabled || dst_capacity < uncompressed_size)
-		return compress_engine(ctx, dst, dst_capacity, src_desc);
+	if (ctx->sequence_number == 0)
+		model[i] = sample;
+	else
+		model[i] = update_model(sample, model[i], (int)ctx->params.model_rate,
+					src_desc->dtype);
+}
 
-	/*
-	 * Try compression with restricted buffer size. If data doesn't compress
-	 * well enough to fit in uncompressed_size bytes, we'll get a buffer
-	 * overflow error and fall back to uncompressed storage.
-	 */
-	ret = compress_engine(ctx, dst, uncompressed_size, src_desc);
-	if (cmp_get_error_code(ret) != CMP_ERR_DST_TOO_SMALL)
-		return ret;
 
-	/*
-	 * Compression failed - fall back to uncompressed storage.
-	 * Reset context to avoid corrupted model state, then temporarily
-	 * switch to uncompressed mode.
-	 */
-	ret = cmp_reset(ctx);
-	if (cmp_is_error_int(ret))
-		return ret;
-	saved_preprocessing = ctx->params.primary_preprocessing;
-	saved_encoder_type = ctx->params.primary_encoder_type;
-	ctx->params.primary_preprocessing = CMP_PREPROCESS_NONE;
-	ctx->params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+/* writes the byte sizes of all but the last stream */
+static void write_stream_table(struct bitstream_writer *bs, const uint32_t *stream_sizes)
+{
+	int j;
 
-	ret = compress_engine(ctx, dst, uncompressed_size, src_desc);
+	for (j = 0; j < CMP_NUM_STREAMS - 1; j++)
+		bitstream_add_bits32(bs, stream_sizes[j], CMP_HDR_BITS_STREAM_SIZE);
+}
 
-	ctx->params.primary_preprocessing = saved_preprocessing;
-	ctx->params.primary_encoder_type = saved_encoder_type;
-	return ret;
+
+/*
+ * Encodes the preprocessed values into CMP_NUM_STREAMS byte-aligned streams;
+ * each stream uses its own copy of the initialised encoder so that the streams
+ * can be decoded independently of each other
+ */
+static uint32_t encode_streams(struct bitstream_writer *bs, const struct cmp_encoder *enc_init,
+			       const struct preprocessing_method *preprocess,
+			       const struct sample_desc *src_desc, void *work_buf,
+			       uint32_t n_values, uint32_t *stream_sizes)
+{
+	uint32_t i, j, start, end;
+
+	start = bitstream_size(bs);
+	for (j = 0; j < CMP_NUM_STREAMS; j++) {
+		struct cmp_encoder enc = *enc_init;
+
+		train_encoder(&enc, preprocess, src_desc, work_buf, j, n_values, CMP_NUM_STREAMS);
+		for (i = j; i < n_values; i += CMP_NUM_STREAMS)
+			cmp_encoder_encode_s16(&enc, preprocess->process(i, src_desc, work_buf), bs);
+		cmp_encoder_flush(&enc, bs);
+		bitstream_pad_to_byte(bs);
+
+		end = bitstream_size(bs);
+		if (cmp_is_error_int(end))
+			return end;
+		stream_sizes[j] = end - start;
+		start = end;
+	}
+	return CMP_ERROR(NO_ERROR);
 }
 
 
-uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-			  const uint16_t *src, uint32_t src_size)
+/* estimates the size of the four-stream data in bits, including the stream table */
+static uint64_t streams_len(const struct cmp_encoder *enc_init,
+			    const struct preprocessing_method *preprocess,
+			    const struct sample_desc *src_desc, void *work_buf, uint32_t n_values)
 {
-	uint32_t error;
-	struct sample_desc src_desc;
+	uint32_t i, j;
+	uint64_t bits = CMP_STREAM_TABLE_SIZE * 8;
+
+	for (j = 0; j < CMP_NUM_STREAMS; j++) {
+		struct cmp_encoder enc = *enc_init;
+		uint64_t stream_bits = 0;
+
+		train_encoder(&enc, preprocess, src_desc, work_buf, j, n_values, CMP_NUM_STREAMS);
+		for (i = j; i < n_values; i += CMP_NUM_STREAMS)
+			stream_bits += cmp_encoder_len_s16(
+				&enc, preprocess->process(i, src_desc, work_buf));
+		stream_bits += cmp_encoder_len_flush(&enc);
+		bits += DIV_ROUND_UP(stream_bits, 8) * 8;
+	}
+	return bits;
+}
 
-	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16);
-	if (cmp_is_error(error))
-		return error;
 
-	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc);
+/* writes the byte sizes of all but the last channel */
+static void write_channel_table(struct bitstream_writer *bs, const uint32_t *channel_sizes)
+{
+	int c;
+
+	for (c = 0; c < CMP_NUM_CHANNELS - 1; c++)
+		bitstream_add_bits32(bs, channel_sizes[c], CMP_HDR_BITS_STREAM_SIZE);
 }
 
 
-uint32_t cmp_compress_i16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-			  const int16_t *src, uint32_t src_size)
+/*
+ * Encodes the preprocessed values of a channel into a byte-aligned sub-stream
+ * with an own copy of the initialised encoder; stops at the first buffer
+ * overflow if stop_on_overflow is non-zero
+ */
+static void encode_channel(const struct cmp_context *ctx, struct bitstream_writer *bs,
+			   const struct cmp_encoder *enc_init, const struct cmp_pass_params *pass,
+			   const struct preprocessing_method *preprocess,
+			   const struct cmp_channel *ch, int update_model, int stop_on_overflow)
 {
-	uint32_t error;
-	struct sample_desc src_desc;
+	struct cmp_encoder enc = *enc_init;
+	uint32_t i;
 
-	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16);
-	if (cmp_is_error(error))
-		return error;
+	train_encoder(&enc, preprocess, &ch->desc, ch->work_buf, 0, ch->n_values, 1);
+	for (i = 0; i < ch->n_values; i++) {
+		int16_t const value = preprocess->process(i, &ch->desc, ch->work_buf);
+
+		cmp_encoder_encode_s16(&enc, value, bs);
+		if (stop_on_overflow && cmp_is_error_int(bitstream_error(bs)))
+			break;
 
-	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc);
+		if (update_model)
+			update_model_sample(ctx, pass, preprocess, ch, i);
+	}
+	cmp_encoder_flush(&enc, bs);
+	bitstream_pad_to_byte(bs);
 }
 
 
-uint32_t cmp_compress_i16_in_i32(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-				 const int32_t *src, uint32_t src_size)
+/* worst-case size of the byte-aligned sub-stream of a channel in bytes */
+static uint64_t channel_bound(const struct cmp_channel *ch)
 {
-	uint32_t error;
-	struct sample_desc src_desc;
+	return cmp_encoder_max_compressed_size(get_packed_size(&ch->desc)) + CMP_DST_ALIGNMENT;
+}
 
-	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16_IN_I32);
-	if (cmp_is_error(error))
-		return error;
 
-	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc);
+/*
+ * Encodes both channels of CMP_2xI16_IN_I32 data in one loop over the source
+ * words, so that every word is read once instead of once per channel; the
+ * second channel is written into the upper part of the buffer and appended to
+ * the first one afterwards. The buffer has to hold both channels in the worst
+ * case.
+ */
+static uint32_t encode_channel_pair(const struct cmp_context *ctx, struct bitstream_writer *bs,
+				    const struct cmp_encoder *enc_init,
+				    const struct cmp_pass_params *pass,
+				    const struct preprocessing_method *preprocess,
+				    const struct cmp_channel *channels, int update_model,
+				    uint32_t *channel_sizes)
+{
+	struct cmp_encoder enc[CMP_NUM_CHANNELS];
+	struct bitstream_writer upper;
+	uint32_t i, start, ret;
+	unsigned int c;
+
+	compile_time_assert(CMP_NUM_CHANNELS == 2, channel_pair_needs_two_channels);
+
+	start = bitstream_size(bs);
+	ret = bitstream_split(bs, &upper, (uint32_t)channel_bound(&channels[1]));
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	for (c = 0; c < CMP_NUM_CHANNELS; c++) {
+		enc[c] = *enc_init;
+		train_encoder(&enc[c], preprocess, &channels[c].desc, channels[c].work_buf, 0,
+			      channels[c].n_values, 1);
+	}
+
+	/* both channels have a value for every word */
+	for (i = 0; i < channels[0].n_values; i++) {
+		cmp_encoder_encode_s16(&enc[0], preprocess->process(i, &channels[0].desc,
+								    channels[0].work_buf), bs);
+		cmp_encoder_encode_s16(&enc[1], preprocess->process(i, &channels[1].desc,
+								    channels[1].work_buf), &upper);
+		if (update_model) {
+			update_model_sample(ctx, pass, preprocess, &channels[0], i);
+			update_model_sample(ctx, pass, preprocess, &channels[1], i);
+		}
+	}
+
+	for (c = 0; c < CMP_NUM_CHANNELS; c++) {
+		struct bitstream_writer *out = c == 0 ? bs : &upper;
+
+		cmp_encoder_flush(&enc[c], out);
+		bitstream_pad_to_byte(out);
+	}
+	channel_sizes[0] = bitstream_size(bs) - start;
+	channel_sizes[1] = bitstream_size(&upper);
+
+	return bitstream_join(bs, &upper);
+}
+
+
+/* estimates the size of the byte-aligned sub-stream of a channel in bits */
+static uint64_t channel_len(const struct cmp_encoder *enc_init,
+			    const struct preprocessing_method *preprocess,
+			    const struct cmp_channel *ch)
+{
+	struct cmp_encoder enc = *enc_init;
+	uint64_t bits = 0;
+	uint32_t i;
+
+	train_encoder(&enc, preprocess, &ch->desc, ch->work_buf, 0, ch->n_values, 1);
+	for (i = 0; i < ch->n_values; i++)
+		bits += cmp_encoder_len_s16(&enc, preprocess->process(i, &ch->desc, ch->work_buf));
+	bits += cmp_encoder_len_flush(&enc);
+	return DIV_ROUND_UP(bits, 8) * 8;
+}
+
+
+/*
+ * number of the values of a channel from first on fitting into the data_bits
+ * bits of a packet following the packet header
+ */
+static uint32_t packet_fill(const struct cmp_encoder *enc_init,
+			    const struct preprocessing_method *preprocess,
+			    const struct cmp_channel *ch, uint32_t first, uint64_t data_bits)
+{
+	struct cmp_encoder enc = *enc_init;
+	uint64_t bits = 0;
+	uint32_t i;
+
+	for (i = first; i < ch->n_values && i - first < CMP_PACKET_MAX_SAMPLES; i++) {
+		bits += cmp_encoder_len_s16(&enc, preprocess->process(i, &ch->desc, ch->work_buf));
+		if (bits + cmp_encoder_len_flush(&enc) > data_bits)
+			break;
+	}
+	return i - first;
+}
+
+
+/*
+ * Encodes the preprocessed values of a channel into packets of packet_size
+ * bytes, see the packetized layout in cmp_header.h; if bs is NULL, only the
+ * number of packets is counted
+ *
+ * returns the number of packets or an error code
+ */
+static uint32_t encode_packets(struct bitstream_writer *bs, const struct cmp_encoder *enc_init,
+			       const struct preprocessing_method *preprocess,
+			       const struct cmp_channel *ch, uint32_t packet_size)
+{
+	uint64_t const data_bits = (uint64_t)(packet_size - CMP_PACKET_HDR_SIZE) * 8;
+	struct cmp_encoder trained = *enc_init;
+	uint32_t first, n, i, n_packets = 0;
+
+	/* every packet holds the static model of the whole frame */
+	train_encoder(&trained, preprocess, &ch->desc, ch->work_buf, 0, ch->n_values, 1);
+	for (first = 0; first < ch->n_values; first += n) {
+		struct cmp_encoder enc;
+		uint16_t state = 0;
+		uint32_t start, size;
+
+		n = packet_fill(&trained, preprocess, ch, first, data_bits);
+		if (n == 0) /* not even a single sample fits */
+			return CMP_ERROR(PARAMS_INVALID);
+		n_packets++;
+		if (!bs)
+			continue;
+
+		/* every packet starts with the trained encoder */
+		enc = trained;
+		if (first > 0)
+			state = (uint16_t)sample_read_i16(&ch->desc, first - 1);
+		start = bitstream_size(bs);
+		bitstream_add_bits32(bs, first, CMP_PACKET_BITS_INDEX);
+		bitstream_add_bits32(bs, n, CMP_PACKET_BITS_N_SAMPLES);
+		bitstream_add_bits32(bs, state, CMP_PACKET_BITS_STATE);
+		for (i = first; i < first + n; i++)
+			cmp_encoder_encode_s16(&enc, preprocess->process(i, &ch->desc, ch->work_buf),
+					       bs);
+		cmp_encoder_flush(&enc, bs);
+		bitstream_pad_to_byte(bs);
+
+		for (size = bitstream_size(bs); !cmp_is_error_int(size) && size - start < packet_size;
+		     size = bitstream_size(bs)) {
+			uint32_t const pad_bytes = packet_size - (size - start);
+
+			bitstream_add_bits32(bs, 0, pad_bytes < 4 ? pad_bytes * 8 : 32);
+		}
+		if (cmp_is_error_int(size))
+			return size;
+	}
+	return n_packets;
+}
+
+
+/* fast shortcut for uncompressed data; assume model has sufficient size*/
+static void write_uncompressed(struct bitstream_writer *bs, const struct sample_desc *src_desc,
+			       int16_t *model)
+{
+	/* the array functions need a 64-bit aligned bitstream */
+	int const aligned = bitstream_size(bs) % 8 == 0;
+	uint32_t i;
+
+	if (aligned && src_desc->stride == sizeof(int16_t) && !src_desc->segments) {
+		bitstream_add_be16_array(bs, src_desc->data, src_desc->num_samples);
+		if (model)
+			memcpy(model, src_desc->data, get_packed_size(src_desc));
+		return;
+	}
+
+	if (aligned && src_desc->dtype == CMP_I16_IN_I32 && src_desc->stride == sizeof(int32_t) &&
+	    src_desc->shift == 0 && !src_desc->segments)
+		bitstream_add_be16_in_32_array(bs, src_desc->data, src_desc->num_samples);
+	else
+		for (i = 0; i < src_desc->num_samples; i++)
+			bitstream_add_bits32(bs, (uint16_t)sample_read_i16(src_desc, i), 16);
+
+	if (model)
+		for (i = 0; i < src_desc->num_samples; i++)
+			model[i] = sample_read_i16(src_desc, i);
+}
+
+
+/* sets the header fields of a frame except the compressed size and the flags */
+static void fill_frame_hdr(const struct cmp_context *ctx, const struct sample_desc *src_desc,
+			   const struct cmp_pass_params *pass, const struct cmp_encoder *enc,
+			   struct cmp_hdr *hdr)
+{
+	hdr->version = CMP_VERSION_NUMBER;
+	hdr->original_size = get_packed_size(src_desc);
+	if (ctx->params.checksum_enabled)
+		hdr->checksum = cmp_hdr_checksum_int(src_desc);
+	else
+		hdr->checksum = 0;
+	hdr->identifier = ctx->identifier;
+	hdr->sequence_number = ctx->sequence_number;
+	hdr->preprocessing = pass->preprocessing;
+	hdr->encoder_type = pass->encoder_type;
+	hdr->original_dtype = src_desc->dtype;
+	hdr->width = ctx->params.width;
+	hdr->preprocess_param = pass->preprocess_param;
+	hdr->near_lossless_delta = pass->near_lossless_delta;
+	hdr->n_bits = ctx->params.n_bits;
+	hdr->packet_size = pass->packet_size;
+	if (pass->encoder_type != CMP_ENCODER_UNCOMPRESSED) {
+		hdr->encoder_param = pass->encoder_param;
+		hdr->encoder_outlier = enc->outlier;
+	}
+}
+
+
+/*
+ * upper bound of the compressed size of a frame, independent of the destination
+ * capacity; sets the width of the compressed size field of a compact header
+ */
+static uint32_t frame_size_limit(const struct sample_desc *src_desc,
+				 const struct cmp_pass_params *pass)
+{
+	uint64_t limit = CMP_HDR_SIZE;
+
+	if (pass->packet_size) /* every packet holds at least one sample */
+		limit += (uint64_t)src_desc->num_samples * pass->packet_size;
+	else /* the largest table and the stream padding */
+		limit += cmp_encoder_max_compressed_size(get_packed_size(src_desc)) +
+			 CMP_STREAM_TABLE_SIZE + CMP_NUM_STREAMS;
+
+	if (limit > CMP_HDR_MAX_COMPRESSED_SIZE)
+		return CMP_HDR_MAX_COMPRESSED_SIZE;
+	return (uint32_t)limit;
+}
+
+
+/*
+ * non-zero if the frame gets a compact header, i.e. all fields missing in a
+ * compact header match the last full header of the sequence
+ */
+static int hdr_is_compact(const struct cmp_context *ctx, const struct cmp_hdr *hdr)
+{
+	struct cmp_hdr seq_hdr;
+
+	if (!ctx->params.compact_header_enabled || ctx->sequence_number == 0)
+		return 0;
+	if (cmp_is_error_int(cmp_hdr_deserialize(ctx->sequence_hdr, CMP_HDR_SIZE, &seq_hdr)))
+		return 0;
+
+	return hdr->version == seq_hdr.version && hdr->identifier == seq_hdr.identifier &&
+	       hdr->preprocessing == seq_hdr.preprocessing &&
+	       hdr->encoder_type == seq_hdr.encoder_type &&
+	       hdr->encoder_param == seq_hdr.encoder_param &&
+	       hdr->encoder_outlier == seq_hdr.encoder_outlier &&
+	       hdr->original_dtype == seq_hdr.original_dtype &&
+	       hdr->preprocess_param == seq_hdr.preprocess_param &&
+	       hdr->encoder_flags == seq_hdr.encoder_flags && hdr->width == seq_hdr.width &&
+	       hdr->temporal_levels == seq_hdr.temporal_levels &&
+	       hdr->temporal_wavelet == seq_hdr.temporal_wavelet &&
+	       hdr->near_lossless_delta == seq_hdr.near_lossless_delta &&
+	       hdr->n_bits == seq_hdr.n_bits && hdr->packet_size == seq_hdr.packet_size;
+}
+
+
+/* size of the compact or full header of a frame */
+static uint32_t frame_hdr_size(const struct cmp_context *ctx, const struct cmp_hdr *hdr,
+			       uint32_t size_limit)
+{
+	if (hdr_is_compact(ctx, hdr))
+		return cmp_hdr_compact_size(hdr, size_limit);
+	return CMP_HDR_SIZE;
+}
+
+
+/* writes the compact or full header of a frame; returns its size */
+static uint32_t write_frame_hdr(const struct cmp_context *ctx, struct bitstream_writer *bs,
+				const struct cmp_hdr *hdr, uint32_t size_limit)
+{
+	if (hdr_is_compact(ctx, hdr))
+		return cmp_hdr_serialize_compact(bs, hdr, size_limit);
+	return cmp_hdr_serialize(bs, hdr);
+}
+
+
+/* overwrites the stream or channel table placeholder following the header */
+static void patch_table(uint8_t *table, const uint32_t *sizes, int n_entries)
+{
+	int j, shift;
+
+	for (j = 0; j < n_entries; j++)
+		for (shift = CMP_HDR_BITS_STREAM_SIZE - 8; shift >= 0; shift -= 8)
+			*table++ = (uint8_t)(sizes[j] >> shift);
+}
+
+
+/*
+ * Main compression loop; with a sink the header and the stream or channel
+ * table are written into dst and the rest of the frame is passed to the sink.
+ * With continue_pass set the frame is compressed in the current pass: a primary
+ * pass does not reset the context and the sequence number is not advanced, the
+ * caller advances it once all frames of the pass are compressed.
+ */
+static uint32_t compress_engine(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				const struct sample_desc *src_desc, const struct cmp_sink *sink,
+				int continue_pass)
+{
+	uint32_t i, ret;
+	unsigned int c, n_channels;
+	struct cmp_channel channels[CMP_NUM_CHANNELS];
+	struct cmp_pass_params pass;
+	struct bitstream_writer bs;
+	struct cmp_encoder enc;
+	const struct preprocessing_method *preprocess = NULL;
+	int update_model;
+	struct cmp_hdr hdr = { 0 };
+	uint32_t compress_bound;
+	uint32_t stream_sizes[CMP_NUM_STREAMS] = { 0 };
+	uint32_t channel_sizes[CMP_NUM_CHANNELS] = { 0 };
+	uint32_t size_limit, hdr_size = 0;
+	int four_streams, channel_table;
+
+	n_channels = get_channels(ctx, src_desc, channels);
+	get_pass_params(ctx, &channels[0].desc, &pass);
+	if (pass.packet_size && n_channels > 1)
+		return CMP_ERROR(PARAMS_INVALID);
+	if (is_primary_pass(ctx)) {
+		if (!continue_pass) {
+			ret = cmp_reset(ctx);
+			if (cmp_is_error_int(ret))
+				return ret;
+		}
+		ctx->model_size = get_packed_size(src_desc);
+	} else {
+		/*
+		 * When using model preprocessing the size of the data to
+		 * compression is not allowed to change unit a reset.
+		 */
+		if (model_is_needed(&ctx->params) && get_packed_size(src_desc) != ctx->model_size)
+			return CMP_ERROR(SRC_SIZE_MISMATCH);
+	}
+
+	update_model = model_is_needed(&ctx->params);
+	if (update_model && !channels_hold_model(channels, n_channels))
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+
+	if (sink)
+		ret = bitstream_writer_init_sink(&bs, sink);
+	else
+		ret = bitstream_writer_init(&bs, dst, dst_capacity);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	if (!is_raw_copy(&pass)) {
+		preprocess = get_preprocessing(pass.preprocessing, pass.near_lossless_delta);
+		if (preprocess == NULL)
+			return CMP_ERROR(PARAMS_INVALID);
+
+		for (c = 0; c < n_channels; c++) {
+			struct cmp_channel *ch = &channels[c];
+
+			ch->n_values = preprocess->init(&ch->desc, ch->work_buf, ch->work_buf_size,
+							init_param(&pass));
+			if (cmp_is_error_int(ch->n_values))
+				return ch->n_values;
+		}
+
+		if (pass.encoder_param == CMP_ENCODER_PARAM_AUTO)
+			pass.encoder_param = select_encoder_param(&pass, preprocess, channels,
+								  n_channels);
+	}
+
+	ret = cmp_encoder_init(&enc, pass.encoder_type, pass.encoder_param, pass.outlier);
+	if (cmp_is_error_int(ret))
+		return ret;
+	ret = cmp_encoder_set_n_bits(&enc, pass.n_bits);
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (ctx->params.zero_run_enabled && cmp_encoder_enable_zero_run(&enc))
+		hdr.encoder_flags |= CMP_HDR_FLAG_ZERO_RUN;
+	four_streams = ctx->params.four_streams_enabled && !is_raw_copy(&pass) && n_channels == 1 &&
+		       !pass.packet_size;
+	/* the sizes of uncompressed channels are implied by the number of samples */
+	channel_table = n_channels > 1 && pass.encoder_type != CMP_ENCODER_UNCOMPRESSED;
+
+	fill_frame_hdr(ctx, src_desc, &pass, &enc, &hdr);
+	hdr.compressed_size = 0; /* place holder, not know right now */
+	size_limit = frame_size_limit(src_desc, &pass);
+
+	if (four_streams) {
+		hdr.encoder_flags |= CMP_HDR_FLAG_FOUR_STREAMS;
+		if (!sink) {
+			hdr_size = write_frame_hdr(ctx, &bs, &hdr, size_limit);
+			if (cmp_is_error_int(hdr_size))
+				return hdr_size;
+			write_stream_table(&bs, stream_sizes); /* place holder */
+		}
+
+		ret = encode_streams(&bs, &enc, preprocess, &channels[0].desc,
+				     channels[0].work_buf, channels[0].n_values, stream_sizes);
+		/* the last bits may still be in the cache of the writer */
+		if (!cmp_is_error_int(ret) && !sink && bitstream_size(&bs) > dst_capacity)
+			ret = CMP_ERROR(DST_TOO_SMALL);
+		/*
+		 * A writer with a sink drains its buffer instead of reporting
+		 * DST_TOO_SMALL, dst is then only the header buffer; the
+		 * layout of a sink frame is chosen by cmp_compress_generic().
+		 */
+		if (!sink && cmp_get_error_code(ret) == CMP_ERR_DST_TOO_SMALL) {
+			/*
+			 * The stream table and the stream padding do not fit;
+			 * start over with the more compact single-stream layout.
+			 * estimate_frame_size() takes the same decision.
+			 */
+			four_streams = 0;
+			hdr.encoder_flags &= ~(uint32_t)CMP_HDR_FLAG_FOUR_STREAMS;
+			ret = bitstream_writer_init(&bs, dst, dst_capacity);
+		}
+		if (cmp_is_error_int(ret))
+			return ret;
+
+		if (four_streams && update_model)
+			for (i = 0; i < channels[0].n_values; i++)
+				update_model_sample(ctx, &pass, preprocess, &channels[0], i);
+	}
+
+	if (!four_streams) {
+		if (!sink) {
+			hdr_size = write_frame_hdr(ctx, &bs, &hdr, size_limit);
+			if (cmp_is_error_int(hdr_size))
+				return hdr_size;
+			if (channel_table)
+				write_channel_table(&bs, channel_sizes); /* place holder */
+		}
+
+		compress_bound = cmp_compress_bound(get_packed_size(src_desc));
+		if (cmp_is_error_int(compress_bound))
+			compress_bound = ~0U;
+
+		if (pass.packet_size) {
+			ret = encode_packets(&bs, &enc, preprocess, &channels[0], pass.packet_size);
+			if (cmp_is_error_int(ret))
+				return ret;
+		} else if (n_channels == CMP_NUM_CHANNELS && !is_raw_copy(&pass) && !sink &&
+			   bitstream_size(&bs) + channel_bound(&channels[0]) +
+			   channel_bound(&channels[1]) <= dst_capacity) {
+			ret = encode_channel_pair(ctx, &bs, &enc, &pass, preprocess, channels,
+						  update_model, channel_sizes);
+			if (cmp_is_error_int(ret))
+				return ret;
+		} else {
+			/* a sink or a small dst can not hold both channels at once */
+			for (c = 0; c < n_channels; c++) {
+				uint32_t const start = bitstream_size(&bs);
+
+				if (is_raw_copy(&pass))
+					write_uncompressed(&bs, &channels[c].desc,
+							   update_model ? channels[c].work_buf
+									: NULL);
+				else
+					encode_channel(ctx, &bs, &enc, &pass, preprocess,
+						       &channels[c], update_model,
+						       !sink && dst_capacity < compress_bound);
+				channel_sizes[c] = bitstream_size(&bs) - start;
+			}
+		}
+	}
+
+	if (sink) {
+		uint32_t head_size = frame_hdr_size(ctx, &hdr, size_limit);
+
+		if (four_streams)
+			head_size += CMP_STREAM_TABLE_SIZE;
+		else if (channel_table)
+			head_size += CMP_CHANNEL_TABLE_SIZE;
+
+		/* the sink got the data, the header and the table go into dst */
+		ret = bitstream_sink_close(&bs);
+		if (cmp_is_error_int(ret))
+			return ret;
+		if (ret > CMP_HDR_MAX_COMPRESSED_SIZE - head_size)
+			return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+		hdr.compressed_size = head_size + ret;
+
+		ret = bitstream_writer_init(&bs, dst, dst_capacity);
+		if (cmp_is_error_int(ret))
+			return ret;
+		hdr_size = write_frame_hdr(ctx, &bs, &hdr, size_limit);
+		if (cmp_is_error_int(hdr_size))
+			return hdr_size;
+		if (four_streams)
+			write_stream_table(&bs, stream_sizes);
+		else if (channel_table)
+			write_channel_table(&bs, channel_sizes);
+		ret = bitstream_flush(&bs);
+		if (cmp_is_error_int(ret))
+			return ret;
+	} else {
+		hdr.compressed_size = bitstream_flush(&bs);
+		if (cmp_is_error_int(hdr.compressed_size))
+			return hdr.compressed_size;
+
+		/* now that the sizes are known, patch the place holders in place */
+		ret = cmp_hdr_patch_compressed_size(dst, hdr.compressed_size, hdr.compressed_size);
+		if (cmp_is_error_int(ret))
+			return ret;
+		if (four_streams)
+			patch_table((uint8_t *)dst + hdr_size, stream_sizes, CMP_NUM_STREAMS - 1);
+		else if (channel_table)
+			patch_table((uint8_t *)dst + hdr_size, channel_sizes, CMP_NUM_CHANNELS - 1);
+	}
+
+	/* a full header is the reference of the following compact headers */
+	if (hdr_size == CMP_HDR_SIZE)
+		memcpy(ctx->sequence_hdr, dst, CMP_HDR_SIZE);
+	if (!continue_pass)
+		ctx->sequence_number++;
+	return hdr.compressed_size;
+}
+
+
+/*
+ * size of a frame holding the samples uncompressed with n_bits bits each; every
+ * channel is byte-aligned
+ */
+static uint32_t uncompressed_frame_size(const struct sample_desc *src_desc, uint32_t n_bits)
+{
+	uint32_t const n_channels = src_desc->dtype == CMP_2xI16_IN_I32 ? CMP_NUM_CHANNELS : 1;
+	uint64_t const channel_bits = (uint64_t)(src_desc->num_samples / n_channels) * n_bits;
+
+	return CMP_HDR_SIZE + n_channels * (uint32_t)DIV_ROUND_UP(channel_bits, 8);
+}
+
+
+/* non-zero if every sample fits into n_bits bits of its data type */
+static int samples_fit_n_bits(const struct sample_desc *src_desc, uint32_t n_bits)
+{
+	int32_t const max = (int32_t)(1UL << (n_bits - 1)) - 1;
+	uint32_t i;
+
+	if (n_bits >= CMP_NUM_BITS_PER_SAMPLE)
+		return 1;
+
+	for (i = 0; i < src_desc->num_samples; i++) {
+		int16_t const sample = sample_read_i16(src_desc, i);
+
+		if (src_desc->dtype == CMP_U16) {
+			if ((uint16_t)sample >> n_bits)
+				return 0;
+		} else if (sample > max || sample < -max - 1) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Sets up the analysis of the next compression pass of an initialised
+ *	source data descriptor without changing the context
+ *
+ * Performs the same checks in the same order as compress_engine() does.
+ *
+ * @param ctx		pointer to a valid compression context
+ * @param src_desc	initialised source data descriptor
+ * @param channels	array of CMP_NUM_CHANNELS channels to set up
+ * @param n_channels	pointer where the number of channels is stored
+ * @param pass		pointer where the parameters of the next pass are stored
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t analysis_setup(const struct cmp_context *ctx, struct sample_desc *src_desc,
+			       struct cmp_channel *channels, unsigned int *n_channels,
+			       struct cmp_pass_params *pass)
+{
+	uint32_t packed_size;
+
+	apply_frame_width(src_desc, &ctx->params);
+	packed_size = get_packed_size(src_desc);
+	*n_channels = get_channels(ctx, src_desc, channels);
+
+	get_pass_params(ctx, &channels[0].desc, pass);
+	if (pass->packet_size && *n_channels > 1)
+		return CMP_ERROR(PARAMS_INVALID);
+	if (!is_primary_pass(ctx) && model_is_needed(&ctx->params) &&
+	    packed_size != ctx->model_size)
+		return CMP_ERROR(SRC_SIZE_MISMATCH);
+
+	if (model_is_needed(&ctx->params) && !channels_hold_model(channels, *n_channels))
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/* size of the header the next compression pass writes */
+static uint32_t estimate_hdr_size(const struct cmp_context *ctx, struct sample_desc *src_desc,
+				  const struct cmp_pass_params *pass, const struct cmp_encoder *enc,
+				  struct cmp_hdr *hdr)
+{
+	/* a primary pass starts a new sequence with a full header */
+	if (!ctx->params.compact_header_enabled || is_primary_pass(ctx))
+		return CMP_HDR_SIZE;
+
+	fill_frame_hdr(ctx, src_desc, pass, enc, hdr);
+	return frame_hdr_size(ctx, hdr, frame_size_limit(src_desc, pass));
+}
+
+
+/*
+ * estimates the size of the frame the next compression pass writes into a
+ * buffer of dst_capacity bytes without the uncompressed fallback; like
+ * compress_engine(), the four-stream layout is only used if it fits into the
+ * buffer, which is stored in four_streams
+ */
+static uint32_t estimate_frame_size(const struct cmp_context *ctx, struct sample_desc *src_desc,
+				    uint32_t dst_capacity, uint64_t *size, int *four_streams)
+{
+	struct cmp_channel channels[CMP_NUM_CHANNELS];
+	struct cmp_pass_params pass;
+	struct cmp_encoder enc;
+	const struct preprocessing_method *preprocess = NULL;
+	unsigned int c, n_channels;
+	uint32_t ret, packed_size;
+	struct cmp_hdr hdr = { 0 };
+	uint64_t bits = 0;
+
+	ret = analysis_setup(ctx, src_desc, channels, &n_channels, &pass);
+	if (cmp_is_error_int(ret))
+		return ret;
+	packed_size = get_packed_size(src_desc);
+
+	if (!is_raw_copy(&pass)) {
+		preprocess = get_preprocessing(pass.preprocessing, pass.near_lossless_delta);
+		if (preprocess == NULL)
+			return CMP_ERROR(PARAMS_INVALID);
+
+		for (c = 0; c < n_channels; c++) {
+			struct cmp_channel *ch = &channels[c];
+
+			ch->n_values = preprocess->init(&ch->desc, ch->work_buf, ch->work_buf_size,
+							init_param(&pass));
+			if (cmp_is_error_int(ch->n_values))
+				return ch->n_values;
+		}
+
+		if (pass.encoder_param == CMP_ENCODER_PARAM_AUTO)
+			pass.encoder_param = select_encoder_param(&pass, preprocess, channels,
+								  n_channels);
+	}
+
+	ret = cmp_encoder_init(&enc, pass.encoder_type, pass.encoder_param, pass.outlier);
+	if (cmp_is_error_int(ret))
+		return ret;
+	ret = cmp_encoder_set_n_bits(&enc, pass.n_bits);
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (ctx->params.zero_run_enabled && cmp_encoder_enable_zero_run(&enc))
+		hdr.encoder_flags |= CMP_HDR_FLAG_ZERO_RUN;
+
+	if (packed_size > CMP_HDR_MAX_ORIGINAL_SIZE)
+		return CMP_ERROR(HDR_ORIGINAL_TOO_LARGE);
+
+	*four_streams = ctx->params.four_streams_enabled && !is_raw_copy(&pass) &&
+			n_channels == 1 && !pass.packet_size;
+	if (*four_streams) {
+		hdr.encoder_flags |= CMP_HDR_FLAG_FOUR_STREAMS;
+		bits = streams_len(&enc, preprocess, &channels[0].desc, channels[0].work_buf,
+				   channels[0].n_values);
+		if (estimate_hdr_size(ctx, src_desc, &pass, &enc, &hdr) + DIV_ROUND_UP(bits, 8) >
+		    dst_capacity) {
+			*four_streams = 0;
+			hdr.encoder_flags &= ~(uint32_t)CMP_HDR_FLAG_FOUR_STREAMS;
+		}
+	}
+
+	if (*four_streams) {
+		/* bits are already known */
+	} else if (is_raw_copy(&pass)) {
+		bits = (uint64_t)packed_size * 8;
+	} else if (pass.packet_size) {
+		ret = encode_packets(NULL, &enc, preprocess, &channels[0], pass.packet_size);
+		if (cmp_is_error_int(ret))
+			return ret;
+		bits = (uint64_t)ret * pass.packet_size * 8;
+	} else {
+		bits = 0;
+		if (n_channels > 1 && pass.encoder_type != CMP_ENCODER_UNCOMPRESSED)
+			bits += CMP_CHANNEL_TABLE_SIZE * 8;
+		for (c = 0; c < n_channels; c++)
+			bits += channel_len(&enc, preprocess, &channels[c]);
+	}
+
+	*size = estimate_hdr_size(ctx, src_desc, &pass, &enc, &hdr) + DIV_ROUND_UP(bits, 8);
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/*
+ * implements uncompressed fallback; continue_pass compresses the frame in the
+ * current pass, see compress_engine()
+ */
+static uint32_t cmp_compress_generic(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				     struct sample_desc *src_desc, const struct cmp_sink *sink,
+				     int continue_pass)
+{
+	uint32_t uncompressed_size;
+	enum cmp_preprocessing saved_preprocessing, saved_secondary_preprocessing;
+	enum cmp_encoder_type saved_encoder_type, saved_secondary_encoder_type;
+	uint32_t saved_near_lossless_delta;
+	uint32_t ret;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (cmp_is_error_int(dst_capacity))
+		return CMP_ERROR(GENERIC);
+
+	apply_frame_width(src_desc, &ctx->params);
+	if (!samples_fit_n_bits(src_desc, sample_n_bits(&ctx->params)))
+		return CMP_ERROR(SRC_VALUE_TOO_LARGE);
+	uncompressed_size = uncompressed_frame_size(src_desc, sample_n_bits(&ctx->params));
+
+	if (sink) {
+		uint64_t size;
+		int four_streams;
+		uint8_t const saved_four_streams = ctx->params.four_streams_enabled;
+
+		if (!fallback_is_enabled(&ctx->params))
+			return compress_engine(ctx, dst, dst_capacity, src_desc, sink, continue_pass);
+		/*
+		 * Data passed to the sink can not be taken back, so decide
+		 * beforehand with an estimate if the data are stored
+		 * uncompressed and if the four streams fit, as the engine
+		 * does without a sink.
+		 */
+		ret = estimate_frame_size(ctx, src_desc, uncompressed_size, &size, &four_streams);
+		if (cmp_is_error_int(ret))
+			return ret;
+		if (size <= uncompressed_size) {
+			if (!four_streams)
+				ctx->params.four_streams_enabled = 0;
+			ret = compress_engine(ctx, dst, dst_capacity, src_desc, sink, continue_pass);
+			ctx->params.four_streams_enabled = saved_four_streams;
+			return ret;
+		}
+	} else if (!fallback_is_enabled(&ctx->params) ||
+		   dst_capacity < uncompressed_size) {
+		/* Skip fallback if disabled or output buffer too small for uncompressed */
+		return compress_engine(ctx, dst, dst_capacity, src_desc, NULL, continue_pass);
+	} else {
+		/*
+		 * Try compression with restricted buffer size. If data doesn't
+		 * compress well enough to fit in uncompressed_size bytes, we'll
+		 * get a buffer overflow error and fall back to uncompressed
+		 * storage.
+		 */
+		ret = compress_engine(ctx, dst, uncompressed_size, src_desc, NULL, continue_pass);
+		if (cmp_get_error_code(ret) != CMP_ERR_DST_TOO_SMALL)
+			return ret;
+	}
+
+	/*
+	 * Compression failed - fall back to uncompressed storage.
+	 * Reset context to avoid corrupted model state, then temporarily
+	 * switch to uncompressed mode. A continued pass has no model to
+	 * corrupt and keeps its pass, so its secondary parameters are
+	 * switched as well.
+	 */
+	saved_preprocessing = ctx->params.primary_preprocessing;
+	saved_encoder_type = ctx->params.primary_encoder_type;
+	saved_secondary_preprocessing = ctx->params.secondary_preprocessing;
+	saved_secondary_encoder_type = ctx->params.secondary_encoder_type;
+	saved_near_lossless_delta = ctx->params.near_lossless_delta;
+	if (continue_pass) {
+		ctx->params.secondary_preprocessing = CMP_PREPROCESS_NONE;
+		ctx->params.secondary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	} else {
+		ret = cmp_reset(ctx);
+		if (cmp_is_error_int(ret))
+			return ret;
+	}
+	ctx->params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	ctx->params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	ctx->params.near_lossless_delta = 0;
+
+	if (sink)
+		ret = compress_engine(ctx, dst, dst_capacity, src_desc, sink, continue_pass);
+	else
+		ret = compress_engine(ctx, dst, uncompressed_size, src_desc, NULL, continue_pass);
+
+	ctx->params.primary_preprocessing = saved_preprocessing;
+	ctx->params.primary_encoder_type = saved_encoder_type;
+	ctx->params.secondary_preprocessing = saved_secondary_preprocessing;
+	ctx->params.secondary_encoder_type = saved_secondary_encoder_type;
+	ctx->params.near_lossless_delta = saved_near_lossless_delta;
+	return ret;
+}
+
+
+uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			  const uint16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL, 0);
+}
+
+
+uint32_t cmp_compress_i16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			  const int16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL, 0);
+}
+
+
+uint32_t cmp_compress_i16_in_i32(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				 const int32_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16_IN_I32);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL, 0);
+}
+
+
+uint32_t cmp_compress_2xi16_in_i32(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   const int32_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_2xI16_IN_I32);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL, 0);
+}
+
+
+uint32_t cmp_compress_strided(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			      const void *base, uint32_t n_samples, uint32_t byte_stride,
+			      uint32_t byte_offset, enum cmp_type dtype)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_strided_init(&src_desc, base, n_samples, byte_stride, byte_offset,
+					 dtype);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL, 0);
+}
+
+
+/* implements the compression of non-contiguous data */
+static uint32_t cmp_compress_segments(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				      const struct cmp_segment *segments, uint32_t n_segments,
+				      enum cmp_type src_type)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+	struct sample_segments cursor;
+
+	error = sample_read_segments_init(&src_desc, &cursor, segments, n_segments, src_type);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL, 0);
+}
+
+
+uint32_t cmp_compress_i16v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			   const struct cmp_segment *segments, uint32_t n_segments)
+{
+	return cmp_compress_segments(ctx, dst, dst_capacity, segments, n_segments, CMP_I16);
+}
+
+
+uint32_t cmp_compress_i16_in_i32v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				  const struct cmp_segment *segments, uint32_t n_segments)
+{
+	return cmp_compress_segments(ctx, dst, dst_capacity, segments, n_segments,
+				     CMP_I16_IN_I32);
+}
+
+
+uint32_t cmp_compress_2xi16_in_i32v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				    const struct cmp_segment *segments, uint32_t n_segments)
+{
+	return cmp_compress_segments(ctx, dst, dst_capacity, segments, n_segments,
+				     CMP_2xI16_IN_I32);
+}
+
+
+uint32_t cmp_compress_u16v(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			   const struct cmp_segment *segments, uint32_t n_segments)
+{
+	return cmp_compress_segments(ctx, dst, dst_capacity, segments, n_segments, CMP_U16);
+}
+
+
+uint32_t cmp_compress_sink(struct cmp_context *ctx, void *hdr_buf, uint32_t hdr_buf_size,
+			   uint32_t *hdr_size, const struct cmp_sink *sink, const void *src,
+			   uint32_t src_size, enum cmp_type src_type)
+{
+	uint32_t ret, compressed_size;
+	struct sample_desc src_desc;
+	struct cmp_hdr hdr;
+
+	/* check the head buffer before any data are passed to the sink */
+	if (!hdr_buf || !sink)
+		return CMP_ERROR(DST_NULL);
+	if ((uintptr_t)hdr_buf & (CMP_DST_ALIGNMENT - 1))
+		return CMP_ERROR(DST_UNALIGNED);
+	if (hdr_buf_size < CMP_SINK_HDR_BUF_SIZE)
+		return CMP_ERROR(DST_TOO_SMALL);
+
+	ret = sample_read_src_init(&src_desc, src, src_size, src_type);
+	if (cmp_is_error(ret))
+		return ret;
+
+	compressed_size = cmp_compress_generic(ctx, hdr_buf, hdr_buf_size, &src_desc, sink, 0);
+	if (cmp_is_error_int(compressed_size) || !hdr_size)
+		return compressed_size;
+
+	/* a compact header takes the other fields from the last full header */
+	ret = cmp_hdr_deserialize(ctx->sequence_hdr, CMP_HDR_SIZE, &hdr);
+	if (cmp_is_error_int(ret))
+		return ret;
+	ret = cmp_hdr_deserialize(hdr_buf, CMP_HDR_SIZE, &hdr);
+	if (cmp_is_error_int(ret))
+		return ret;
+	*hdr_size = ret;
+	if (hdr.encoder_flags & CMP_HDR_FLAG_FOUR_STREAMS)
+		*hdr_size += CMP_STREAM_TABLE_SIZE;
+	else if (hdr.original_dtype == CMP_2xI16_IN_I32 &&
+		 hdr.encoder_type != CMP_ENCODER_UNCOMPRESSED)
+		*hdr_size += CMP_CHANNEL_TABLE_SIZE;
+
+	return compressed_size;
+}
+
+
+/**
+ * @brief Marks a compressed frame as a temporal subband
+ *
+ * @param frame		pointer to the 8-byte aligned compressed frame
+ * @param frame_size	size of the compressed frame in bytes
+ * @param params	compression parameters with the temporal settings
+ * @param index		index of the temporal subband held by the frame
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t set_temporal_fields(void *frame, uint32_t frame_size,
+				    const struct cmp_params *params, uint32_t index)
+{
+	struct bitstream_writer bs;
+	struct cmp_hdr hdr;
+	uint8_t *first_byte = frame;
+	uint32_t ret;
+
+	/* the other temporal fields of a compact header are in the full header */
+	if (frame_size > 0 && *first_byte & CMP_HDR_COMPACT_MARKER) {
+		if (index > CMP_HDR_COMPACT_TEMPORAL_MASK)
+			return CMP_ERROR(INT_HDR);
+		*first_byte = (uint8_t)((*first_byte & ~(uint32_t)CMP_HDR_COMPACT_TEMPORAL_MASK) | index);
+		return CMP_ERROR(NO_ERROR);
+	}
+
+	ret = cmp_hdr_deserialize(frame, frame_size, &hdr);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	hdr.temporal_levels = 0;
+	while ((1U << hdr.temporal_levels) < params->temporal_group_size)
+		hdr.temporal_levels++;
+	hdr.temporal_wavelet = params->temporal_wavelet;
+	hdr.temporal_index = index;
+
+	ret = bitstream_writer_init(&bs, frame, CMP_HDR_SIZE);
+	if (cmp_is_error_int(ret))
+		return ret;
+	return cmp_hdr_serialize(&bs, &hdr);
+}
+
+
+uint32_t cmp_compress_group(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			    const void *src, uint32_t src_size, enum cmp_type src_type)
+{
+	struct sample_desc group_desc, subband_desc;
+	uint32_t group_size, frame_samples, subband_offset, t, ret;
+	uint32_t dst_size = 0;
+	int16_t *subbands;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (cmp_is_error_int(dst_capacity))
+		return CMP_ERROR(GENERIC);
+
+	if (dst == NULL)
+		return CMP_ERROR(DST_NULL);
+
+	group_size = ctx->params.temporal_group_size;
+	if (group_size < 2)
+		return CMP_ERROR(PARAMS_INVALID);
+	if (src_type == CMP_2xI16_IN_I32)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	ret = sample_read_src_init(&group_desc, src, src_size, src_type);
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (group_desc.num_samples % group_size != 0)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+	frame_samples = group_desc.num_samples / group_size;
+
+	ret = cmp_cal_work_buf_size(&ctx->params, frame_samples * sizeof(int16_t));
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (ctx->work_buf_size < ret)
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+	subband_offset = ROUND_UP_TO_NEXT_2(
+		preprocess_work_buf_size(&ctx->params, frame_samples * sizeof(int16_t)));
+	subbands = (int16_t *)((uint8_t *)ctx->work_buf + subband_offset);
+
+	preprocessing_temporal_decomposition_i16(&group_desc, frame_samples,
+						 ctx->params.temporal_wavelet, subbands);
+
+	/*
+	 * All subbands are compressed in one pass and share its identifier
+	 * and sequence number, so a group advances the sequence like a single
+	 * frame. The sequence is only advanced when the whole group is
+	 * compressed.
+	 */
+	if (is_primary_pass(ctx)) {
+		ret = cmp_reset(ctx);
+		if (cmp_is_error_int(ret))
+			return ret;
+	}
+
+	for (t = 0; t < group_size; t++) {
+		uint8_t *const frame = (uint8_t *)dst + dst_size;
+		uint32_t frame_size;
+
+		ret = sample_read_src_init(&subband_desc, subbands + t * frame_samples,
+					   frame_samples * (uint32_t)sizeof(int16_t),
+					   src_type == CMP_U16 ? CMP_U16 : CMP_I16);
+		if (cmp_is_error_int(ret))
+			return ret;
+
+		frame_size = cmp_compress_generic(ctx, frame, dst_capacity - dst_size,
+						  &subband_desc, NULL, 1);
+		if (cmp_is_error_int(frame_size))
+			return frame_size;
+
+		ret = set_temporal_fields(frame, frame_size, &ctx->params, t);
+		if (cmp_is_error_int(ret))
+			return ret;
+		dst_size += frame_size;
+
+		/* the next frame has to start 8-byte aligned */
+		if (t + 1 < group_size) {
+			while (dst_size % CMP_DST_ALIGNMENT != 0) {
+				if (dst_size >= dst_capacity)
+					return CMP_ERROR(DST_TOO_SMALL);
+				((uint8_t *)dst)[dst_size++] = 0;
+			}
+		}
+	}
+
+	ctx->sequence_number++;
+	return dst_size;
+}
+
+
+/**
+ * @brief Sets up the analysis of the next compression pass without changing
+ *	the context
+ *
+ * @param ctx		pointer to a compression context
+ * @param src_desc	source data descriptor to initialise
+ * @param src		pointer to the data to analyse
+ * @param src_size	size of the data in bytes
+ * @param src_type	type of the data
+ * @param channels	array of CMP_NUM_CHANNELS channels to set up
+ * @param n_channels	pointer where the number of channels is stored
+ * @param pass		pointer where the parameters of the next pass are stored
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t analysis_init(const struct cmp_context *ctx, struct sample_desc *src_desc,
+			      const void *src, uint32_t src_size, enum cmp_type src_type,
+			      struct cmp_channel *channels, unsigned int *n_channels,
+			      struct cmp_pass_params *pass)
+{
+	uint32_t ret;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	ret = sample_read_src_init(src_desc, src, src_size, src_type);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	return analysis_setup(ctx, src_desc, channels, n_channels, pass);
+}
+
+
+uint32_t cmp_estimate_size(const struct cmp_context *ctx, const void *src, uint32_t src_size,
+			   enum cmp_type src_type)
+{
+	struct sample_desc src_desc;
+	uint32_t ret, uncompressed_size, dst_capacity;
+	uint64_t size;
+	int four_streams;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	ret = sample_read_src_init(&src_desc, src, src_size, src_type);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	/* the capacity cmp_compress_generic() passes to compress_engine() */
+	uncompressed_size = uncompressed_frame_size(&src_desc, sample_n_bits(&ctx->params));
+	dst_capacity = cmp_compress_bound(get_packed_size(&src_desc));
+	if (cmp_is_error_int(dst_capacity))
+		dst_capacity = ~0U;
+	if (fallback_is_enabled(&ctx->params) && dst_capacity >= uncompressed_size)
+		dst_capacity = uncompressed_size;
+
+	ret = estimate_frame_size(ctx, &src_desc, dst_capacity, &size, &four_streams);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	if (fallback_is_enabled(&ctx->params) && size > uncompressed_size)
+		size = uncompressed_size;
+
+	if (size > CMP_HDR_MAX_COMPRESSED_SIZE)
+		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+	return (uint32_t)size;
+}
+
+
+/*
+ * size of a Golomb frame with bits bits of encoded data; like
+ * cmp_estimate_size() the frame can have a compact header
+ */
+static uint32_t golomb_frame_size(const struct cmp_context *ctx, struct sample_desc *src_desc,
+				  const struct cmp_pass_params *pass,
+				  enum cmp_encoder_type encoder_type, uint32_t g_par,
+				  uint32_t outlier, uint64_t bits, uint32_t *size)
+{
+	struct cmp_pass_params golomb_pass = *pass;
+	struct cmp_encoder enc;
+	struct cmp_hdr hdr = { 0 };
+	uint32_t ret;
+
+	golomb_pass.encoder_type = encoder_type;
+	golomb_pass.encoder_param = g_par;
+	golomb_pass.outlier = outlier;
+	ret = cmp_encoder_init(&enc, encoder_type, g_par, outlier);
+	if (cmp_is_error_int(ret))
+		return ret;
+	ret = cmp_encoder_set_n_bits(&enc, golomb_pass.n_bits);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	*size = (uint32_t)(estimate_hdr_size(ctx, src_desc, &golomb_pass, &enc, &hdr) +
+			   DIV_ROUND_UP(bits, 8));
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Builds the cumulative histogram of the mapped residuals of the next
+ *	compression pass
+ *
+ * @param ctx		pointer to a compression context
+ * @param src_desc	source data descriptor to initialise
+ * @param src		pointer to the data to analyse
+ * @param src_size	size of the data in bytes
+ * @param src_type	type of the data
+ * @param hist_buf	pointer to a 4-byte aligned buffer for the histogram
+ * @param hist_buf_size	size of the histogram buffer in bytes
+ * @param pass		pointer where the parameters of the next pass are stored
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t build_cum_hist(const struct cmp_context *ctx, struct sample_desc *src_desc,
+			       const void *src, uint32_t src_size, enum cmp_type src_type,
+			       uint32_t *hist_buf, uint32_t hist_buf_size,
+			       struct cmp_pass_params *pass)
+{
+	compile_time_assert(CMP_HIST_BUF_SIZE == CMP_ENCODER_HIST_ENTRIES * sizeof(uint32_t),
+			    hist_buf_size_mismatch);
+	struct cmp_channel channels[CMP_NUM_CHANNELS];
+	const struct preprocessing_method *preprocess;
+	unsigned int n_channels;
+	uint32_t i, ret, n_values;
+
+	ret = analysis_init(ctx, src_desc, src, src_size, src_type, channels, &n_channels, pass);
+	if (cmp_is_error_int(ret))
+		return ret;
+	/* the channel padding depends on the costs of the single channels */
+	if (n_channels > 1)
+		return CMP_ERROR(PARAMS_INVALID);
+	/* the sizes of these layouts depend on the order of the values */
+	if (ctx->params.zero_run_enabled || ctx->params.four_streams_enabled ||
+	    pass->packet_size)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (!hist_buf)
+		return CMP_ERROR(WORK_BUF_NULL);
+	if (hist_buf_size < CMP_HIST_BUF_SIZE)
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+	if ((uintptr_t)hist_buf & (sizeof(uint32_t) - 1))
+		return CMP_ERROR(WORK_BUF_UNALIGNED);
+
+	preprocess = get_preprocessing(pass->preprocessing, pass->near_lossless_delta);
+	if (preprocess == NULL)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	n_values = preprocess->init(src_desc, ctx->work_buf, ctx->work_buf_size,
+				    init_param(pass));
+	if (cmp_is_error_int(n_values))
+		return n_values;
+
+	/* one pass over the residuals to build the histogram ... */
+	memset(hist_buf, 0, CMP_HIST_BUF_SIZE);
+	for (i = 0; i < n_values; i++) {
+		int16_t const value = preprocess->process(i, src_desc, ctx->work_buf);
+
+		hist_buf[cmp_encoder_map_s16(value, pass->n_bits)]++;
+	}
+
+	/* ... which is converted in place into a cumulative histogram */
+	for (i = 1; i < CMP_ENCODER_HIST_ENTRIES; i++)
+		hist_buf[i] += hist_buf[i - 1];
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_golomb_costs(const struct cmp_context *ctx, const void *src, uint32_t src_size,
+			  enum cmp_type src_type, uint32_t *hist_buf, uint32_t hist_buf_size,
+			  uint32_t param_min, uint32_t param_max, struct cmp_golomb_cost *costs)
+{
+	struct sample_desc src_desc;
+	struct cmp_pass_params pass;
+	uint32_t ret, g_par;
+
+	if (!costs)
+		return CMP_ERROR(GENERIC);
+
+	if (param_min < 1 || param_min > param_max || param_max > UINT16_MAX)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	ret = build_cum_hist(ctx, &src_desc, src, src_size, src_type, hist_buf, hist_buf_size,
+			     &pass);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	for (g_par = param_min; g_par <= param_max; g_par++) {
+		struct cmp_golomb_cost *c = &costs[g_par - param_min];
+		uint64_t zero_bits, multi_bits;
+
+		ret = cmp_encoder_hist_costs(hist_buf, g_par, pass.n_bits, &zero_bits,
+					     &multi_bits, &c->multi_outlier);
+		if (cmp_is_error_int(ret))
+			return ret;
+
+		c->encoder_param = g_par;
+		ret = golomb_frame_size(ctx, &src_desc, &pass, CMP_ENCODER_GOLOMB_ZERO, g_par, 0,
+					zero_bits, &c->zero_size);
+		if (cmp_is_error_int(ret))
+			return ret;
+		ret = golomb_frame_size(ctx, &src_desc, &pass, CMP_ENCODER_GOLOMB_MULTI, g_par,
+					c->multi_outlier, multi_bits, &c->multi_size);
+		if (cmp_is_error_int(ret))
+			return ret;
+	}
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/* encoded bits of the histogram with a Golomb parameter; keeps the best one */
+static uint32_t try_golomb_param(const uint32_t *cum_hist, uint32_t g_par, unsigned int n_bits,
+				 enum cmp_encoder_type encoder_type, uint64_t *best_bits,
+				 uint32_t *best_g_par, uint32_t *best_outlier)
+{
+	uint64_t zero_bits, multi_bits, bits;
+	uint32_t multi_outlier;
+	uint32_t ret;
+
+	ret = cmp_encoder_hist_costs(cum_hist, g_par, n_bits, &zero_bits, &multi_bits,
+				     &multi_outlier);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	bits = encoder_type == CMP_ENCODER_GOLOMB_ZERO ? zero_bits : multi_bits;
+	if (bits < *best_bits) {
+		*best_bits = bits;
+		*best_g_par = g_par;
+		*best_outlier = multi_outlier;
+	}
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Searches the Golomb parameter (and the outlier parameter of
+ *	CMP_ENCODER_GOLOMB_MULTI) giving the fewest encoded bits
+ *
+ * The residuals are preprocessed once into a histogram, like
+ * cmp_golomb_costs() does. Parameters growing by about 1.5x are evaluated over
+ * the whole range first, then the best one is refined with halving steps.
+ *
+ * @param ctx		pointer to a compression context
+ * @param src		pointer to the data to compress
+ * @param src_size	size of the data in bytes
+ * @param src_type	type of the data
+ * @param encoder_type	CMP_ENCODER_GOLOMB_ZERO or CMP_ENCODER_GOLOMB_MULTI
+ * @param hist_buf	pointer to a buffer of CMP_HIST_BUF_SIZE bytes
+ * @param hist_buf_size	size of the histogram buffer in bytes
+ * @param g_par		pointer where the best Golomb parameter is stored
+ * @param outlier	pointer where the best outlier parameter is stored
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t search_golomb_params(const struct cmp_context *ctx, const void *src,
+				     uint32_t src_size, enum cmp_type src_type,
+				     enum cmp_encoder_type encoder_type, uint32_t *hist_buf,
+				     uint32_t hist_buf_size, uint32_t *g_par, uint32_t *outlier)
+{
+	struct sample_desc src_desc;
+	struct cmp_pass_params pass;
+	uint64_t best_bits = UINT64_MAX;
+	uint32_t ret, i, step;
+
+	ret = build_cum_hist(ctx, &src_desc, src, src_size, src_type, hist_buf, hist_buf_size,
+			     &pass);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	for (i = CMP_MIN_GOLOMB_PAR; i <= CMP_MAX_GOLOMB_PAR; i += i / 2 ? i / 2 : 1) {
+		ret = try_golomb_param(hist_buf, i, pass.n_bits, encoder_type, &best_bits, g_par,
+				       outlier);
+		if (cmp_is_error_int(ret))
+			return ret;
+	}
+
+	for (step = *g_par / 4; step > 0; step /= 2) {
+		uint32_t const center = *g_par;
+
+		if (center - CMP_MIN_GOLOMB_PAR >= step) {
+			ret = try_golomb_param(hist_buf, center - step, pass.n_bits, encoder_type,
+					       &best_bits, g_par, outlier);
+			if (cmp_is_error_int(ret))
+				return ret;
+		}
+		if (CMP_MAX_GOLOMB_PAR - center >= step) {
+			ret = try_golomb_param(hist_buf, center + step, pass.n_bits, encoder_type,
+					       &best_bits, g_par, outlier);
+			if (cmp_is_error_int(ret))
+				return ret;
+		}
+		if (*g_par != center)
+			step *= 2; /* keep the step after a move */
+	}
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Sets the near-lossless delta and the encoder parameters of the next
+ *	pass giving the smallest compressed size
+ *
+ * The configured encoder parameter, the one selected with
+ * CMP_ENCODER_PARAM_AUTO and, with a histogram buffer, the best Golomb
+ * parameters found by search_golomb_params() are compared.
+ *
+ * @param ctx		pointer to a compression context
+ * @param near_lossless_delta	near-lossless delta to use
+ * @param src		pointer to the data to compress
+ * @param src_size	size of the data in bytes
+ * @param src_type	type of the data
+ * @param hist_buf	pointer to a buffer for the Golomb parameter search or
+ *			NULL
+ * @param hist_buf_size	size of the histogram buffer in bytes
+ *
+ * @returns the estimated compressed size or an error, which can be checked
+ *	using cmp_is_error()
+ */
+
+static uint32_t budget_try(struct cmp_context *ctx, uint32_t near_lossless_delta,
+			   const void *src, uint32_t src_size, enum cmp_type src_type,
+			   uint32_t *hist_buf, uint32_t hist_buf_size)
+{
+	int const primary = is_primary_pass(ctx);
+	uint32_t *const encoder_param = primary ? &ctx->params.primary_encoder_param
+						: &ctx->params.secondary_encoder_param;
+	uint32_t *const encoder_outlier = primary ? &ctx->params.primary_encoder_outlier
+						  : &ctx->params.secondary_encoder_outlier;
+	enum cmp_encoder_type const encoder_type = primary ? ctx->params.primary_encoder_type
+							   : ctx->params.secondary_encoder_type;
+	uint32_t best_param = *encoder_param;
+	uint32_t best_outlier = *encoder_outlier;
+	uint32_t size, best_size, g_par, outlier;
+
+	ctx->params.near_lossless_delta = near_lossless_delta;
+
+	best_size = cmp_estimate_size(ctx, src, src_size, src_type);
+	if (cmp_is_error_int(best_size))
+		return best_size;
+
+	if (best_param != CMP_ENCODER_PARAM_AUTO) {
+		*encoder_param = CMP_ENCODER_PARAM_AUTO;
+		size = cmp_estimate_size(ctx, src, src_size, src_type);
+		if (!cmp_is_error_int(size) && size < best_size) {
+			best_size = size;
+			best_param = CMP_ENCODER_PARAM_AUTO;
+		}
+	}
+
+	if (hist_buf && (encoder_type == CMP_ENCODER_GOLOMB_ZERO ||
+			 encoder_type == CMP_ENCODER_GOLOMB_MULTI)) {
+		size = search_golomb_params(ctx, src, src_size, src_type, encoder_type, hist_buf,
+					    hist_buf_size, &g_par, &outlier);
+		/* layouts not described by a histogram are not searched */
+		if (cmp_is_error_int(size) && cmp_get_error_code(size) != CMP_ERR_PARAMS_INVALID)
+			return size;
+		if (!cmp_is_error_int(size)) {
+			*encoder_param = g_par;
+			if (encoder_type == CMP_ENCODER_GOLOMB_MULTI)
+				*encoder_outlier = outlier;
+			size = cmp_estimate_size(ctx, src, src_size, src_type);
+			if (!cmp_is_error_int(size) && size < best_size) {
+				best_size = size;
+				best_param = *encoder_param;
+				best_outlier = *encoder_outlier;
+			}
+		}
+	}
+
+	*encoder_param = best_param;
+	*encoder_outlier = best_outlier;
+	return best_size;
+}
+
+
+/* non-zero if the context can compress with a non-zero near-lossless delta */
+static int near_lossless_is_usable(const struct cmp_context *ctx, uint32_t packed_size)
+{
+	struct cmp_params params = ctx->params;
+	uint32_t work_buf_size;
+
+	if (params.temporal_group_size != 0)
+		return 0;
+
+	params.near_lossless_delta = 1;
+	work_buf_size = cmp_cal_work_buf_size(&params, packed_size);
+	return !cmp_is_error_int(work_buf_size) && work_buf_size <= ctx->work_buf_size;
+}
+
+
+/**
+ * @brief Sets the parameters of the next pass for the smallest near-lossless
+ *	delta with which the data fit into the budget
+ *
+ * @param ctx		pointer to a compression context
+ * @param budget	maximum compressed size in bytes
+ * @param src_desc	source data descriptor pointer
+ * @param src		pointer to the data to compress
+ * @param src_size	size of the data in bytes
+ * @param max_near_lossless_delta	largest near-lossless delta to try
+ * @param hist_buf	pointer to a buffer for the Golomb parameter search or
+ *			NULL
+ * @param hist_buf_size	size of the histogram buffer in bytes
+ *
+ * @returns the estimated compressed size or an error, which can be checked
+ *	using cmp_is_error()
+ */
+
+static uint32_t select_budget_params(struct cmp_context *ctx, uint32_t budget,
+				     const struct sample_desc *src_desc, const void *src,
+				     uint32_t src_size, uint32_t max_near_lossless_delta,
+				     uint32_t *hist_buf, uint32_t hist_buf_size)
+{
+	struct cmp_params fitting_params;
+	uint32_t low = ctx->params.near_lossless_delta;
+	uint32_t high = low;
+	uint32_t size, fitting_size;
+
+	if (max_near_lossless_delta > low && near_lossless_is_usable(ctx, get_packed_size(src_desc)))
+		high = min_u32(max_near_lossless_delta, CMP_HDR_MAX_NL_DELTA);
+
+	size = budget_try(ctx, low, src, src_size, src_desc->dtype, hist_buf, hist_buf_size);
+	if (cmp_is_error_int(size) || size <= budget || high == low)
+		return size;
+
+	fitting_size = budget_try(ctx, high, src, src_size, src_desc->dtype, hist_buf,
+				  hist_buf_size);
+	if (cmp_is_error_int(fitting_size) || fitting_size > budget)
+		return fitting_size;
+	fitting_params = ctx->params;
+
+	/*
+	 * A larger delta gives a smaller output, so we binary search the
+	 * smallest delta that fits.
+	 */
+	while (high - low > 1) {
+		uint32_t const mid = low + (high - low) / 2;
+
+		size = budget_try(ctx, mid, src, src_size, src_desc->dtype, hist_buf,
+				  hist_buf_size);
+		if (cmp_is_error_int(size))
+			return size;
+		if (size <= budget) {
+			high = mid;
+			fitting_size = size;
+			fitting_params = ctx->params;
+		} else {
+			low = mid;
+		}
+	}
+
+	ctx->params = fitting_params;
+	return fitting_size;
+}
+
+
+/* implements the rate-controlled compression */
+static uint32_t cmp_compress_budget_generic(struct cmp_context *ctx, void *dst, uint32_t budget,
+					    const void *src, uint32_t src_size,
+					    enum cmp_type src_type,
+					    uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+					    uint32_t hist_buf_size)
+{
+	struct cmp_params saved_params;
+	struct sample_desc src_desc;
+	uint32_t ret;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	ret = sample_read_src_init(&src_desc, src, src_size, src_type);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	saved_params = ctx->params;
+	ret = select_budget_params(ctx, budget, &src_desc, src, src_size,
+				   max_near_lossless_delta, hist_buf, hist_buf_size);
+	if (!cmp_is_error_int(ret)) {
+		if (ret > budget)
+			ret = CMP_ERROR(DST_TOO_SMALL);
+		else
+			ret = cmp_compress_generic(ctx, dst, budget, &src_desc, NULL, 0);
+	}
+	ctx->params = saved_params;
+
+	return ret;
+}
+
+
+uint32_t cmp_compress_i16_budget(struct cmp_context *ctx, void *dst, uint32_t budget,
+				 const int16_t *src, uint32_t src_size,
+				 uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+				 uint32_t hist_buf_size)
+{
+	return cmp_compress_budget_generic(ctx, dst, budget, src, src_size, CMP_I16,
+					   max_near_lossless_delta, hist_buf, hist_buf_size);
+}
+
+
+uint32_t cmp_compress_i16_in_i32_budget(struct cmp_context *ctx, void *dst, uint32_t budget,
+					const int32_t *src, uint32_t src_size,
+					uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+					uint32_t hist_buf_size)
+{
+	return cmp_compress_budget_generic(ctx, dst, budget, src, src_size, CMP_I16_IN_I32,
+					   max_near_lossless_delta, hist_buf, hist_buf_size);
+}
+
+
+uint32_t cmp_compress_u16_budget(struct cmp_context *ctx, void *dst, uint32_t budget,
+				 const uint16_t *src, uint32_t src_size,
+				 uint32_t max_near_lossless_delta, uint32_t *hist_buf,
+				 uint32_t hist_buf_size)
+{
+	return cmp_compress_budget_generic(ctx, dst, budget, src, src_size, CMP_U16,
+					   max_near_lossless_delta, hist_buf, hist_buf_size);
 }
 
 
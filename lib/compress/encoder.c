@@ -49,6 +49,20 @@ static unsigned int ilog2(uint32_t x)
 }
 
 
+/**
+ * @brief Calculates the number of bits needed to represent a value
+ *
+ * @param value	value to measure
+ *
+ * @returns the position of the highest set bit plus one; 0 for a zero value
+ */
+
+static unsigned int bit_length(uint32_t value)
+{
+	return value ? ilog2(value) + 1 : 0;
+}
+
+
 /**
  * @brief Calculates the first value that cannot be encoded with golomb_encode()
  *
@@ -182,6 +196,51 @@ static uint32_t golomb_optimal_outlier_zero(uint32_t g_par, unsigned int n_bits)
 }
 
 
+/*
+ * Initial running sum of the backward adaptive Rice encoder; the running count
+ * starts at 1. Encoder and decoder have to use the same value.
+ */
+#define ADAPTIVE_RICE_SUM_INIT 4
+
+/*
+ * Largest unary part of an adaptive Rice codeword; a unary part of this length
+ * is an escape symbol followed by the raw mapped sample
+ */
+#define ADAPTIVE_RICE_MAX_Q 15
+
+/* Largest adaptive Rice parameter; keeps every codeword below 32 bits */
+#define ADAPTIVE_RICE_MAX_K (CMP_NUM_BITS_PER_SAMPLE)
+
+
+/**
+ * @brief Sets the outlier parameter of a Golomb encoder
+ *
+ * @param enc		Pointer to a CMP_ENCODER_GOLOMB_ZERO or
+ *			CMP_ENCODER_GOLOMB_MULTI encoder with set Golomb
+ *			parameter and number of bits per sample
+ * @param outlier	outlier parameter for CMP_ENCODER_GOLOMB_MULTI; ignored
+ *			with CMP_ENCODER_GOLOMB_ZERO
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t golomb_set_outlier(struct cmp_encoder *enc, uint32_t outlier)
+{
+	if (enc->encoder_type == CMP_ENCODER_GOLOMB_ZERO)
+		enc->outlier = golomb_optimal_outlier_zero(enc->g_par, enc->n_bits);
+	else
+		enc->outlier = outlier;
+
+	/* ensure we do not Golomb-encode too large values */
+	enc->outlier = min_u32(enc->outlier,
+			       golomb_upper_bound(enc->g_par, enc->encoder_type, enc->n_bits));
+	if (enc->outlier == 0)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
 uint32_t cmp_encoder_init(struct cmp_encoder *enc, enum cmp_encoder_type encoder_type,
 			  uint32_t encoder_param, uint32_t outlier)
 {
@@ -190,6 +249,7 @@ uint32_t cmp_encoder_init(struct cmp_encoder *enc, enum cmp_encoder_type encoder
 
 	memset(enc, 0, sizeof(*enc));
 	enc->encoder_type = encoder_type;
+	enc->n_bits = CMP_NUM_BITS_PER_SAMPLE;
 
 	switch (enc->encoder_type) {
 	case CMP_ENCODER_UNCOMPRESSED:
@@ -201,19 +261,40 @@ uint32_t cmp_encoder_init(struct cmp_encoder *enc, enum cmp_encoder_type encoder
 			return CMP_ERROR(PARAMS_INVALID);
 		enc->g_par = encoder_param;
 		enc->g_par_log2 = ilog2(encoder_param);
+		return golomb_set_outlier(enc, outlier);
 
-		if (enc->encoder_type == CMP_ENCODER_GOLOMB_ZERO)
-			enc->outlier =
-				golomb_optimal_outlier_zero(enc->g_par, CMP_NUM_BITS_PER_SAMPLE);
-		else
-			enc->outlier = outlier;
+	case CMP_ENCODER_BLOCK_RICE:
+		if (encoder_param < 1 || encoder_param > CMP_BLOCK_RICE_MAX_SIZE)
+			return CMP_ERROR(PARAMS_INVALID);
+		enc->block_size = encoder_param;
+		break;
+
+	case CMP_ENCODER_PFOR:
+		if (encoder_param < 1 || encoder_param > CMP_PFOR_MAX_SIZE)
+			return CMP_ERROR(PARAMS_INVALID);
+		enc->block_size = encoder_param;
+		enc->pfor_pos_bits = bit_length(encoder_param - 1);
+		enc->pfor_count_bits = bit_length(encoder_param);
+		break;
+
+	case CMP_ENCODER_EXP_GOLOMB:
+		if (encoder_param > CMP_EXP_GOLOMB_MAX_K)
+			return CMP_ERROR(PARAMS_INVALID);
+		enc->g_par_log2 = encoder_param;
+		break;
 
-		/* ensure we do not Golomb-encode too large values */
-		enc->outlier =
-			min_u32(enc->outlier, golomb_upper_bound(enc->g_par, enc->encoder_type,
-								 CMP_NUM_BITS_PER_SAMPLE));
-		if (enc->outlier == 0)
+	case CMP_ENCODER_RANS:
+		if (encoder_param < 1 || encoder_param > CMP_RANS_MAX_STATES)
 			return CMP_ERROR(PARAMS_INVALID);
+		enc->rans_n_states = encoder_param;
+		break;
+
+	case CMP_ENCODER_ADAPTIVE_RICE:
+		if (encoder_param < 2 || encoder_param > UINT16_MAX)
+			return CMP_ERROR(PARAMS_INVALID);
+		enc->adapt_reset = encoder_param;
+		enc->adapt_sum = ADAPTIVE_RICE_SUM_INIT;
+		enc->adapt_count = 1;
 		break;
 
 	default:
@@ -224,11 +305,30 @@ uint32_t cmp_encoder_init(struct cmp_encoder *enc, enum cmp_encoder_type encoder
 }
 
 
+uint32_t cmp_encoder_set_n_bits(struct cmp_encoder *enc, unsigned int n_bits)
+{
+	if (n_bits < 1 || n_bits > CMP_NUM_BITS_PER_SAMPLE)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	enc->n_bits = n_bits;
+	if (enc->encoder_type == CMP_ENCODER_GOLOMB_ZERO ||
+	    enc->encoder_type == CMP_ENCODER_GOLOMB_MULTI)
+		return golomb_set_outlier(enc, enc->outlier);
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
 uint32_t cmp_encoder_params_check(enum cmp_encoder_type encoder_type, uint32_t encoder_param,
 				  uint32_t outlier)
 {
 	struct cmp_encoder enc_dummy;
 
+	/* the selected parameter is always valid, check the remaining ones */
+	if (encoder_param == CMP_ENCODER_PARAM_AUTO)
+		encoder_param = encoder_type == CMP_ENCODER_ADAPTIVE_RICE ?
+					CMP_ADAPTIVE_RICE_DEFAULT_RESET : CMP_MIN_GOLOMB_PAR;
+
 	return cmp_encoder_init(&enc_dummy, encoder_type, encoder_param, outlier);
 }
 
@@ -286,6 +386,24 @@ static uint32_t map_to_unsigned(int32_t value, unsigned int n_bits)
 }
 
 
+/**
+ * @brief Maps a sample to the unsigned value coded by the encoder
+ *
+ * Only the lower n_bits of the sample are used, so residuals wrap around at the
+ * bit depth of the samples and every mapped value fits into n_bits bits.
+ *
+ * @param enc	Pointer to an initialised encoder
+ * @param value	sample to map
+ *
+ * @returns the ZigZag mapped sample
+ */
+
+static uint32_t map_sample(const struct cmp_encoder *enc, int16_t value)
+{
+	return map_to_unsigned(value, enc->n_bits);
+}
+
+
 /**
  * @brief forms a codeword according to the Golomb code
  *
@@ -324,16 +442,575 @@ static void golomb_encode(uint32_t value, uint32_t g_par, uint32_t g_par_log2,
 }
 
 
-void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
-			    struct bitstream_writer *bs)
+/**
+ * @brief Calculates the length of a codeword according to the Golomb code
+ *
+ * @param value		Value to be encoded, must be smaller than
+ *			golomb_upper_bound()
+ * @param g_par		Golomb parameter (have to be bigger than 0)
+ * @param g_par_log2	Is ilog2(g_par) calculate outside function for better
+ *			performance
+ *
+ * @returns the number of bits golomb_encode() would write for the value
+ *
+ * @warning there is no check of the validity of the input parameters!
+ */
+
+static uint32_t golomb_len(uint32_t value, uint32_t g_par, uint32_t g_par_log2)
+{
+	uint32_t const cutoff = (2U << g_par_log2) - g_par; /* members in group 0 */
+
+	if (value < cutoff) /* group 0 */
+		return g_par_log2 + 1;
+
+	return g_par_log2 + 2 + (value - cutoff) / g_par;
+}
+
+
+/* ====== Block Adaptive Rice Coding ====== */
+/*
+ * Every block starts with an option identifier selecting how the mapped
+ * samples of the block are coded, similar to the CCSDS 121.0 adaptive entropy
+ * coder:
+ *   0:     zero block; all samples are 0, nothing follows
+ *   1..14: Rice code with parameter k = id - 1
+ *   15:    raw samples with n_bits bits each
+ */
+#define BLOCK_RICE_ID_BITS 4
+#define BLOCK_RICE_ID_ZERO 0
+#define BLOCK_RICE_ID_RAW  ((1U << BLOCK_RICE_ID_BITS) - 1)
+#define BLOCK_RICE_MAX_K   (BLOCK_RICE_ID_RAW - 2)
+
+
+/**
+ * @brief Selects the shortest coding option for a block
+ *
+ * @param block		mapped samples of the block
+ * @param n		number of samples in the block
+ * @param n_bits	number of bits of a raw sample
+ * @param len		pointer where the length of the coded block (including
+ *			the option identifier) in bits is stored
+ *
+ * @returns the option identifier
+ */
+
+static unsigned int block_rice_select(const uint16_t *block, uint32_t n, unsigned int n_bits,
+				      uint32_t *len)
+{
+	uint32_t best_len = n * n_bits;
+	unsigned int best_id = BLOCK_RICE_ID_RAW;
+	uint32_t i, k, sum = 0;
+
+	for (i = 0; i < n; i++)
+		sum |= block[i];
+	if (sum == 0) {
+		*len = BLOCK_RICE_ID_BITS;
+		return BLOCK_RICE_ID_ZERO;
+	}
+
+	for (k = 0; k <= BLOCK_RICE_MAX_K; k++) {
+		uint32_t k_len = n * (k + 1);
+
+		for (i = 0; i < n; i++)
+			k_len += (uint32_t)block[i] >> k;
+
+		if (k_len < best_len) {
+			best_len = k_len;
+			best_id = k + 1;
+		}
+	}
+
+	*len = BLOCK_RICE_ID_BITS + best_len;
+	return best_id;
+}
+
+
+/**
+ * @brief forms a Rice codeword (Golomb code with g_par = 2^k)
+ *
+ * @param value		value to be encoded
+ * @param k		Rice parameter
+ * @param bs		Pointer to a bitstream writer
+ *
+ * The unary part can be longer than a single bitstream write; it is written
+ * in chunks in that case.
+ */
+
+static void rice_encode(uint32_t value, unsigned int k, struct bitstream_writer *bs)
+{
+	uint32_t q = value >> k;
+	uint32_t const remainder = value & ((1U << k) - 1);
+
+	while (q >= 32) {
+		bitstream_add_bits32(bs, UINT32_MAX, 32);
+		q -= 32;
+	}
+
+	if (q + 1 + k <= 32) {
+		bitstream_add_bits32(bs, (((1U << q) - 1) << (k + 1)) | remainder, q + 1 + k);
+	} else {
+		bitstream_add_bits32(bs, (1U << q) - 1, q);
+		bitstream_add_bits32(bs, remainder, k + 1);
+	}
+}
+
+
+/**
+ * @brief Encodes the buffered samples as one block
+ *
+ * @param enc	Pointer to a CMP_ENCODER_BLOCK_RICE encoder
+ * @param bs	Pointer to a bitstream writer
+ */
+
+static void block_rice_encode(struct cmp_encoder *enc, struct bitstream_writer *bs)
+{
+	uint32_t i, len;
+	unsigned int const id = block_rice_select(enc->block, enc->block_fill, enc->n_bits, &len);
+
+	bitstream_add_bits32(bs, id, BLOCK_RICE_ID_BITS);
+	if (id == BLOCK_RICE_ID_RAW) {
+		for (i = 0; i < enc->block_fill; i++)
+			bitstream_add_bits32(bs, enc->block[i], enc->n_bits);
+	} else if (id != BLOCK_RICE_ID_ZERO) {
+		for (i = 0; i < enc->block_fill; i++)
+			rice_encode(enc->block[i], id - 1, bs);
+	}
+	enc->block_fill = 0;
+}
+
+
+/* ====== Exponential-Golomb Coding ====== */
+/**
+ * @brief Calculates the length of an order-k Exp-Golomb codeword
+ *
+ * @param value	value to encode
+ * @param k	order of the Exp-Golomb code
+ *
+ * @returns the codeword length in bits
+ */
+
+static uint32_t exp_golomb_len(uint32_t value, unsigned int k)
+{
+	unsigned int const n = bit_length(value + (1U << k));
+
+	return 2 * n - k - 1;
+}
+
+
+/**
+ * @brief Forms an order-k Exp-Golomb codeword
+ *
+ * The value plus 2^k is written with n bits, preceded by n - k - 1 zeros.
+ * Only the position of the leading one is needed; no division takes place.
+ *
+ * @param value	value to encode
+ * @param k	order of the Exp-Golomb code
+ * @param bs	Pointer to a bitstream writer
+ */
+
+static void exp_golomb_encode(uint32_t value, unsigned int k, struct bitstream_writer *bs)
+{
+	uint32_t const v = value + (1U << k);
+	unsigned int const n = bit_length(v);
+	unsigned int const len = 2 * n - k - 1;
+
+	if (len <= 32) {
+		bitstream_add_bits32(bs, v, len);
+	} else {
+		bitstream_add_bits32(bs, 0, n - k - 1);
+		bitstream_add_bits32(bs, v, n);
+	}
+}
+
+
+/* ====== Patched Frame-of-Reference Coding ====== */
+/*
+ * A PFor block is coded as:
+ *   PFOR_WIDTH_BITS	bit width b of the packed samples
+ *   n * b		lowest b bits of every mapped sample
+ *   count_bits		number of exceptions (samples not fitting into b bits)
+ *   per exception:	position in the block (pos_bits) followed by the
+ *			remaining n_bits - b high bits
+ */
+#define PFOR_WIDTH_BITS 5
+
+
+/**
+ * @brief Selects the bit width resulting in the shortest PFor block
+ *
+ * One pass counts the samples per bit length; the length of every bit width
+ * follows from the counts without touching the samples again.
+ *
+ * @param enc	Pointer to a CMP_ENCODER_PFOR encoder
+ * @param len	pointer where the length of the coded block in bits is stored
+ *
+ * @returns the selected bit width
+ */
+
+static unsigned int pfor_select(const struct cmp_encoder *enc, uint32_t *len)
+{
+	uint32_t count[CMP_NUM_BITS_PER_SAMPLE + 1] = { 0 };
+	uint32_t const n = enc->block_fill;
+	uint32_t n_exceptions = 0, i;
+	unsigned int b, best_b = enc->n_bits;
+	uint32_t best_len = UINT32_MAX;
+
+	for (i = 0; i < n; i++)
+		count[bit_length(enc->block[i])]++;
+
+	for (b = enc->n_bits + 1; b-- > 0;) {
+		uint32_t const b_len =
+			n * b + n_exceptions * (enc->pfor_pos_bits + enc->n_bits - b);
+
+		if (b_len <= best_len) {
+			best_len = b_len;
+			best_b = b;
+		}
+		n_exceptions += count[b];
+	}
+
+	*len = PFOR_WIDTH_BITS + enc->pfor_count_bits + best_len;
+	return best_b;
+}
+
+
+/**
+ * @brief Encodes the buffered samples as one PFor block
+ *
+ * The low bits of the whole block are packed in one tight loop; only the
+ * exceptions are written sample by sample.
+ *
+ * @param enc	Pointer to a CMP_ENCODER_PFOR encoder
+ * @param bs	Pointer to a bitstream writer
+ */
+
+static void pfor_encode(struct cmp_encoder *enc, struct bitstream_writer *bs)
+{
+	uint32_t i, len, n_exceptions = 0;
+	unsigned int const b = pfor_select(enc, &len);
+	uint32_t const mask = (1U << b) - 1;
+
+	bitstream_add_bits32(bs, b, PFOR_WIDTH_BITS);
+	bitstream_add_packed_u16_array(bs, enc->block, enc->block_fill, b);
+
+	for (i = 0; i < enc->block_fill; i++) {
+		if (enc->block[i] > mask)
+			n_exceptions++;
+	}
+
+	bitstream_add_bits32(bs, n_exceptions, enc->pfor_count_bits);
+	for (i = 0; n_exceptions && i < enc->block_fill; i++) {
+		if (enc->block[i] > mask) {
+			bitstream_add_bits32(bs, i, enc->pfor_pos_bits);
+			bitstream_add_bits32(bs, (uint32_t)enc->block[i] >> b, enc->n_bits - b);
+			n_exceptions--;
+		}
+	}
+	enc->block_fill = 0;
+}
+
+
+/* ====== Backward Adaptive Rice Coding ====== */
+/**
+ * @brief Derives the Rice parameter from the running statistics
+ *
+ * Like in LOCO-I (JPEG-LS), the parameter is the smallest k for which
+ * count * 2^k >= sum, which approximates log2 of the mean mapped sample.
+ *
+ * @param enc	Pointer to a CMP_ENCODER_ADAPTIVE_RICE encoder
+ *
+ * @returns the Rice parameter for the next sample
+ */
+
+static unsigned int adaptive_rice_k(const struct cmp_encoder *enc)
+{
+	unsigned int k;
+
+	for (k = 0; (enc->adapt_count << k) < enc->adapt_sum && k < ADAPTIVE_RICE_MAX_K; k++)
+		;
+	return k;
+}
+
+
+/**
+ * @brief Updates the running statistics with an encoded sample
+ *
+ * @param enc		Pointer to a CMP_ENCODER_ADAPTIVE_RICE encoder
+ * @param mapped	mapped sample that was encoded
+ */
+
+static void adaptive_rice_update(struct cmp_encoder *enc, uint32_t mapped)
+{
+	enc->adapt_sum += mapped;
+	enc->adapt_count++;
+	if (enc->adapt_count >= enc->adapt_reset) {
+		enc->adapt_sum >>= 1;
+		enc->adapt_count >>= 1;
+	}
+}
+
+
+/**
+ * @brief Calculates the length of an adaptive Rice codeword
+ *
+ * @param mapped	mapped sample to encode
+ * @param k		Rice parameter
+ * @param n_bits	number of bits of the raw sample following an escape
+ *
+ * @returns the codeword length in bits
+ */
+
+static uint32_t adaptive_rice_len(uint32_t mapped, unsigned int k, unsigned int n_bits)
+{
+	uint32_t const q = mapped >> k;
+
+	if (q < ADAPTIVE_RICE_MAX_Q)
+		return q + 1 + k;
+	return ADAPTIVE_RICE_MAX_Q + n_bits;
+}
+
+
+/* ====== Interleaved rANS Coding ====== */
+/*
+ * Every mapped sample is split into its bit length class (symbol) and the bits
+ * below its leading one (symbol - 1 raw bits). The symbols are coded with a
+ * static per-frame rANS model, the raw bits are pushed into the same state as
+ * uniformly distributed values. Consecutive samples use the states in turn.
+ *
+ * The coded data starts with the frequency table:
+ *   RANS_TABLE_COUNT_BITS	number of table entries m (0: raw mode)
+ *   m * RANS_FREQ_BITS	normalised frequencies of the symbols 0 to m-1
+ * followed by the 16-bit renormalisation words of all states in the order they
+ * are produced and the final 32-bit states (first state first). The encoder
+ * works forward, so a decoder reads the words backwards from the end and
+ * reconstructs the samples from last to first.
+ *
+ * Frames with less than RANS_MIN_SAMPLES samples do not amortise the table and
+ * the final states; they are stored in raw mode, one n_bits mapped sample each.
+ */
+#define RANS_SCALE_BITS       12
+#define RANS_FREQ_BITS        (RANS_SCALE_BITS + 1)
+#define RANS_TABLE_COUNT_BITS 5
+#define RANS_STATE_LOW        (1UL << 16) /* lower bound of the normalised state */
+#define RANS_WORD_BITS        16
+#define RANS_STATE_BITS       32
+#define RANS_MIN_SAMPLES      32
+
+
+/**
+ * @brief Pushes a value with the frequency freq out of 2^scale_bits into a
+ *	rANS state
+ *
+ * @param state		pointer to the rANS state
+ * @param start		cumulative frequency of the value
+ * @param freq		frequency of the value
+ * @param scale_bits	log2 of the sum of all frequencies
+ * @param bs		Pointer to a bitstream writer or NULL to only
+ *			calculate the length
+ *
+ * @returns the number of renormalisation bits written
+ */
+
+static uint32_t rans_put(uint32_t *state, uint32_t start, uint32_t freq, unsigned int scale_bits,
+			 struct bitstream_writer *bs)
+{
+	uint64_t const x_max = ((uint64_t)(RANS_STATE_LOW >> scale_bits) << RANS_WORD_BITS) * freq;
+	uint32_t x = *state;
+	uint32_t len = 0;
+
+	/* one word is always enough as the state is at least RANS_STATE_LOW */
+	if (x >= x_max) {
+		if (bs)
+			bitstream_add_bits32(bs, x & 0xFFFF, RANS_WORD_BITS);
+		x >>= RANS_WORD_BITS;
+		len = RANS_WORD_BITS;
+	}
+	*state = ((x / freq) << scale_bits) + (x % freq) + start;
+	return len;
+}
+
+
+/**
+ * @brief Counts the samples collected by the training
+ *
+ * @param enc		Pointer to a CMP_ENCODER_RANS encoder
+ * @param n_samples	pointer to store the number of collected samples
+ *
+ * @returns the number of frequency table entries
+ */
+
+static uint32_t rans_count(const struct cmp_encoder *enc, uint32_t *n_samples)
+{
+	uint32_t n_entries = 0;
+	unsigned int s;
+
+	*n_samples = 0;
+	for (s = 0; s < CMP_RANS_N_SYMBOLS; s++) {
+		*n_samples += enc->rans_freq[s];
+		if (enc->rans_freq[s])
+			n_entries = s + 1;
+	}
+	return n_entries;
+}
+
+
+/**
+ * @brief Normalises the collected symbol counts and writes the frequency table
+ *
+ * @param enc	Pointer to a CMP_ENCODER_RANS encoder
+ * @param bs	Pointer to a bitstream writer or NULL to only calculate the
+ *		length
+ *
+ * @returns the length of the frequency table in bits
+ */
+
+static uint32_t rans_start(struct cmp_encoder *enc, struct bitstream_writer *bs)
+{
+	uint32_t const total_freq = 1U << RANS_SCALE_BITS;
+	uint32_t n_samples, sum = 0, n_entries;
+	unsigned int s, largest = 0;
+
+	compile_time_assert(CMP_RANS_N_SYMBOLS == CMP_NUM_BITS_PER_SAMPLE + 1,
+			    rans_symbols_do_not_match_sample_size);
+
+	enc->rans_started = 1;
+
+	n_entries = rans_count(enc, &n_samples);
+	for (s = 0; s < CMP_RANS_N_SYMBOLS; s++)
+		if (enc->rans_freq[s] > enc->rans_freq[largest])
+			largest = s;
+
+	if (n_samples < RANS_MIN_SAMPLES) {
+		enc->rans_raw = 1;
+		if (bs)
+			bitstream_add_bits32(bs, 0, RANS_TABLE_COUNT_BITS);
+		return RANS_TABLE_COUNT_BITS;
+	}
+
+	for (s = 0; s < CMP_RANS_N_SYMBOLS; s++) {
+		uint32_t const count = enc->rans_freq[s];
+
+		if (count) {
+			enc->rans_freq[s] =
+				(uint32_t)(((uint64_t)count << RANS_SCALE_BITS) / n_samples);
+			if (enc->rans_freq[s] == 0)
+				enc->rans_freq[s] = 1;
+		}
+		sum += enc->rans_freq[s];
+	}
+	/*
+	 * The largest symbol has at least a frequency of total_freq / number
+	 * of symbols, far more than the at most CMP_RANS_N_SYMBOLS rounded up
+	 * frequencies could take away from it.
+	 */
+	enc->rans_freq[largest] += total_freq - sum;
+
+	sum = 0;
+	for (s = 0; s < CMP_RANS_N_SYMBOLS; s++) {
+		enc->rans_cum_freq[s] = sum;
+		sum += enc->rans_freq[s];
+	}
+	for (s = 0; s < enc->rans_n_states; s++)
+		enc->rans_state[s] = RANS_STATE_LOW;
+
+	if (bs) {
+		bitstream_add_bits32(bs, n_entries, RANS_TABLE_COUNT_BITS);
+		for (s = 0; s < n_entries; s++)
+			bitstream_add_bits32(bs, enc->rans_freq[s], RANS_FREQ_BITS);
+	}
+	return RANS_TABLE_COUNT_BITS + n_entries * RANS_FREQ_BITS;
+}
+
+
+/**
+ * @brief Encodes a mapped sample with the next rANS state
+ *
+ * @param enc		Pointer to a CMP_ENCODER_RANS encoder
+ * @param mapped	mapped sample to encode
+ * @param bs		Pointer to a bitstream writer or NULL to only
+ *			calculate the length
+ *
+ * @returns the number of bits written
+ */
+
+static uint32_t rans_encode(struct cmp_encoder *enc, uint32_t mapped, struct bitstream_writer *bs)
+{
+	uint32_t len = 0;
+	unsigned int symbol, n_raw_bits;
+	uint32_t *state;
+
+	if (!enc->rans_started)
+		len += rans_start(enc, bs);
+
+	if (enc->rans_raw) {
+		if (bs)
+			bitstream_add_bits32(bs, mapped, enc->n_bits);
+		return len + enc->n_bits;
+	}
+
+	symbol = bit_length(mapped);
+	n_raw_bits = symbol ? symbol - 1 : 0;
+	state = &enc->rans_state[enc->rans_next_state];
+
+	/* the decoder needs the symbol first, so it is pushed last */
+	if (n_raw_bits)
+		len += rans_put(state, mapped & ((1U << n_raw_bits) - 1), 1, n_raw_bits, bs);
+	len += rans_put(state, enc->rans_cum_freq[symbol], enc->rans_freq[symbol],
+			RANS_SCALE_BITS, bs);
+
+	if (++enc->rans_next_state == enc->rans_n_states)
+		enc->rans_next_state = 0;
+	return len;
+}
+
+
+/**
+ * @brief Writes the final rANS states
+ *
+ * @param enc	Pointer to a CMP_ENCODER_RANS encoder
+ * @param bs	Pointer to a bitstream writer
+ */
+
+static void rans_finish(struct cmp_encoder *enc, struct bitstream_writer *bs)
+{
+	uint32_t i;
+
+	if (!enc->rans_started)
+		(void)rans_start(enc, bs);
+	if (enc->rans_raw)
+		return;
+
+	for (i = 0; i < enc->rans_n_states; i++)
+		bitstream_add_bits32(bs, enc->rans_state[i], RANS_STATE_BITS);
+}
+
+
+/* calculates the length rans_finish() would write without changing the encoder */
+static uint32_t rans_finish_len(const struct cmp_encoder *enc)
+{
+	uint32_t n_samples, n_entries;
+
+	if (enc->rans_started)
+		return enc->rans_raw ? 0 : enc->rans_n_states * RANS_STATE_BITS;
+
+	n_entries = rans_count(enc, &n_samples);
+	if (n_samples < RANS_MIN_SAMPLES)
+		return RANS_TABLE_COUNT_BITS;
+	return RANS_TABLE_COUNT_BITS + n_entries * RANS_FREQ_BITS +
+	       enc->rans_n_states * RANS_STATE_BITS;
+}
+
+
+/* encodes a single sample with the selected encoder */
+static void encode_sample(struct cmp_encoder *enc, int16_t value, struct bitstream_writer *bs)
 {
 	switch (enc->encoder_type) {
 	case CMP_ENCODER_UNCOMPRESSED:
-		bitstream_add_bits32(bs, (uint16_t)value, bitsizeof(value));
+		bitstream_add_bits32(bs, (uint16_t)value & ((1U << enc->n_bits) - 1), enc->n_bits);
 		break;
 
 	case CMP_ENCODER_GOLOMB_ZERO: {
-		uint16_t const mapped = (uint16_t)map_to_unsigned(value, bitsizeof(value));
+		uint16_t const mapped = (uint16_t)map_sample(enc, value);
 
 		if (mapped < enc->outlier) {
 			/* add 1 for non-outlier values to make space for 0 as escape symbol */
@@ -343,7 +1020,7 @@ void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
 			 * Combine Golomb(0) and raw data into a single write for efficiency.
 			 */
 			compile_time_assert(CMP_MAX_BITS_ZERO_ESCAPE <= 32, zero_escape_too_large);
-			unsigned int const len = enc->g_par_log2 + 1 + bitsizeof(value);
+			unsigned int const len = enc->g_par_log2 + 1 + enc->n_bits;
 
 			bitstream_add_bits32(bs, mapped, len);
 		}
@@ -351,7 +1028,7 @@ void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
 	}
 
 	case CMP_ENCODER_GOLOMB_MULTI: {
-		uint16_t const mapped = (uint16_t)map_to_unsigned(value, bitsizeof(value));
+		uint16_t const mapped = (uint16_t)map_sample(enc, value);
 
 		if (mapped < enc->outlier) {
 			golomb_encode(mapped, enc->g_par, enc->g_par_log2, bs);
@@ -374,7 +1051,416 @@ void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
 		}
 		break;
 	}
+
+	case CMP_ENCODER_BLOCK_RICE:
+		enc->block[enc->block_fill++] = (uint16_t)map_sample(enc, value);
+		if (enc->block_fill == enc->block_size)
+			block_rice_encode(enc, bs);
+		break;
+
+	case CMP_ENCODER_PFOR:
+		enc->block[enc->block_fill++] = (uint16_t)map_sample(enc, value);
+		if (enc->block_fill == enc->block_size)
+			pfor_encode(enc, bs);
+		break;
+
+	case CMP_ENCODER_ADAPTIVE_RICE: {
+		uint32_t const mapped = map_sample(enc, value);
+		unsigned int const k = adaptive_rice_k(enc);
+		uint32_t const q = mapped >> k;
+
+		compile_time_assert(ADAPTIVE_RICE_MAX_Q + CMP_NUM_BITS_PER_SAMPLE <= 32,
+				    adaptive_rice_escape_too_large);
+		if (q < ADAPTIVE_RICE_MAX_Q) {
+			uint32_t const remainder = mapped & ((1U << k) - 1);
+
+			bitstream_add_bits32(bs, (((1U << q) - 1) << (k + 1)) | remainder,
+					     q + 1 + k);
+		} else {
+			/* all ones unary part as escape symbol followed by the raw sample */
+			uint32_t const escape = (1U << ADAPTIVE_RICE_MAX_Q) - 1;
+
+			bitstream_add_bits32(bs, escape << enc->n_bits | mapped,
+					     ADAPTIVE_RICE_MAX_Q + enc->n_bits);
+		}
+		adaptive_rice_update(enc, mapped);
+		break;
+	}
+
+	case CMP_ENCODER_RANS:
+		(void)rans_encode(enc, map_sample(enc, value), bs);
+		break;
+
+	case CMP_ENCODER_EXP_GOLOMB:
+		exp_golomb_encode(map_sample(enc, value), enc->g_par_log2, bs);
+		break;
+	}
+}
+
+
+/*
+ * calculates the length encode_sample() would write for the encoders without
+ * a state between the samples
+ */
+static uint32_t stateless_sample_len(const struct cmp_encoder *enc, int16_t value)
+{
+	switch (enc->encoder_type) {
+	case CMP_ENCODER_UNCOMPRESSED:
+		return enc->n_bits;
+
+	case CMP_ENCODER_GOLOMB_ZERO: {
+		uint16_t const mapped = (uint16_t)map_sample(enc, value);
+
+		if (mapped < enc->outlier)
+			return golomb_len((uint32_t)mapped + 1, enc->g_par, enc->g_par_log2);
+		return enc->g_par_log2 + 1 + enc->n_bits;
+	}
+
+	case CMP_ENCODER_GOLOMB_MULTI: {
+		uint16_t const mapped = (uint16_t)map_sample(enc, value);
+		uint32_t diff;
+		unsigned int level;
+
+		if (mapped < enc->outlier)
+			return golomb_len(mapped, enc->g_par, enc->g_par_log2);
+
+		diff = mapped - enc->outlier;
+		level = diff < 4 ? 0 : ilog2(diff) / 2;
+		return golomb_len(enc->outlier + level, enc->g_par, enc->g_par_log2) +
+		       (level + 1) * 2;
+	}
+
+	case CMP_ENCODER_EXP_GOLOMB:
+		return exp_golomb_len(map_sample(enc, value), enc->g_par_log2);
+
+	case CMP_ENCODER_BLOCK_RICE:
+	case CMP_ENCODER_PFOR:
+	case CMP_ENCODER_ADAPTIVE_RICE:
+	case CMP_ENCODER_RANS:
+		break;
+	}
+
+	return 0;
+}
+
+
+/* calculates the length encode_sample() would write */
+static uint32_t sample_len(struct cmp_encoder *enc, int16_t value)
+{
+	switch (enc->encoder_type) {
+	case CMP_ENCODER_BLOCK_RICE:
+	case CMP_ENCODER_PFOR:
+		enc->block[enc->block_fill++] = (uint16_t)map_sample(enc, value);
+		if (enc->block_fill == enc->block_size) {
+			uint32_t const len = cmp_encoder_len_flush(enc);
+
+			enc->block_fill = 0;
+			return len;
+		}
+		return 0;
+
+	case CMP_ENCODER_ADAPTIVE_RICE: {
+		uint32_t const mapped = map_sample(enc, value);
+		uint32_t const len = adaptive_rice_len(mapped, adaptive_rice_k(enc), enc->n_bits);
+
+		adaptive_rice_update(enc, mapped);
+		return len;
+	}
+
+	case CMP_ENCODER_RANS:
+		return rans_encode(enc, map_sample(enc, value), NULL);
+
+	case CMP_ENCODER_UNCOMPRESSED:
+	case CMP_ENCODER_GOLOMB_ZERO:
+	case CMP_ENCODER_GOLOMB_MULTI:
+	case CMP_ENCODER_EXP_GOLOMB:
+		break;
+	}
+
+	return stateless_sample_len(enc, value);
+}
+
+
+/* ====== Zero-Run Coding ====== */
+/*
+ * With zero-run coding, a run of zero residuals is coded as the codeword of a
+ * single zero followed by the run length minus one as order-0 Exp-Golomb
+ * codeword. The sample following a run is never zero.
+ */
+
+/* writes the pending run of zero residuals */
+static void zero_run_encode(struct cmp_encoder *enc, struct bitstream_writer *bs)
+{
+	encode_sample(enc, 0, bs);
+	exp_golomb_encode(enc->zero_run_length - 1, 0, bs);
+	enc->zero_run_length = 0;
+}
+
+
+/*
+ * calculates the length zero_run_encode() would write; zero-run coding is only
+ * enabled for encoders without a state between the samples
+ */
+static uint32_t zero_run_len(const struct cmp_encoder *enc)
+{
+	return stateless_sample_len(enc, 0) + exp_golomb_len(enc->zero_run_length - 1, 0);
+}
+
+
+int cmp_encoder_enable_zero_run(struct cmp_encoder *enc)
+{
+	if (enc->encoder_type != CMP_ENCODER_GOLOMB_ZERO &&
+	    enc->encoder_type != CMP_ENCODER_GOLOMB_MULTI &&
+	    enc->encoder_type != CMP_ENCODER_EXP_GOLOMB)
+		return 0;
+
+	enc->zero_run = 1;
+	return 1;
+}
+
+
+void cmp_encoder_encode_s16(struct cmp_encoder *enc, int16_t value, struct bitstream_writer *bs)
+{
+	if (enc->zero_run) {
+		if (value == 0) {
+			enc->zero_run_length++;
+			return;
+		}
+		if (enc->zero_run_length)
+			zero_run_encode(enc, bs);
+	}
+	encode_sample(enc, value, bs);
+}
+
+
+void cmp_encoder_flush(struct cmp_encoder *enc, struct bitstream_writer *bs)
+{
+	if (enc->zero_run_length)
+		zero_run_encode(enc, bs);
+
+	if (enc->encoder_type == CMP_ENCODER_RANS) {
+		rans_finish(enc, bs);
+		return;
 	}
+
+	if (enc->block_fill == 0)
+		return;
+
+	if (enc->encoder_type == CMP_ENCODER_BLOCK_RICE)
+		block_rice_encode(enc, bs);
+	else if (enc->encoder_type == CMP_ENCODER_PFOR)
+		pfor_encode(enc, bs);
+}
+
+
+uint32_t cmp_encoder_len_s16(struct cmp_encoder *enc, int16_t value)
+{
+	uint32_t len = 0;
+
+	if (enc->zero_run) {
+		if (value == 0) {
+			enc->zero_run_length++;
+			return 0;
+		}
+		if (enc->zero_run_length) {
+			len = zero_run_len(enc);
+			enc->zero_run_length = 0;
+		}
+	}
+	return len + sample_len(enc, value);
+}
+
+
+uint32_t cmp_encoder_len_flush(const struct cmp_encoder *enc)
+{
+	uint32_t len = 0;
+
+	if (enc->zero_run_length)
+		return zero_run_len(enc);
+
+	if (enc->encoder_type == CMP_ENCODER_RANS)
+		return rans_finish_len(enc);
+
+	if (enc->block_fill == 0)
+		return 0;
+
+	if (enc->encoder_type == CMP_ENCODER_BLOCK_RICE)
+		(void)block_rice_select(enc->block, enc->block_fill, enc->n_bits, &len);
+	else if (enc->encoder_type == CMP_ENCODER_PFOR)
+		(void)pfor_select(enc, &len);
+	return len;
+}
+
+
+int cmp_encoder_needs_training(const struct cmp_encoder *enc)
+{
+	return enc->encoder_type == CMP_ENCODER_RANS;
+}
+
+
+void cmp_encoder_train_s16(struct cmp_encoder *enc, int16_t value)
+{
+	if (enc->encoder_type == CMP_ENCODER_RANS)
+		enc->rans_freq[bit_length(map_sample(enc, value))]++;
+}
+
+
+uint16_t cmp_encoder_map_s16(int16_t value, unsigned int n_bits)
+{
+	return (uint16_t)map_to_unsigned(value, n_bits);
+}
+
+
+uint32_t cmp_encoder_golomb_par_from_mean(uint64_t sum, uint32_t n_values)
+{
+/* ln(2) in 16.16 fixed point */
+#define LN2_Q16 45426U
+	uint64_t g_par;
+
+	if (n_values == 0)
+		return CMP_MIN_GOLOMB_PAR;
+
+	/*
+	 * For geometrically distributed values with the mean mu, the optimal
+	 * Golomb parameter is approximately ln(2) * mu.
+	 */
+	g_par = ((sum * LN2_Q16) / n_values + (1U << 15)) >> 16;
+#undef LN2_Q16
+
+	if (g_par < CMP_MIN_GOLOMB_PAR)
+		return CMP_MIN_GOLOMB_PAR;
+	if (g_par > CMP_MAX_GOLOMB_PAR)
+		return CMP_MAX_GOLOMB_PAR;
+	return (uint32_t)g_par;
+}
+
+
+uint32_t cmp_encoder_exp_golomb_k_from_mean(uint64_t sum, uint32_t n_values)
+{
+	/* CMP_MAX_GOLOMB_PAR limits the order to CMP_EXP_GOLOMB_MAX_K */
+	return ilog2(cmp_encoder_golomb_par_from_mean(sum, n_values));
+}
+
+
+/**
+ * @brief Returns the number of histogram entries below a value
+ *
+ * @param cum_hist	cumulative histogram of the mapped values
+ * @param value		upper (excluded) bound; must be <= CMP_ENCODER_HIST_ENTRIES
+ *
+ * @returns the number of mapped values smaller than value
+ */
+
+static uint32_t hist_count_below(const uint32_t *cum_hist, uint32_t value)
+{
+	return value ? cum_hist[value - 1] : 0;
+}
+
+
+/**
+ * @brief Sums the Golomb codeword lengths of a range of histogram entries
+ *
+ * Calculates the total number of bits golomb_encode() writes if every mapped
+ * value x in [0, end) is encoded as x + offset.
+ *
+ * @param cum_hist	cumulative histogram of the mapped values
+ * @param end		first mapped value not included in the sum; must be
+ *			<= CMP_ENCODER_HIST_ENTRIES
+ * @param offset	value added to each mapped value before encoding
+ * @param g_par		Golomb parameter (have to be bigger than 0)
+ * @param g_par_log2	ilog2(g_par)
+ *
+ * @returns the sum of the codeword lengths in bits
+ */
+
+static uint64_t golomb_hist_len(const uint32_t *cum_hist, uint32_t end, uint32_t offset,
+				uint32_t g_par, uint32_t g_par_log2)
+{
+	uint32_t const cutoff = (2U << g_par_log2) - g_par; /* members in group 0 */
+	uint32_t const n_values = hist_count_below(cum_hist, end);
+	uint64_t len = (uint64_t)n_values * (g_par_log2 + 1);
+	uint32_t t;
+
+	/*
+	 * Every value outside of group 0 needs one extra bit, plus one unary
+	 * bit for every full group it is above cutoff. So every value x >= t
+	 * with t = cutoff + k * g_par (k >= 0) adds one bit.
+	 */
+	for (t = cutoff > offset ? cutoff - offset : 0; t < end; t += g_par)
+		len += n_values - hist_count_below(cum_hist, t);
+
+	return len;
+}
+
+
+uint32_t cmp_encoder_hist_costs(const uint32_t *cum_hist, uint32_t g_par, unsigned int n_bits,
+				uint64_t *zero_len, uint64_t *multi_len, uint32_t *multi_outlier)
+{
+	uint32_t const n_total = cum_hist[CMP_ENCODER_HIST_ENTRIES - 1];
+	uint32_t g_par_log2, outlier, max_outlier, max_value;
+	uint64_t golomb_part, best;
+
+	if (g_par < CMP_MIN_GOLOMB_PAR || g_par > CMP_MAX_GOLOMB_PAR)
+		return CMP_ERROR(PARAMS_INVALID);
+	if (n_bits < 1 || n_bits > CMP_NUM_BITS_PER_SAMPLE)
+		return CMP_ERROR(PARAMS_INVALID);
+	g_par_log2 = ilog2(g_par);
+
+	/* GOLOMB_ZERO: the outlier is fixed by the Golomb parameter */
+	outlier = min_u32(golomb_optimal_outlier_zero(g_par, n_bits),
+			  golomb_upper_bound(g_par, CMP_ENCODER_GOLOMB_ZERO, n_bits));
+	outlier = min_u32(outlier, CMP_ENCODER_HIST_ENTRIES);
+	*zero_len = golomb_hist_len(cum_hist, outlier, 1, g_par, g_par_log2) +
+		    (uint64_t)(n_total - hist_count_below(cum_hist, outlier)) *
+			    (g_par_log2 + 1 + n_bits);
+
+	/*
+	 * GOLOMB_MULTI: search the best outlier. Outliers above the largest
+	 * mapped value all result in the same size.
+	 */
+	for (max_value = CMP_ENCODER_HIST_ENTRIES - 1; max_value > 0; max_value--)
+		if (cum_hist[max_value] != cum_hist[max_value - 1])
+			break;
+	max_outlier = golomb_upper_bound(g_par, CMP_ENCODER_GOLOMB_MULTI, n_bits);
+	max_outlier = min_u32(max_outlier, max_value + 1);
+
+	best = UINT64_MAX;
+	*multi_outlier = 0;
+	golomb_part = 0;
+	for (outlier = 1; outlier <= max_outlier; outlier++) {
+		uint64_t len;
+		unsigned int level;
+
+		/* add the values that are now below the outlier */
+		golomb_part += (uint64_t)(cum_hist[outlier - 1] -
+					  hist_count_below(cum_hist, outlier - 1)) *
+			       golomb_len(outlier - 1, g_par, g_par_log2);
+
+		len = golomb_part;
+		for (level = 0; level < (n_bits + 1) / 2; level++) {
+			uint32_t const lo = outlier + (level ? 1U << (2 * level) : 0);
+			uint32_t const hi = outlier + (4U << (2 * level));
+			uint32_t n_escapes;
+
+			if (lo >= CMP_ENCODER_HIST_ENTRIES)
+				break;
+			n_escapes = hist_count_below(cum_hist, min_u32(hi, CMP_ENCODER_HIST_ENTRIES)) -
+				    hist_count_below(cum_hist, lo);
+			len += (uint64_t)n_escapes *
+			       (golomb_len(outlier + level, g_par, g_par_log2) + (level + 1) * 2);
+		}
+
+		if (len < best) {
+			best = len;
+			*multi_outlier = outlier;
+		}
+	}
+	*multi_len = best;
+
+	if (*multi_outlier == 0)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	return CMP_ERROR(NO_ERROR);
 }
 
 
@@ -27,6 +27,34 @@
 	(31 - __builtin_clz((uint32_t)CMP_MAX_GOLOMB_PAR) + 1 + CMP_NUM_BITS_PER_SAMPLE)
 #define CMP_MAX_BITS_MULTI_ESCAPE_CW (CMP_MAX_BITS_GOLOMB_CW + CMP_NUM_BITS_PER_SAMPLE)
 
+/* Largest order of the CMP_ENCODER_EXP_GOLOMB encoder */
+#define CMP_EXP_GOLOMB_MAX_K 15
+
+/* Largest and default block size of the CMP_ENCODER_BLOCK_RICE encoder */
+#define CMP_BLOCK_RICE_MAX_SIZE     64
+#define CMP_BLOCK_RICE_DEFAULT_SIZE 16
+
+/* Largest and default block size of the CMP_ENCODER_PFOR encoder */
+#define CMP_PFOR_MAX_SIZE     128
+#define CMP_PFOR_DEFAULT_SIZE 128
+
+/* Size of the sample buffer of the block based encoders */
+#define CMP_ENCODER_MAX_BLOCK_SIZE \
+	(CMP_BLOCK_RICE_MAX_SIZE > CMP_PFOR_MAX_SIZE ? CMP_BLOCK_RICE_MAX_SIZE : CMP_PFOR_MAX_SIZE)
+
+/* Default statistics reset interval of the CMP_ENCODER_ADAPTIVE_RICE encoder */
+#define CMP_ADAPTIVE_RICE_DEFAULT_RESET 64
+
+/* Largest and default number of interleaved states of the CMP_ENCODER_RANS encoder */
+#define CMP_RANS_MAX_STATES     8
+#define CMP_RANS_DEFAULT_STATES 4
+
+/* Number of bit length classes (0 to 16 bits) the CMP_ENCODER_RANS encoder models */
+#define CMP_RANS_N_SYMBOLS 17
+
+/* Number of different values a mapped sample can have */
+#define CMP_ENCODER_HIST_ENTRIES (1U << CMP_NUM_BITS_PER_SAMPLE)
+
 #define CMP_MAX_BITS_CODEWORD MAX(CMP_MAX_BITS_ZERO_ESCAPE_CW, CMP_MAX_BITS_MULTI_ESCAPE_CW)
 
 
@@ -39,11 +67,39 @@
 
 struct cmp_encoder {
 	enum cmp_encoder_type encoder_type; /** Algorithm used for encoding samples */
+	uint32_t n_bits; /**< Number of bits per sample; width of raw samples and escapes */
 
 	/* Golomb parameters (used only in GOLOMB modes, otherwise ignored) */
 	uint32_t g_par;      /**< Golomb parameter */
-	uint32_t g_par_log2; /**< Precomputed log2(Golomb parameter) for performance */
+	uint32_t g_par_log2; /**< Precomputed log2(Golomb parameter) for performance;
+			      *   order k in CMP_ENCODER_EXP_GOLOMB mode
+			      */
 	uint32_t outlier;    /**< Threshold value for encoding outliers */
+
+	/* Block parameters (used only in the block based modes, otherwise ignored) */
+	uint32_t block_size;                        /**< Number of samples per block */
+	uint32_t block_fill;                        /**< Number of buffered samples */
+	uint16_t block[CMP_ENCODER_MAX_BLOCK_SIZE]; /**< Mapped samples of the current block */
+	uint32_t pfor_pos_bits;   /**< Bits of an exception position (CMP_ENCODER_PFOR) */
+	uint32_t pfor_count_bits; /**< Bits of the exception count (CMP_ENCODER_PFOR) */
+
+	/* Adaptation state (used only in CMP_ENCODER_ADAPTIVE_RICE mode, otherwise ignored) */
+	uint32_t adapt_sum;   /**< Running sum of the recently encoded mapped samples */
+	uint32_t adapt_count; /**< Number of samples in the running sum */
+	uint32_t adapt_reset; /**< Count at which the running statistics are halved */
+
+	/* Zero-run coding (only enabled with cmp_encoder_enable_zero_run()) */
+	uint32_t zero_run;        /**< Runs of zero residuals are run-length coded if non-zero */
+	uint32_t zero_run_length; /**< Number of pending zero residuals */
+
+	/* rANS parameters (used only in CMP_ENCODER_RANS mode, otherwise ignored) */
+	uint32_t rans_n_states;                     /**< Number of interleaved states */
+	uint32_t rans_next_state;                   /**< State of the next sample */
+	uint32_t rans_state[CMP_RANS_MAX_STATES];   /**< Interleaved rANS states */
+	uint32_t rans_freq[CMP_RANS_N_SYMBOLS];     /**< Symbol counts; normalised once started */
+	uint32_t rans_cum_freq[CMP_RANS_N_SYMBOLS]; /**< Cumulative normalised frequencies */
+	int rans_started;                           /**< Frequency table is written */
+	int rans_raw;                               /**< Samples are stored without rANS */
 };
 
 
@@ -65,6 +121,38 @@ uint32_t cmp_encoder_init(struct cmp_encoder *enc, enum cmp_encoder_type encoder
 			  uint32_t encoder_param, uint32_t outlier);
 
 
+/**
+ * @brief Set the number of bits per sample
+ *
+ * Samples are mapped modulo 2^n_bits, so residuals wrap around at the bit
+ * depth of the data. Raw samples (escapes, uncompressed samples, raw blocks)
+ * are written with n_bits bits. The initial value is CMP_NUM_BITS_PER_SAMPLE.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param n_bits	number of bits per sample in [1, CMP_NUM_BITS_PER_SAMPLE]
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_encoder_set_n_bits(struct cmp_encoder *enc, unsigned int n_bits);
+
+
+/**
+ * @brief Enable zero-run coding
+ *
+ * Runs of zero residuals are collapsed into the codeword of a single zero
+ * followed by an order-0 Exp-Golomb coded run length minus one. Only the
+ * Golomb and Exp-Golomb encoders support zero-run coding.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ *
+ * @returns non-zero if zero-run coding is enabled, zero if the encoder does
+ *	not support it
+ */
+
+int cmp_encoder_enable_zero_run(struct cmp_encoder *enc);
+
+
 /**
  * @brief Encode a 16-bit signed sample
  *
@@ -73,21 +161,155 @@ uint32_t cmp_encoder_init(struct cmp_encoder *enc, enum cmp_encoder_type encoder
  * @param bs		Pointer to a bitstream writer; must be initialised and
  *			provided by the caller
  *
- * @note The caller is responsible for flushing the bitstream when encoding is
- *       complete to ensure all buffered bits are written. This function can
- *       only fail if the bitstream is small than cmp_compress_bound(), checking
- *       for this can be done with bitstream_error() or bitstream_flush().
+ * @note The caller is responsible for flushing the encoder with
+ *       cmp_encoder_flush() and the bitstream when encoding is complete to
+ *       ensure all buffered bits are written. This function can only fail if
+ *       the bitstream is small than cmp_compress_bound(), checking for this
+ *       can be done with bitstream_error() or bitstream_flush().
+ */
+
+void cmp_encoder_encode_s16(struct cmp_encoder *enc, int16_t value, struct bitstream_writer *bs);
+
+
+/**
+ * @brief Encode all samples buffered in the encoder
+ *
+ * Block based encoders (CMP_ENCODER_BLOCK_RICE, CMP_ENCODER_PFOR) buffer
+ * samples until a block is complete. This function encodes the last
+ * (incomplete) block. The CMP_ENCODER_RANS encoder writes its final states
+ * and zero-run coding writes the last pending run.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param bs		Pointer to a bitstream writer; must be initialised and
+ *			provided by the caller
+ */
+
+void cmp_encoder_flush(struct cmp_encoder *enc, struct bitstream_writer *bs);
+
+
+/**
+ * @brief Calculate the encoded length of a 16-bit signed sample
+ *
+ * Returns the exact number of bits cmp_encoder_encode_s16() would add to the
+ * bitstream for the same sample, without writing anything. For block based
+ * encoders the length of a block is returned when it is complete.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param value		16-bit signed sample to measure
+ *
+ * @returns the encoded length in bits
+ */
+
+uint32_t cmp_encoder_len_s16(struct cmp_encoder *enc, int16_t value);
+
+
+/**
+ * @brief Calculate the length cmp_encoder_flush() would add to the bitstream
+ *
+ * The encoder is not changed, so the length can be checked after every sample
+ * while the encoding goes on.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ *
+ * @returns the encoded length of the buffered samples in bits
+ */
+
+uint32_t cmp_encoder_len_flush(const struct cmp_encoder *enc);
+
+
+/**
+ * @brief Checks if the encoder needs a training pass over all samples
+ *
+ * Encoders with a static per-frame model (CMP_ENCODER_RANS) need every sample
+ * passed to cmp_encoder_train_s16() before the first sample is encoded or
+ * measured.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ *
+ * @returns non-zero if a training pass is needed
+ */
+
+int cmp_encoder_needs_training(const struct cmp_encoder *enc);
+
+
+/**
+ * @brief Adds a 16-bit signed sample to the statistics of the encoder model
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param value		16-bit signed sample that will be encoded later
+ */
+
+void cmp_encoder_train_s16(struct cmp_encoder *enc, int16_t value);
+
+
+/**
+ * @brief Map a 16-bit signed sample to the unsigned value used by the Golomb
+ *	encoders
+ *
+ * @param value		16-bit signed sample to map
+ * @param n_bits	number of bits per sample (see cmp_encoder_set_n_bits())
+ *
+ * @returns the ZigZag mapped value
+ */
+
+uint16_t cmp_encoder_map_s16(int16_t value, unsigned int n_bits);
+
+
+/**
+ * @brief Derives a Golomb parameter from the mean of mapped values
+ *
+ * @param sum		sum of the values returned by cmp_encoder_map_s16()
+ * @param n_values	number of summed values
+ *
+ * @returns a Golomb parameter in [CMP_MIN_GOLOMB_PAR, CMP_MAX_GOLOMB_PAR]
+ */
+
+uint32_t cmp_encoder_golomb_par_from_mean(uint64_t sum, uint32_t n_values);
+
+
+/**
+ * @brief Derives an Exp-Golomb order from the mean of mapped values
+ *
+ * @param sum		sum of the values returned by cmp_encoder_map_s16()
+ * @param n_values	number of summed values
+ *
+ * @returns an order in [0, CMP_EXP_GOLOMB_MAX_K]
+ */
+
+uint32_t cmp_encoder_exp_golomb_k_from_mean(uint64_t sum, uint32_t n_values);
+
+
+/**
+ * @brief Calculates the encoded length of all mapped values in a histogram
+ *	for both Golomb encoder types
+ *
+ * @param cum_hist	cumulative histogram of the values returned by
+ *			cmp_encoder_map_s16(); cum_hist[x] is the number of
+ *			mapped values <= x; CMP_ENCODER_HIST_ENTRIES entries
+ * @param g_par		Golomb parameter to evaluate
+ * @param n_bits	number of bits per sample (see cmp_encoder_set_n_bits())
+ * @param zero_len	pointer where the length in bits with
+ *			CMP_ENCODER_GOLOMB_ZERO is stored
+ * @param multi_len	pointer where the length in bits with
+ *			CMP_ENCODER_GOLOMB_MULTI and the best outlier is stored
+ * @param multi_outlier	pointer where the outlier parameter resulting in the
+ *			smallest CMP_ENCODER_GOLOMB_MULTI length is stored
+ *
+ * @note The cost of the outlier search is linear in the largest mapped value
+ *	in the histogram.
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
  */
 
-void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
-			    struct bitstream_writer *bs);
+uint32_t cmp_encoder_hist_costs(const uint32_t *cum_hist, uint32_t g_par, unsigned int n_bits,
+				uint64_t *zero_len, uint64_t *multi_len, uint32_t *multi_outlier);
 
 
 /**
  * @brief Checks if the given encoder type and parameter are valid
  *
  * @param encoder_type	Encoder type to check
- * @param encoder_param	Parameter for the encoder
+ * @param encoder_param	Parameter for the encoder or CMP_ENCODER_PARAM_AUTO
  * @param outlier	Outlier parameter needed for CMP_ENCODER_GOLOMB_MULTI
  *
  * @returns an error code, which can be checked using cmp_is_error()
@@ -127,6 +127,8 @@ static __inline int16_t iwt_edge_even_coefficient(int16_t centre, int16_t odd_co
  * @param n	total number of int16_t samples in input and output buffer
  * @param s	stride; spacing between elements processed; must be > 0
  *		(starts at 1, doubles each level in multi-level decomposition)
+ * @param lanes	number of adjacent signals transformed together; signal j
+ *		starts at x[j], 1 for a single signal
  *
  * @see implementation is based on equation (5.24) from
  *	D. Solomon, Data Compression, 4th ed, 2007, Springer, pp. 609-607
@@ -137,42 +139,233 @@ static __inline int16_t iwt_edge_even_coefficient(int16_t centre, int16_t odd_co
  *
  */
 
-static void iwt_single_level_i16(const int16_t *x, int16_t *y, size_t n, size_t s)
+static void iwt_single_level_i16(const int16_t *x, int16_t *y, size_t n, size_t s, size_t lanes)
 {
-	size_t i;
+	size_t i, j;
 
 	if (n == 0)
 		return;
 
 	/* Only one element: the output equals the input */
 	if (s >= n) {
-		y[0] = x[0];
+		for (j = 0; j < lanes; j++)
+			y[j] = x[j];
 		return;
 	}
 
 	/* Two elements to process, handle as a special case */
 	if (2 * s >= n) {
-		y[s] = iwt_last_odd_coefficient(x[s], x[0]);
-		y[0] = iwt_edge_even_coefficient(x[0], y[s]);
+		for (j = 0; j < lanes; j++) {
+			y[s + j] = iwt_last_odd_coefficient(x[s + j], x[j]);
+			y[j] = iwt_edge_even_coefficient(x[j], y[s + j]);
+		}
 		return;
 	}
 
 	/* Compute the first two coefficients outside the loop for performance */
-	y[s] = iwt_odd_coefficient(x[s], x[0], x[2 * s]);
-	y[0] = iwt_edge_even_coefficient(x[0], y[s]);
+	for (j = 0; j < lanes; j++) {
+		y[s + j] = iwt_odd_coefficient(x[s + j], x[j], x[2 * s + j]);
+		y[j] = iwt_edge_even_coefficient(x[j], y[s + j]);
+	}
 
 	/* Process the coefficients in the middle */
 	for (i = 2 * s; i < n - 2 * s; i += 2 * s) {
-		y[i + s] = iwt_odd_coefficient(x[i + s], x[i], x[i + 2 * s]);
-		y[i] = iwt_even_coefficient(x[i], y[i - s], y[i + s]);
+		for (j = i; j < i + lanes; j++) {
+			y[j + s] = iwt_odd_coefficient(x[j + s], x[j], x[j + 2 * s]);
+			y[j] = iwt_even_coefficient(x[j], y[j - s], y[j + s]);
+		}
 	}
 
 	/* Compute the last coefficient(s) outside the loop for performance */
 	if (i < n - s) { /* two elements over? */
-		y[i + s] = iwt_last_odd_coefficient(x[i + s], x[i]);
-		y[i] = iwt_even_coefficient(x[i], y[i - s], y[i + s]);
+		for (j = i; j < i + lanes; j++) {
+			y[j + s] = iwt_last_odd_coefficient(x[j + s], x[j]);
+			y[j] = iwt_even_coefficient(x[j], y[j - s], y[j + s]);
+		}
 	} else {
-		y[i] = iwt_edge_even_coefficient(x[i], y[i - s]);
+		for (j = i; j < i + lanes; j++)
+			y[j] = iwt_edge_even_coefficient(x[j], y[j - s]);
+	}
+}
+
+
+/**
+ * @brief Calculates the odd (high frequency) coefficient of the 9/7-M IWT
+ *
+ * @param centre	centre value of the kernel
+ * @param left2		second left neighbour value
+ * @param left		left neighbour value
+ * @param right		right neighbour value
+ * @param right2	second right neighbour value
+ *
+ * @returns the odd (high frequency) coefficient
+ */
+
+static __inline int16_t iwt97m_odd_coefficient(int16_t centre, int16_t left2, int16_t left,
+					       int16_t right, int16_t right2)
+{
+	return (int16_t)(centre - ((9 * (left + right) - (left2 + right2) + 8) >> 4));
+}
+
+
+/**
+ * @brief Perform single level Haar/S-transform for int16_t data
+ *
+ * @param x	pointer to the input data
+ * @param y	pointer to the output coefficients buffer (can be the same as x
+ *		for in-place calculation)
+ * @param n	total number of int16_t samples in input and output buffer
+ * @param s	stride; spacing between elements processed; must be > 0
+ * @param lanes	number of adjacent signals transformed together
+ *
+ * Uses the same coefficient arrangement as iwt_single_level_i16(); an
+ * unpaired last element is copied.
+ */
+
+static void haar_single_level_i16(const int16_t *x, int16_t *y, size_t n, size_t s, size_t lanes)
+{
+	size_t i, j;
+
+	for (i = 0; i + s < n; i += 2 * s) {
+		for (j = i; j < i + lanes; j++) {
+			int16_t const detail = (int16_t)(x[j + s] - x[j]);
+
+			y[j + s] = detail;
+			y[j] = (int16_t)(x[j] + floor_division_by_2(detail));
+		}
+	}
+	if (i < n)
+		for (j = i; j < i + lanes; j++)
+			y[j] = x[j];
+}
+
+
+/**
+ * @brief Perform single level 2/6 (TS) transform for int16_t data
+ *
+ * Refines the detail coefficients of the S-transform with the slope of the
+ * neighbouring approximation coefficients. A missing neighbour is replaced by
+ * the approximation coefficient of the own pair.
+ *
+ * @param x	pointer to the input data
+ * @param y	pointer to the output coefficients buffer (can be the same as x
+ *		for in-place calculation)
+ * @param n	total number of int16_t samples in input and output buffer
+ * @param s	stride; spacing between elements processed; must be > 0
+ * @param lanes	number of adjacent signals transformed together
+ *
+ * @see A. Zandi, J. D. Allen, E. L. Schwartz and M. Boliek, "CREW:
+ *	Compression with Reversible Embedded Wavelets", Proc. DCC, 1995
+ */
+
+static void ts_single_level_i16(const int16_t *x, int16_t *y, size_t n, size_t s, size_t lanes)
+{
+	size_t i, j;
+
+	haar_single_level_i16(x, y, n, s, lanes);
+
+	for (i = 0; i + s < n; i += 2 * s) {
+		size_t const prev = i >= 2 * s ? i - 2 * s : i;
+		size_t const next = i + 2 * s < n ? i + 2 * s : i;
+
+		for (j = 0; j < lanes; j++)
+			y[i + s + j] = (int16_t)(y[i + s + j] +
+						 floor_division_by_4(y[prev + j] - y[next + j]));
+	}
+}
+
+
+/**
+ * @brief Perform single level 9/7-M integer wavelet transform for int16_t data
+ *
+ * Integer approximation of the CDF 9/7 wavelet with a four tap prediction and
+ * the 5/3 update step. Odd coefficients too close to an edge for the four tap
+ * prediction use the 5/3 prediction.
+ *
+ * @param x	pointer to the input data
+ * @param y	pointer to the output coefficients buffer (can be the same as x
+ *		for in-place calculation)
+ * @param n	total number of int16_t samples in input and output buffer
+ * @param s	stride; spacing between elements processed; must be > 0
+ * @param lanes	number of adjacent signals transformed together
+ *
+ * @see M. D. Adams and F. Kossentini, "Reversible integer-to-integer wavelet
+ *	transforms for image compression", IEEE Trans. Image Process., vol. 9,
+ *	no. 6, pp. 1010-1024, 2000
+ */
+
+static void iwt97m_single_level_i16(const int16_t *x, int16_t *y, size_t n, size_t s,
+				    size_t lanes)
+{
+	size_t i, j;
+
+	if (s >= n) {
+		for (j = 0; j < lanes; j++)
+			y[j] = x[j];
+		return;
+	}
+
+	/* predict step; the middle loop has no edge cases */
+	i = s;
+	if (i + s < n) {
+		for (j = i; j < i + lanes; j++)
+			y[j] = iwt_odd_coefficient(x[j], x[j - s], x[j + s]);
+		i += 2 * s;
+	}
+	for (; i + 3 * s < n; i += 2 * s)
+		for (j = i; j < i + lanes; j++)
+			y[j] = iwt97m_odd_coefficient(x[j], x[j - 3 * s], x[j - s], x[j + s],
+						      x[j + 3 * s]);
+	for (; i < n; i += 2 * s) {
+		if (i + s < n)
+			for (j = i; j < i + lanes; j++)
+				y[j] = iwt_odd_coefficient(x[j], x[j - s], x[j + s]);
+		else
+			for (j = i; j < i + lanes; j++)
+				y[j] = iwt_last_odd_coefficient(x[j], x[j - s]);
+	}
+
+	/* update step */
+	for (j = 0; j < lanes; j++)
+		y[j] = iwt_edge_even_coefficient(x[j], y[s + j]);
+	for (i = 2 * s; i + s < n; i += 2 * s)
+		for (j = i; j < i + lanes; j++)
+			y[j] = iwt_even_coefficient(x[j], y[j - s], y[j + s]);
+	if (i < n)
+		for (j = i; j < i + lanes; j++)
+			y[j] = iwt_edge_even_coefficient(x[j], y[j - s]);
+}
+
+
+/**
+ * @brief Perform a single level transform with the selected wavelet kernel
+ *
+ * @param wavelet	wavelet kernel to use
+ * @param x		pointer to the input data
+ * @param y		pointer to the output coefficients buffer (can be the same
+ *			as x for in-place calculation)
+ * @param n		total number of int16_t samples in input and output buffer
+ * @param s		stride; spacing between elements processed; must be > 0
+ * @param lanes		number of adjacent signals transformed together
+ */
+
+static void wavelet_single_level_i16(enum cmp_wavelet wavelet, const int16_t *x, int16_t *y,
+				     size_t n, size_t s, size_t lanes)
+{
+	switch (wavelet) {
+	case CMP_WAVELET_HAAR:
+		haar_single_level_i16(x, y, n, s, lanes);
+		break;
+	case CMP_WAVELET_2_6:
+		ts_single_level_i16(x, y, n, s, lanes);
+		break;
+	case CMP_WAVELET_9_7_M:
+		iwt97m_single_level_i16(x, y, n, s, lanes);
+		break;
+	case CMP_WAVELET_5_3:
+	default:
+		iwt_single_level_i16(x, y, n, s, lanes);
+		break;
 	}
 }
 
@@ -185,10 +378,11 @@ static void iwt_single_level_i16(const int16_t *x, int16_t *y, size_t n, size_t
  * @param output	output buffer for decomposition coefficients (has to be
  *			same size as the input)
  * @param num_samples	number of int16_t samples in the input data buffer
+ * @param wavelet	wavelet kernel to use
  */
 
 static void iwt_multi_level_decomposition_i16(const struct sample_desc *src_desc, int16_t *output,
-					      size_t num_samples)
+					      size_t num_samples, enum cmp_wavelet wavelet)
 {
 	const int16_t *input;
 	size_t stride;
@@ -198,11 +392,11 @@ static void iwt_multi_level_decomposition_i16(const struct sample_desc *src_desc
 		return;
 	}
 
-	if (src_desc->dtype == CMP_I16_IN_I32) {
+	if (src_desc->stride != sizeof(int16_t) || src_desc->segments) {
 		uint32_t i;
 		/*
-		 * For non-contiguous 16-bit samples stored in 32-bit words,
-		 * we need to pack them into a contiguous array first.
+		 * For non-contiguous 16-bit samples, e.g. stored in 32-bit
+		 * words, we need to pack them into a contiguous array first.
 		 * TODO: Optimize by adding a stride parameter to
 		 * iwt_single_level_i16() to process non-contiguous data
 		 * directly.
@@ -215,12 +409,104 @@ static void iwt_multi_level_decomposition_i16(const struct sample_desc *src_desc
 	}
 
 	for (stride = 1; stride < num_samples; stride <<= 1) {
-		iwt_single_level_i16(input, output, num_samples, stride);
+		wavelet_single_level_i16(wavelet, input, output, num_samples, stride, 1);
 		input = output;
 	}
 }
 
 
+/**
+ * @brief Number of adjacent columns transformed together in the 2D IWT; one
+ *	cache line of int16_t samples
+ */
+
+#define IWT_2D_TILE_COLS 32
+
+
+/**
+ * @brief Performs a multi level integer wavelet transform (IWT) decomposition
+ *	along the columns of a 2D buffer of int16_t data in place
+ *
+ * The columns are transformed in tiles of IWT_2D_TILE_COLS adjacent columns.
+ * Every lifting step walks down the rows of a tile and updates all columns of
+ * a row together, so each loaded cache line is used completely instead of
+ * striding through the whole buffer for every column. A shorter last row is
+ * allowed; the columns reaching into it are one row higher than the others.
+ *
+ * @param buf		buffer holding the rows one after another
+ * @param n		number of int16_t samples in the buffer
+ * @param width		number of samples per row
+ * @param wavelet	wavelet kernel to use
+ */
+
+static void iwt_columns_i16(int16_t *buf, size_t n, size_t width, enum cmp_wavelet wavelet)
+{
+	size_t const last_row_len = n % width;
+	size_t c = 0;
+
+	while (c < width) {
+		size_t const height = (n - c + width - 1) / width;
+		size_t lanes = width - c < IWT_2D_TILE_COLS ? width - c : IWT_2D_TILE_COLS;
+		size_t stride;
+
+		/* a tile must not mix columns of different heights */
+		if (c < last_row_len && c + lanes > last_row_len)
+			lanes = last_row_len - c;
+
+		/*
+		 * Viewing the columns as 1D signals with a sample spacing of
+		 * width lets us reuse the 1D lifting steps.
+		 */
+		for (stride = 1; stride < height; stride <<= 1)
+			wavelet_single_level_i16(wavelet, buf + c, buf + c,
+						 (height - 1) * width + 1, stride * width, lanes);
+		c += lanes;
+	}
+}
+
+
+/**
+ * @brief Performs a separable multi level integer wavelet transform (IWT)
+ *	decomposition on a 2D frame of int16_t data
+ *
+ * First every row is decomposed, then every column.
+ *
+ * @param src_desc	source data descriptor pointer; the row width is taken
+ *			from src_desc->width
+ * @param output	output buffer for decomposition coefficients (has to be
+ *			same size as the input)
+ * @param wavelet	wavelet kernel to use
+ */
+
+static void iwt_2d_decomposition_i16(const struct sample_desc *src_desc, int16_t *output,
+				     enum cmp_wavelet wavelet)
+{
+	size_t const n = src_desc->num_samples;
+	size_t const width = src_desc->width;
+	struct sample_desc row = *src_desc;
+	const uint8_t *data = src_desc->data;
+	size_t r;
+
+	/* segmented data are packed first, the rows are then transformed in place */
+	if (src_desc->segments) {
+		for (r = 0; r < n; r++)
+			output[r] = sample_read_i16(src_desc, (uint32_t)r);
+		data = (const uint8_t *)output;
+		row.stride = sizeof(int16_t);
+		row.dtype = CMP_I16;
+		row.segments = NULL;
+	}
+
+	for (r = 0; r < n; r += width) {
+		row.data = data + r * row.stride;
+		row.num_samples = (uint32_t)(n - r < width ? n - r : width);
+		iwt_multi_level_decomposition_i16(&row, output + r, row.num_samples, wavelet);
+	}
+
+	iwt_columns_i16(output, n, width, wavelet);
+}
+
+
 /* ====== Preprocessing Method Functions ====== */
 /**
  * @brief Calculates the required work buffer size for none preprocessing
@@ -242,13 +528,14 @@ static uint32_t none_get_work_buf_size(uint32_t input_size UNUSED)
  * @param src_desc	source data descriptor pointer
  * @param work_buf	unused
  * @param work_buf_size	unused
+ * @param param		unused
  *
  * @returns returns the number of elements to preprocess or an error, which can
  *	be checked with cmp_is_error()
  */
 
 static uint32_t none_init(const struct sample_desc *src_desc, void *work_buf UNUSED,
-			  uint32_t work_buf_size UNUSED)
+			  uint32_t work_buf_size UNUSED, uint32_t param UNUSED)
 {
 	return src_desc->num_samples;
 }
@@ -290,6 +577,89 @@ static int16_t diff_process(uint32_t i, const struct sample_desc *src_desc, void
 }
 
 
+/**
+ * @brief Converts a 16-bit sample into its value in the range of the data type
+ *
+ * @param value	sample as read by sample_read_i16()
+ * @param dtype	data type of the sample
+ *
+ * @returns the sample value; CMP_U16 samples are not negative
+ */
+
+static __inline int32_t sample_value(int16_t value, enum cmp_type dtype)
+{
+	if (dtype == CMP_U16)
+		return (uint16_t)value;
+	return value;
+}
+
+
+/**
+ * @brief Calculates the median edge detector (MED) prediction
+ *
+ * Predicts the minimum of the left and upper neighbour when an edge is above
+ * or left of the sample and the planar prediction left + up - up_left
+ * otherwise. The neighbours have to be given in the range of the data type
+ * (see sample_value()), CMP_U16 samples compare wrongly as int16_t.
+ *
+ * @param left		left neighbour value
+ * @param up		upper neighbour value
+ * @param up_left	upper-left neighbour value
+ *
+ * @returns the predicted value
+ *
+ * @see M. J. Weinberger, G. Seroussi and G. Sapiro, "The LOCO-I lossless image
+ *	compression algorithm: principles and standardization into JPEG-LS",
+ *	IEEE Trans. Image Process., vol. 9, no. 8, pp. 1309-1324, 2000
+ */
+
+static __inline int32_t med_predict(int32_t left, int32_t up, int32_t up_left)
+{
+	int32_t const min_lu = left < up ? left : up;
+	int32_t const max_lu = left < up ? up : left;
+
+	if (up_left >= max_lu)
+		return min_lu;
+	if (up_left <= min_lu)
+		return max_lu;
+	return left + up - up_left;
+}
+
+
+/**
+ * @brief Processes data using 2d median edge detector (MED) preprocessing
+ *
+ * The first row falls back to 1d difference preprocessing, the first sample
+ * of the other rows is predicted from the sample above.
+ *
+ * @param i		index of the data
+ * @param src_desc	source data descriptor pointer; the row width is taken
+ *			from src_desc->width
+ * @param work_buf	unused
+ *
+ * @returns the processed data at index i
+ */
+
+static int16_t med_process(uint32_t i, const struct sample_desc *src_desc, void *work_buf)
+{
+	uint32_t const width = src_desc->width;
+	enum cmp_type const dtype = src_desc->dtype;
+	int32_t pred;
+
+	if (i < width)
+		return diff_process(i, src_desc, work_buf);
+
+	if (i % width == 0)
+		pred = sample_read_i16(src_desc, i - width);
+	else
+		pred = med_predict(sample_value(sample_read_i16(src_desc, i - 1), dtype),
+				   sample_value(sample_read_i16(src_desc, i - width), dtype),
+				   sample_value(sample_read_i16(src_desc, i - width - 1), dtype));
+
+	return (int16_t)(sample_read_i16(src_desc, i) - pred);
+}
+
+
 /**
  * @brief Calculates the required work buffer size for IWT preprocessing
  *
@@ -313,12 +683,14 @@ static uint32_t iwt_get_work_buf_size(uint32_t input_size)
  * @param src_desc	source data descriptor pointer
  * @param work_buf	pointer to the working buffer for temporary results
  * @param work_buf_size	size in bytes of the working buffer
+ * @param wavelet	wavelet kernel (enum cmp_wavelet)
  *
  * @returns the number of samples to process or an error code is returned (which
  *	can be checked using cmp_is_error()).
  */
 
-static uint32_t iwt_init(const struct sample_desc *src_desc, void *work_buf, uint32_t work_buf_size)
+static uint32_t iwt_init(const struct sample_desc *src_desc, void *work_buf, uint32_t work_buf_size,
+			 uint32_t wavelet)
 {
 	int16_t *pre_cal_coefficient = (int16_t *)work_buf;
 
@@ -329,7 +701,41 @@ static uint32_t iwt_init(const struct sample_desc *src_desc, void *work_buf, uin
 	if ((uintptr_t)work_buf & (sizeof(*pre_cal_coefficient) - 1))
 		return CMP_ERROR(WORK_BUF_UNALIGNED);
 
-	iwt_multi_level_decomposition_i16(src_desc, pre_cal_coefficient, src_desc->num_samples);
+	iwt_multi_level_decomposition_i16(src_desc, pre_cal_coefficient, src_desc->num_samples,
+					  (enum cmp_wavelet)wavelet);
+
+	return src_desc->num_samples;
+}
+
+
+/**
+ * @brief Initializes 2D IWT preprocessing
+ *
+ * This function pre-calculates the 2D IWT coefficient and put them in the
+ * working buffer
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer for temporary results
+ * @param work_buf_size	size in bytes of the working buffer
+ * @param wavelet	wavelet kernel (enum cmp_wavelet)
+ *
+ * @returns the number of samples to process or an error code is returned (which
+ *	can be checked using cmp_is_error()).
+ */
+
+static uint32_t iwt_2d_init(const struct sample_desc *src_desc, void *work_buf,
+			    uint32_t work_buf_size, uint32_t wavelet)
+{
+	int16_t *pre_cal_coefficient = (int16_t *)work_buf;
+
+	if (!work_buf)
+		return CMP_ERROR(WORK_BUF_NULL);
+	if (work_buf_size < iwt_get_work_buf_size(get_packed_size(src_desc)))
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+	if ((uintptr_t)work_buf & (sizeof(*pre_cal_coefficient) - 1))
+		return CMP_ERROR(WORK_BUF_UNALIGNED);
+
+	iwt_2d_decomposition_i16(src_desc, pre_cal_coefficient, (enum cmp_wavelet)wavelet);
 
 	return src_desc->num_samples;
 }
@@ -353,6 +759,154 @@ static int16_t iwt_process(uint32_t i, const struct sample_desc *src_desc UNUSED
 }
 
 
+/**
+ * @brief Calculates the residual of a fixed polynomial predictor
+ *
+ * The order k predictor extrapolates the polynomial of degree k - 1 through the
+ * k previous samples, e.g. order 2: x[i] - (2 * x[i-1] - x[i-2]).
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param i		index of the data; must be >= order
+ * @param order		predictor order; must be <= CMP_FIXED_ORDER_MAX
+ *
+ * @returns the residual at index i
+ */
+
+static __inline int16_t fixed_residual(const struct sample_desc *src_desc, uint32_t i,
+				       uint32_t order)
+{
+	int32_t const x0 = sample_read_i16(src_desc, i);
+
+	switch (order) {
+	case 0:
+		return (int16_t)x0;
+	case 1:
+		return (int16_t)(x0 - sample_read_i16(src_desc, i - 1));
+	case 2:
+		return (int16_t)(x0 - 2 * sample_read_i16(src_desc, i - 1) +
+				 sample_read_i16(src_desc, i - 2));
+	case 3:
+	default:
+		return (int16_t)(x0 - 3 * sample_read_i16(src_desc, i - 1) +
+				 3 * sample_read_i16(src_desc, i - 2) -
+				 sample_read_i16(src_desc, i - 3));
+	}
+}
+
+
+/**
+ * @brief Calculates the fixed predictor residuals of all samples
+ *
+ * The first samples, which have less than order predecessors, use the highest
+ * possible order. The remaining samples are processed in one loop per order so
+ * that the compiler can specialise (and vectorise) each of them.
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param residuals	output buffer for the residuals
+ * @param order		predictor order; must be <= CMP_FIXED_ORDER_MAX
+ */
+
+static void fixed_residuals_i16(const struct sample_desc *src_desc, int16_t *residuals,
+				uint32_t order)
+{
+	uint32_t const n = src_desc->num_samples;
+	uint32_t i;
+
+	for (i = 0; i < n && i < order; i++)
+		residuals[i] = fixed_residual(src_desc, i, i);
+
+	switch (order) {
+	case 0:
+		for (; i < n; i++)
+			residuals[i] = fixed_residual(src_desc, i, 0);
+		break;
+	case 1:
+		for (; i < n; i++)
+			residuals[i] = fixed_residual(src_desc, i, 1);
+		break;
+	case 2:
+		for (; i < n; i++)
+			residuals[i] = fixed_residual(src_desc, i, 2);
+		break;
+	case 3:
+	default:
+		for (; i < n; i++)
+			residuals[i] = fixed_residual(src_desc, i, 3);
+		break;
+	}
+}
+
+
+/**
+ * @brief Calculates the required work buffer size for fixed predictor
+ *	preprocessing
+ *
+ * @param input_size	size of the data to perform the preprocessing
+ *
+ * @returns the minimum required work buffer size
+ */
+
+static uint32_t fixed_get_work_buf_size(uint32_t input_size)
+{
+	return ROUND_UP_TO_NEXT_2(input_size);
+}
+
+
+/**
+ * @brief Initializes fixed predictor preprocessing
+ *
+ * This function pre-calculates the residuals and put them in the working
+ * buffer
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer for temporary results
+ * @param work_buf_size	size in bytes of the working buffer
+ * @param order		predictor order; CMP_FIXED_ORDER_AUTO has to be resolved
+ *			with preprocessing_fixed_select_order() beforehand
+ *
+ * @returns the number of samples to process or an error code is returned (which
+ *	can be checked using cmp_is_error()).
+ */
+
+static uint32_t fixed_init(const struct sample_desc *src_desc, void *work_buf,
+			   uint32_t work_buf_size, uint32_t order)
+{
+	int16_t *residuals = (int16_t *)work_buf;
+
+	if (order > CMP_FIXED_ORDER_MAX)
+		return CMP_ERROR(PARAMS_INVALID);
+	if (!work_buf)
+		return CMP_ERROR(WORK_BUF_NULL);
+	if (work_buf_size < fixed_get_work_buf_size(get_packed_size(src_desc)))
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+	if ((uintptr_t)work_buf & (sizeof(*residuals) - 1))
+		return CMP_ERROR(WORK_BUF_UNALIGNED);
+
+	fixed_residuals_i16(src_desc, residuals, order);
+
+	return src_desc->num_samples;
+}
+
+
+/**
+ * @brief Processes data using fixed predictor preprocessing
+ *
+ * @param i		index of the data
+ * @param src_desc	unused (residuals are pre-calculated in work_buf)
+ * @param work_buf	pointer to the working buffer
+ *
+ * @returns the processed data at index i
+ */
+
+static int16_t fixed_process(uint32_t i, const struct sample_desc *src_desc UNUSED,
+			     void *work_buf)
+{
+	int16_t *residuals = work_buf;
+
+	return residuals[i];
+}
+
+
 /**
  * @brief Calculates the required work buffer size for model preprocessing
  *
@@ -374,13 +928,15 @@ static uint32_t model_get_work_buf_size(uint32_t input_size)
  * @param work_buf	pointer to the buffer where the model to be subtracted
  *			from data is stored
  * @param work_buf_size	size in bytes of the working buffer
+ * @param param		unused; the model rate is applied when updating the
+ *			model
  *
  * @returns the number of samples to process or an error code is returned (which
  *	can be checked using cmp_is_error()).
  */
 
 static uint32_t model_init(const struct sample_desc *src_desc, void *work_buf,
-			   uint32_t work_buf_size)
+			   uint32_t work_buf_size, uint32_t param UNUSED)
 {
 	if (!work_buf)
 		return CMP_ERROR(WORK_BUF_NULL);
@@ -411,14 +967,209 @@ static int16_t model_process(uint32_t i, const struct sample_desc *src_desc, voi
 }
 
 
+/* ====== Near-Lossless Preprocessing ====== */
+/**
+ * @brief Quantizes a prediction error with a step size of 2 * delta + 1
+ *
+ * @param error	prediction error
+ * @param delta	maximum absolute reconstruction error
+ *
+ * @returns the quantized prediction error, rounded to the nearest step
+ */
+
+static __inline int16_t nl_quantize(int32_t error, uint32_t delta)
+{
+	int32_t const step = (int32_t)(2 * delta + 1);
+
+	if (error >= 0)
+		return (int16_t)((error + (int32_t)delta) / step);
+	return (int16_t)-(((int32_t)delta - error) / step);
+}
+
+
+/**
+ * @brief Calculates the required work buffer size for near-lossless
+ *	preprocessing
+ *
+ * The quantized residuals are stored behind a region of the size of the data,
+ * which holds the model when used with CMP_PREPROCESS_MODEL.
+ *
+ * @param input_size	size of the data to perform the preprocessing
+ *
+ * @returns the minimum required work buffer size
+ */
+
+static uint32_t nl_get_work_buf_size(uint32_t input_size)
+{
+	return 2 * ROUND_UP_TO_NEXT_2(input_size);
+}
+
+
+/* returns the quantized residuals behind the model region of the working buffer */
+static int16_t *nl_residuals(const struct sample_desc *src_desc, void *work_buf)
+{
+	return (int16_t *)((uint8_t *)work_buf + ROUND_UP_TO_NEXT_2(get_packed_size(src_desc)));
+}
+
+
+/**
+ * @brief Checks the working buffer for near-lossless preprocessing
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer
+ * @param work_buf_size	size in bytes of the working buffer
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static uint32_t nl_check_work_buf(const struct sample_desc *src_desc, const void *work_buf,
+				  uint32_t work_buf_size)
+{
+	if (!work_buf)
+		return CMP_ERROR(WORK_BUF_NULL);
+	if (work_buf_size < nl_get_work_buf_size(get_packed_size(src_desc)))
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+	if ((uintptr_t)work_buf & (sizeof(uint16_t) - 1))
+		return CMP_ERROR(WORK_BUF_UNALIGNED);
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Initializes near-lossless preprocessing without prediction
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer
+ * @param work_buf_size	size in bytes of the working buffer
+ * @param delta		maximum absolute reconstruction error
+ *
+ * @returns the number of samples to process or an error code is returned (which
+ *	can be checked using cmp_is_error()).
+ */
+
+static uint32_t nl_none_init(const struct sample_desc *src_desc, void *work_buf,
+			     uint32_t work_buf_size, uint32_t delta)
+{
+	uint32_t i, ret;
+	int16_t *residuals;
+
+	ret = nl_check_work_buf(src_desc, work_buf, work_buf_size);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	residuals = nl_residuals(src_desc, work_buf);
+	for (i = 0; i < src_desc->num_samples; i++)
+		residuals[i] = nl_quantize(
+			sample_value(sample_read_i16(src_desc, i), src_desc->dtype), delta);
+
+	return src_desc->num_samples;
+}
+
+
+/**
+ * @brief Initializes near-lossless 1d difference preprocessing
+ *
+ * Every sample is predicted by the reconstruction of its left neighbour, as
+ * the decompressor sees it, so that the quantization errors do not
+ * accumulate.
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer
+ * @param work_buf_size	size in bytes of the working buffer
+ * @param delta		maximum absolute reconstruction error
+ *
+ * @returns the number of samples to process or an error code is returned (which
+ *	can be checked using cmp_is_error()).
+ */
+
+static uint32_t nl_diff_init(const struct sample_desc *src_desc, void *work_buf,
+			     uint32_t work_buf_size, uint32_t delta)
+{
+	uint32_t i, ret;
+	int16_t *residuals;
+	int16_t reconstructed = 0;
+
+	ret = nl_check_work_buf(src_desc, work_buf, work_buf_size);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	residuals = nl_residuals(src_desc, work_buf);
+	for (i = 0; i < src_desc->num_samples; i++) {
+		int32_t const value = sample_value(sample_read_i16(src_desc, i),
+						      src_desc->dtype);
+
+		residuals[i] = nl_quantize(value - sample_value(reconstructed, src_desc->dtype),
+					   delta);
+		reconstructed = preprocessing_near_lossless_reconstruct(reconstructed, residuals[i],
+									 delta, src_desc->dtype);
+	}
+
+	return src_desc->num_samples;
+}
+
+
+/**
+ * @brief Initializes near-lossless model preprocessing
+ *
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer starting with the model,
+ *			which has to hold reconstructed data
+ * @param work_buf_size	size in bytes of the working buffer
+ * @param delta		maximum absolute reconstruction error
+ *
+ * @returns the number of samples to process or an error code is returned (which
+ *	can be checked using cmp_is_error()).
+ */
+
+static uint32_t nl_model_init(const struct sample_desc *src_desc, void *work_buf,
+			      uint32_t work_buf_size, uint32_t delta)
+{
+	uint32_t i, ret;
+	const int16_t *model = work_buf;
+	int16_t *residuals;
+
+	ret = nl_check_work_buf(src_desc, work_buf, work_buf_size);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	residuals = nl_residuals(src_desc, work_buf);
+	for (i = 0; i < src_desc->num_samples; i++)
+		residuals[i] = nl_quantize(
+			sample_value(sample_read_i16(src_desc, i), src_desc->dtype) -
+				sample_value(model[i], src_desc->dtype),
+			delta);
+
+	return src_desc->num_samples;
+}
+
+
+/**
+ * @brief Gets a quantized residual of the near-lossless preprocessing
+ *
+ * @param i		index of the data
+ * @param src_desc	source data descriptor pointer
+ * @param work_buf	pointer to the working buffer
+ *
+ * @returns the quantized residual of the i-th data sample
+ */
+
+static int16_t nl_process(uint32_t i, const struct sample_desc *src_desc, void *work_buf)
+{
+	return nl_residuals(src_desc, work_buf)[i];
+}
+
+
 /* ====== Public API ====== */
 const struct preprocessing_method *preprocessing_get_method(enum cmp_preprocessing type)
 {
 	static const struct preprocessing_method preprocessing_methods[] = {
-		{ CMP_PREPROCESS_NONE,  none_get_work_buf_size,  none_init,  none_process  },
-		{ CMP_PREPROCESS_DIFF,  none_get_work_buf_size,  none_init,  diff_process  },
-		{ CMP_PREPROCESS_IWT,   iwt_get_work_buf_size,   iwt_init,   iwt_process   },
-		{ CMP_PREPROCESS_MODEL, model_get_work_buf_size, model_init, model_process }
+		{ CMP_PREPROCESS_NONE,   none_get_work_buf_size,  none_init,   none_process  },
+		{ CMP_PREPROCESS_DIFF,   none_get_work_buf_size,  none_init,   diff_process  },
+		{ CMP_PREPROCESS_IWT,    iwt_get_work_buf_size,   iwt_init,    iwt_process   },
+		{ CMP_PREPROCESS_MODEL,  model_get_work_buf_size, model_init,  model_process },
+		{ CMP_PREPROCESS_MED,    none_get_work_buf_size,  none_init,   med_process   },
+		{ CMP_PREPROCESS_IWT_2D, iwt_get_work_buf_size,   iwt_2d_init, iwt_process   },
+		{ CMP_PREPROCESS_FIXED,  fixed_get_work_buf_size, fixed_init,  fixed_process }
 	};
 	size_t i;
 
@@ -428,3 +1179,77 @@ const struct preprocessing_method *preprocessing_get_method(enum cmp_preprocessi
 	}
 	return NULL;
 }
+
+
+const struct preprocessing_method *
+preprocessing_near_lossless_get_method(enum cmp_preprocessing type)
+{
+	static const struct preprocessing_method near_lossless_methods[] = {
+		{ CMP_PREPROCESS_NONE,  nl_get_work_buf_size, nl_none_init,  nl_process },
+		{ CMP_PREPROCESS_DIFF,  nl_get_work_buf_size, nl_diff_init,  nl_process },
+		{ CMP_PREPROCESS_MODEL, nl_get_work_buf_size, nl_model_init, nl_process }
+	};
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(near_lossless_methods); i++) {
+		if (near_lossless_methods[i].type == type)
+			return &near_lossless_methods[i];
+	}
+	return NULL;
+}
+
+
+int16_t preprocessing_near_lossless_reconstruct(int16_t prediction, int16_t residual,
+						 uint32_t delta, enum cmp_type dtype)
+{
+	int32_t const min = dtype == CMP_U16 ? 0 : INT16_MIN;
+	int32_t const max = dtype == CMP_U16 ? UINT16_MAX : INT16_MAX;
+	int32_t value = sample_value(prediction, dtype) + residual * (int32_t)(2 * delta + 1);
+
+	/* clamping moves the value towards the sample, it stays within delta */
+	if (value < min)
+		value = min;
+	if (value > max)
+		value = max;
+
+	return (int16_t)value;
+}
+
+
+uint32_t preprocessing_fixed_select_order(const struct sample_desc *src_desc)
+{
+	uint64_t cost[CMP_FIXED_ORDER_MAX + 1] = { 0 };
+	uint32_t i, order, best_order = 0;
+
+	/* the first samples do not have enough predecessors for all orders */
+	for (i = CMP_FIXED_ORDER_MAX; i < src_desc->num_samples; i++) {
+		for (order = 0; order <= CMP_FIXED_ORDER_MAX; order++) {
+			int32_t const residual = fixed_residual(src_desc, i, order);
+
+			cost[order] += (uint32_t)(residual < 0 ? -residual : residual);
+		}
+	}
+
+	for (order = 1; order <= CMP_FIXED_ORDER_MAX; order++)
+		if (cost[order] < cost[best_order])
+			best_order = order;
+
+	return best_order;
+}
+
+
+void preprocessing_temporal_decomposition_i16(const struct sample_desc *src_desc,
+					      uint32_t frame_samples, enum cmp_wavelet wavelet,
+					      int16_t *subbands)
+{
+	uint32_t i;
+
+	for (i = 0; i < src_desc->num_samples; i++)
+		subbands[i] = sample_read_i16(src_desc, i);
+
+	/*
+	 * With the frames stored one after another, the samples of a pixel
+	 * over time form a column of a frame_samples wide buffer.
+	 */
+	iwt_columns_i16(subbands, src_desc->num_samples, frame_samples, wavelet);
+}
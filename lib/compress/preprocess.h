@@ -13,7 +13,7 @@
  * if (preprocess == NULL)
  *	return -1; /1* Handle error: Preprocessing method not found *1/
  *
- * uint32_t n_values = preprocess->init(src, work_buf, work_buf_size);
+ * uint32_t n_values = preprocess->init(src, work_buf, work_buf_size, CMP_WAVELET_5_3);
  * if (cmp_is_error_int(n_values))  /1* Handle error: Preprocessing initialization failed *1/
  *	return n_values;
  *
@@ -52,7 +52,7 @@ struct preprocessing_method {
 	enum cmp_preprocessing type;
 	uint32_t (*get_work_buf_size)(uint32_t input_size);
 	uint32_t (*init)(const struct sample_desc *src_desc, void *work_buf,
-			 uint32_t work_buf_size);
+			 uint32_t work_buf_size, uint32_t param);
 	int16_t (*process)(uint32_t i, const struct sample_desc *src_desc, void *work_buf);
 };
 
@@ -68,4 +68,74 @@ struct preprocessing_method {
 const struct preprocessing_method *preprocessing_get_method(enum cmp_preprocessing type);
 
 
+/**
+ * @brief Gets the near-lossless variant of a preprocessing method
+ *
+ * The near-lossless methods quantize the prediction residuals with a step size
+ * of 2 * delta + 1; the delta is passed as the init() parameter. Predictions
+ * are made from reconstructed data, so that the absolute reconstruction error
+ * of every sample is at most delta. With CMP_PREPROCESS_MODEL the working
+ * buffer has to start with a model of reconstructed data.
+ *
+ * @param type	preprocessing method type; CMP_PREPROCESS_NONE,
+ *		CMP_PREPROCESS_DIFF or CMP_PREPROCESS_MODEL
+ *
+ * @returns a pointer to the cmp_preprocessing structure, or NULL if the type
+ *	has no near-lossless variant
+ */
+
+const struct preprocessing_method *
+preprocessing_near_lossless_get_method(enum cmp_preprocessing type);
+
+
+/**
+ * @brief Reconstructs a sample from its prediction and its quantized residual
+ *	like the decompressor does
+ *
+ * @param prediction	predicted sample as read by sample_read_i16()
+ * @param residual	quantized residual
+ * @param delta		maximum absolute reconstruction error
+ * @param dtype		data type of the sample
+ *
+ * @returns the reconstructed sample, clamped to the range of the data type
+ */
+
+int16_t preprocessing_near_lossless_reconstruct(int16_t prediction, int16_t residual,
+						 uint32_t delta, enum cmp_type dtype);
+
+
+/**
+ * @brief Selects the order of the fixed polynomial predictor for a frame
+ *
+ * @param src_desc	source data descriptor pointer
+ *
+ * @returns the order between 0 and CMP_FIXED_ORDER_MAX with the smallest sum of
+ *	absolute residuals
+ */
+
+uint32_t preprocessing_fixed_select_order(const struct sample_desc *src_desc);
+
+
+/**
+ * @brief Performs a multi level temporal integer wavelet transform (IWT)
+ *	decomposition on a group of frames
+ *
+ * Every pixel is transformed along the time axis. Subband t of the result
+ * holds the coefficients with index t of all pixels, using the same
+ * coefficient order as the 1D CMP_PREPROCESS_IWT; subband 0 is the temporal
+ * approximation.
+ *
+ * @param src_desc	source data descriptor pointer holding the frames of
+ *			the group one after another
+ * @param frame_samples	number of samples per frame
+ * @param wavelet	wavelet kernel to use
+ * @param subbands	output buffer for the subbands, one frame_samples sized
+ *			subband after another (has to be same size as the input)
+ */
+
+void preprocessing_temporal_decomposition_i16(const struct sample_desc *src_desc,
+					      uint32_t frame_samples, enum cmp_wavelet wavelet,
+					      int16_t *subbands);
+
+
 #endif /* CMP_PREPROCESS_H */
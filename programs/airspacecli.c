@@ -92,8 +92,8 @@ static const char *add_airspace_suffix(const char *str)
 }
 
 
-static void log_file_status(enum log_level level, const char *input_filename, uint32_t input_size,
-			    const char *output_name, uint32_t output_size)
+static void log_file_status(enum log_level level, const char *input_filename, size_t input_size,
+			    const char *output_name, size_t output_size)
 {
 	int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
 	struct hr_fmt const hr_i = util_make_human_readable(input_size, verbose);
@@ -112,8 +112,8 @@ static void log_summery(const char **input_files, int num_files, size_t sum_inpu
 	if (num_files == 1) { /* one file -> display the file status instead of the summery */
 		/* if not already done in the log file status */
 		if (log_get_level() < LOG_LEVEL_DEBUG) {
-			log_file_status(LOG_LEVEL_INFO, input_files[0], (uint32_t)sum_input_size,
-					output_name, (uint32_t)sum_output_size);
+			log_file_status(LOG_LEVEL_INFO, input_files[0], sum_input_size,
+					output_name, sum_output_size);
 		}
 	} else {
 		int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
@@ -146,14 +146,22 @@ static int compress_file_list(const char *output_name, const char **input_files,
 	assert(params);
 
 	{ /* Initialization setup */
-		uint32_t first_file_size;
+		size_t max_frame_size = 0;
 		uint32_t work_buf_size;
 		uint32_t return_code;
 
-		/* Allocate work buff if need */
-		if (file_get_size_u32(input_files[0], &first_file_size))
-			goto cleanup;
-		work_buf_size = cmp_cal_work_buf_size(params, first_file_size);
+		/* Allocate work buff if need; large files are compressed in chunks */
+		for (i = 0; i < num_files; i++) {
+			size_t file_size;
+
+			if (file_get_size(input_files[i], &file_size))
+				goto cleanup;
+			if (file_size > FILE_CHUNK_SIZE)
+				file_size = FILE_CHUNK_SIZE;
+			if (file_size > max_frame_size)
+				max_frame_size = file_size;
+		}
+		work_buf_size = cmp_cal_work_buf_size(params, (uint32_t)max_frame_size);
 		if (cmp_is_error(work_buf_size)) {
 			LOG_ERROR_CMP(work_buf_size, "Error calculating work buffer size");
 			goto cleanup;
@@ -169,20 +177,19 @@ static int compress_file_list(const char *output_name, const char **input_files,
 	}
 
 	for (i = 0; i < num_files; i++) {
-		uint32_t output_size;
+		size_t output_size;
 
 		assert(input_files[i]);
 		if (needs_output_name)
 			output_name = add_airspace_suffix(input_files[i]);
 
-		output_size = file_compress(&ctx, output_name, input_files[i]);
-		if (cmp_is_error(output_size))
+		if (cmp_is_error(file_compress(&ctx, output_name, input_files[i], &output_size)))
 			goto cleanup;
 
 		{ /* compression done; do some longing */
-			uint32_t input_size;
+			size_t input_size;
 
-			(void)file_get_size_u32(input_files[i], &input_size);
+			(void)file_get_size(input_files[i], &input_size);
 			log_file_status(LOG_LEVEL_DEBUG, input_files[i], input_size, output_name,
 					output_size);
 			sum_input_size += input_size;
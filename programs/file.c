@@ -111,23 +111,27 @@ static int file_close(FILE *fp, const char *filename)
 /**
  * @brief read stdin into a static allocated buffer
  *
- * @param blob		blob to put the stdin content
- * @param blob_size	blob size
+ * Standard input is read completely on the first call; later calls return the
+ * same buffer.
  *
- * @returns 0 on success or -1 on error
+ * @param data		pointer to store the address of the stdin content
+ * @param data_size	pointer to store the size of the stdin content
+ *
+ * @returns 0 on success or -1 on error; empty stdin is an error
  */
 
-static int file_read_stdin(void *blob, size_t *blob_size)
+static int file_buffer_stdin(const uint8_t **data, size_t *data_size)
 {
 	static uint8_t *buffer;
 	static size_t buffer_size;
 
 	size_t buffer_capacity = 4096; /* Start with 4KB */
 
-	assert(blob_size);
+	assert(data);
+	assert(data_size);
 
 	if (!buffer) {
-		*blob_size = 0;
+		*data_size = 0;
 
 		buffer = malloc(buffer_capacity);
 		if (!buffer) {
@@ -179,16 +183,43 @@ static int file_read_stdin(void *blob, size_t *blob_size)
 		}
 	}
 
+	*data = buffer;
+	*data_size = buffer_size;
+	return buffer_size == 0 ? -1 : 0;
+}
+
+
+/**
+ * @brief read stdin into a blob
+ *
+ * @param blob		blob to put the stdin content; NULL to only get the size
+ * @param blob_size	blob size
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int file_read_stdin(void *blob, size_t *blob_size)
+{
+	const uint8_t *data;
+	size_t data_size;
+
+	assert(blob_size);
+
+	if (file_buffer_stdin(&data, &data_size)) {
+		*blob_size = 0;
+		return -1;
+	}
+
 	/* Return the results */
 	if (blob) {
-		if (buffer_size > *blob_size) {
+		if (data_size > *blob_size) {
 			*blob_size = 0;
 			return -1;
 		}
-		memcpy(blob, buffer, buffer_size);
+		memcpy(blob, data, data_size);
 	}
-	*blob_size = buffer_size;
-	return buffer_size == 0;
+	*blob_size = data_size;
+	return 0;
 }
 
 
@@ -202,7 +233,7 @@ static int file_read_stdin(void *blob, size_t *blob_size)
  * @returns size of file or -1 on error; empty file is an error
  */
 
-static int file_get_size(const char *filename, size_t *file_size)
+int file_get_size(const char *filename, size_t *file_size)
 {
 	FILE *fp;
 	struct stat st;
@@ -358,6 +389,47 @@ static int file_load_be16(const char *filename, uint16_t *buffer, size_t buffer_
 }
 
 
+/**
+ * @brief create a new file for writing
+ *
+ * Refuses to overwrite an existing file or a directory.
+ *
+ * @param filename	name of file to create or special marker for standard output
+ *
+ * @returns file handle or NULL on error
+ */
+
+static FILE *file_create(const char *filename)
+{
+	assert(filename);
+
+	if (!strcmp(filename, STD_OUT_MARK)) {
+		SET_BINARY_MODE(stdout);
+		return stdout;
+	}
+
+	if (strcmp(filename, NULL_MARK)) {
+		struct stat st;
+		FILE *fp;
+
+		/* Check if destination is a directory */
+		if (stat(filename, &st) == 0 && S_ISDIR(st.st_mode)) {
+			LOG_ERROR("'%s' is a directory\n", filename);
+			return NULL;
+		}
+
+		/* Check if destination file already exists */
+		fp = fopen(filename, "rb");
+		if (fp) {
+			fclose(fp);
+			LOG_ERROR("'%s' already exists\n", filename);
+			return NULL;
+		}
+	}
+	return file_open(filename, "wb");
+}
+
+
 /**
  * @brief save memory contents to a file
  *
@@ -377,31 +449,10 @@ static int file_save(const char *filename, const void *buffer, size_t size)
 	assert(filename);
 	assert(buffer);
 
-	if (!strcmp(filename, STD_OUT_MARK)) {
-		fp = stdout;
-		SET_BINARY_MODE(stdout);
-	} else {
-		if (strcmp(filename, NULL_MARK)) {
-			struct stat st;
-
-			/* Check if destination is a directory */
-			if (stat(filename, &st) == 0 && S_ISDIR(st.st_mode)) {
-				LOG_ERROR("'%s' is a directory\n", filename);
-				return -1;
-			}
+	fp = file_create(filename);
+	if (!fp)
+		return -1;
 
-			/* Check if destination file already exists */
-			fp = fopen(filename, "rb");
-			if (fp) {
-				fclose(fp);
-				LOG_ERROR("'%s' already exists\n", filename);
-				return -1;
-			}
-		}
-		fp = file_open(filename, "wb");
-		if (!fp)
-			return -1;
-	}
 	written = fwrite(buffer, 1, size, fp);
 	if (written != size) {
 		LOG_ERROR_WITH_ERRNO("Error writing '%s':", filename);
@@ -415,30 +466,195 @@ static int file_save(const char *filename, const void *buffer, size_t size)
 }
 
 
+/**
+ * @brief read the next chunk of 16-bit big-endian values and convert it to
+ *	host endianness
+ *
+ * @param fp		file to read from; NULL to copy from the source buffer
+ * @param src_buf	buffered file content, used if fp is NULL
+ * @param offset	byte offset of the chunk in the file
+ * @param chunk		buffer of uint16_t to read the chunk into
+ * @param chunk_size	size of the chunk in bytes
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int file_read_chunk_be16(FILE *fp, const uint8_t *src_buf, size_t offset, uint16_t *chunk,
+				size_t chunk_size)
+{
+	size_t i;
+
+	if (fp) {
+		if (fread(chunk, 1, chunk_size, fp) != chunk_size)
+			return -1;
+	} else {
+		memcpy(chunk, src_buf + offset, chunk_size);
+	}
+
+	for (i = 0; i < chunk_size / sizeof(*chunk); i++)
+		be16_to_cpus(&chunk[i]);
+
+	return 0;
+}
+
+
+/**
+ * @brief compresses a source file too large for a single frame into a chunked
+ *	container
+ *
+ * The file is read and compressed FILE_CHUNK_SIZE bytes at a time; every chunk
+ * becomes an independent frame, so only one chunk has to be kept in memory.
+ * Standard input can not be read in a second pass; its chunks are taken from
+ * the buffer holding the whole input.
+ *
+ * @param ctx		pointer to a compression context initialised using `cmp_initialise()`
+ * @param dst_filename	name of the destination file
+ * @param src_filename	name of the source file to be compressed
+ * @param src_size	size of the source file in bytes
+ * @param dst_size	pointer to store the size of the container
+ *
+ * @returns 0 on success or an error code, which can be checked with `cmp_is_error()`
+ */
+
+static uint32_t file_compress_chunked(struct cmp_context *ctx, const char *dst_filename,
+				      const char *src_filename, size_t src_size, size_t *dst_size)
+{
+	uint32_t return_val = CMP_ERROR(GENERIC);
+
+	size_t const n_chunks = (src_size + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+	uint32_t dst_capacity = cmp_compress_bound_params(&ctx->params, FILE_CHUNK_SIZE);
+	uint32_t index_size;
+	size_t i;
+
+	FILE *src_fp = NULL;
+	FILE *dst_fp = NULL;
+	const uint8_t *src_buf = NULL;
+	uint16_t *chunk_buf = NULL;
+	void *dst_buf = NULL;
+	struct cmp_chunk_entry *entries = NULL;
+
+	if (src_size % sizeof(*chunk_buf)) {
+		LOG_ERROR("%s: file size not a multiple of %lu", src_filename,
+			  sizeof(*chunk_buf));
+		return return_val;
+	}
+	if (n_chunks > (UINT32_MAX - CMP_CHUNK_TRAILER_SIZE) / CMP_CHUNK_ENTRY_SIZE) {
+		LOG_ERROR("'%s' is too large", src_filename);
+		return return_val;
+	}
+	index_size = (uint32_t)CMP_CHUNK_INDEX_SIZE(n_chunks);
+	/* the bound of small packets can exceed the largest frame, which is enough then */
+	if (cmp_is_error(dst_capacity))
+		dst_capacity = CMP_HDR_MAX_COMPRESSED_SIZE;
+
+	chunk_buf = malloc(FILE_CHUNK_SIZE);
+	dst_buf = malloc(index_size > dst_capacity ? index_size : dst_capacity);
+	entries = malloc(n_chunks * sizeof(*entries));
+	if (!chunk_buf || !dst_buf || !entries) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for '%s':", src_filename);
+		goto fail;
+	}
+
+	if (!strcmp(src_filename, STD_IN_MARK)) {
+		if (file_buffer_stdin(&src_buf, &src_size))
+			goto fail;
+	} else {
+		src_fp = file_open(src_filename, "rb");
+		if (!src_fp)
+			goto fail;
+	}
+
+	dst_fp = file_create(dst_filename);
+	if (!dst_fp)
+		goto fail;
+
+	*dst_size = 0;
+	for (i = 0; i < n_chunks; i++) {
+		size_t const offset = i * FILE_CHUNK_SIZE;
+		uint32_t const chunk_size = (uint32_t)(src_size - offset < FILE_CHUNK_SIZE ?
+						       src_size - offset : FILE_CHUNK_SIZE);
+		uint32_t cmp_size;
+
+		if (file_read_chunk_be16(src_fp, src_buf, offset, chunk_buf, chunk_size)) {
+			LOG_ERROR_WITH_ERRNO("Can't read '%s'", src_filename);
+			goto fail;
+		}
+
+		/* every chunk starts a new sequence so that it can be decompressed alone */
+		return_val = cmp_reset(ctx);
+		if (!cmp_is_error(return_val))
+			return_val = cmp_compress_u16(ctx, dst_buf, dst_capacity, chunk_buf,
+						      chunk_size);
+		if (cmp_is_error(return_val)) {
+			LOG_ERROR_CMP(return_val, "Compression failed for %s", src_filename);
+			goto fail;
+		}
+		cmp_size = return_val;
+		return_val = CMP_ERROR(GENERIC);
+
+		if (fwrite(dst_buf, 1, cmp_size, dst_fp) != cmp_size) {
+			LOG_ERROR_WITH_ERRNO("Error writing '%s':", dst_filename);
+			goto fail;
+		}
+		entries[i].compressed_size = cmp_size;
+		entries[i].original_size = chunk_size;
+		*dst_size += cmp_size;
+	}
+
+	index_size = cmp_chunk_index_serialize(dst_buf, index_size, entries, (uint32_t)n_chunks);
+	if (cmp_is_error(index_size)) {
+		LOG_ERROR_CMP(index_size, "Can't create the chunk index of %s", dst_filename);
+		return_val = index_size;
+		goto fail;
+	}
+	if (fwrite(dst_buf, 1, index_size, dst_fp) != index_size) {
+		LOG_ERROR_WITH_ERRNO("Error writing '%s':", dst_filename);
+		goto fail;
+	}
+	*dst_size += index_size;
+
+	return_val = CMP_ERROR(NO_ERROR);
+
+fail:
+	if (dst_fp && file_close(dst_fp, dst_filename) && !cmp_is_error(return_val))
+		LOG_WARNING("File '%s' saved successfully but close failed", dst_filename);
+	if (src_fp)
+		(void)file_close(src_fp, src_filename);
+	free(chunk_buf);
+	free(dst_buf);
+	free(entries);
+
+	return return_val;
+}
+
+
 /**
  * @brief compresses a source file and saves the compressed data to a destination file
  *
  * This function reads the contents of a source file, compresses the data,
  * and writes the compressed data to a destination file. It uses a specified
  * compression context for the operation and manages all memory allocation
- * internally.
+ * internally. A file too large for a single frame is compressed into a
+ * chunked container (see CMP_CHUNK_MAGIC).
  *
  * @param ctx		pointer to a compression context initialised using `cmp_initialise()`
  * @param dst_filename	name of the destination file where compressed data will be saved
  * @param src_filename	name of the source file to be compressed
+ * @param dst_size	pointer to store the size of the compressed data written
+ *			to the destination file
  *
- * @returns the size of the compressed data written to the destination file on
- *	success or an error code, which can be checked with `cmp_is_error()`
- *
+ * @returns 0 on success or an error code, which can be checked with `cmp_is_error()`
  */
 
-uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const char *src_filename)
+uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const char *src_filename,
+		       size_t *dst_size)
 {
 	uint32_t return_val = CMP_ERROR(GENERIC);
 
+	size_t file_size;
 	uint32_t src_size;
 	uint32_t dst_capacity;
-	uint32_t dst_size;
+	uint32_t cmp_size;
 
 	void *src_buf = NULL;
 	void *dst_buf = NULL;
@@ -446,9 +662,15 @@ uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const
 	assert(ctx);
 	assert(dst_filename);
 	assert(src_filename);
+	assert(dst_size);
 
-	if (file_get_size_u32(src_filename, &src_size))
+	if (file_get_size(src_filename, &file_size))
 		goto fail;
+	if (file_size > CMP_HDR_MAX_ORIGINAL_SIZE ||
+	    cmp_is_error(cmp_compress_bound_params(&ctx->params, (uint32_t)file_size)))
+		return file_compress_chunked(ctx, dst_filename, src_filename, file_size, dst_size);
+
+	src_size = (uint32_t)file_size;
 	src_buf = malloc(src_size);
 	if (!src_buf) {
 		LOG_ERROR_WITH_ERRNO("Memory allocation failed for '%s':", src_filename);
@@ -457,28 +679,25 @@ uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const
 	if (file_load_be16(src_filename, src_buf, src_size))
 		goto fail;
 
-	dst_capacity = cmp_compress_bound(src_size);
-	if (cmp_is_error(dst_capacity)) {
-		LOG_WARNING("Can't calculating compressed data buffer size, use maximum size");
-		dst_capacity = (1ULL << CMP_HDR_BITS_COMPRESSED_SIZE) - 1;
-	}
+	dst_capacity = cmp_compress_bound_params(&ctx->params, src_size);
 	dst_buf = malloc(dst_capacity);
 	if (!dst_buf) {
 		LOG_ERROR_WITH_ERRNO("Memory allocation failed for compressed data buffer");
 		goto fail;
 	}
 
-	dst_size = cmp_compress_u16(ctx, dst_buf, dst_capacity, src_buf, src_size);
-	if (cmp_is_error(dst_size)) {
-		LOG_ERROR_CMP(dst_size, "Compression failed for %s", src_filename);
-		return_val = dst_size;
+	cmp_size = cmp_compress_u16(ctx, dst_buf, dst_capacity, src_buf, src_size);
+	if (cmp_is_error(cmp_size)) {
+		LOG_ERROR_CMP(cmp_size, "Compression failed for %s", src_filename);
+		return_val = cmp_size;
 		goto fail;
 	}
 
-	if (file_save(dst_filename, dst_buf, dst_size))
+	if (file_save(dst_filename, dst_buf, cmp_size))
 		goto fail; /* printing log message is already done */
 
-	return_val = dst_size;
+	*dst_size = cmp_size;
+	return_val = CMP_ERROR(NO_ERROR);
 
 fail:
 	free(src_buf);
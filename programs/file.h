@@ -10,6 +10,7 @@
 #ifndef FILE_H
 #define FILE_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "../lib/cmp.h"
 
@@ -18,8 +19,17 @@
 #define STD_IN_MARK  "//*-stdin-*//"  /**< Marker for input redirection from standard input */
 #define NULL_MARK    "/dev/null"      /**< Marker for null output (discarding data) */
 
+/**
+ * Bytes of input compressed into one frame of a chunked container; files too
+ * large for a single frame are split into chunks of this size
+ */
+#define FILE_CHUNK_SIZE (4UL << 20)
+
+int file_get_size(const char *filename, size_t *file_size);
+
 int file_get_size_u32(const char *filename, uint32_t *file_size32);
 
-uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const char *src_filename);
+uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const char *src_filename,
+		       size_t *dst_size);
 
 #endif /* FILE_H */
@@ -30,13 +30,17 @@ struct value_map {
 	size_t entry_count;
 	const struct s8 *prefixes;
 	size_t prefix_count;
+	int whole_numbers_allowed; /* non-zero if whole numbers are valid as well */
 };
 
 static const struct map_entry preprocessing_entries[] = {
-	{ S8("NONE"),  CMP_PREPROCESS_NONE  },
-	{ S8("DIFF"),  CMP_PREPROCESS_DIFF  },
-	{ S8("IWT"),   CMP_PREPROCESS_IWT   },
-	{ S8("MODEL"), CMP_PREPROCESS_MODEL }
+	{ S8("NONE"),   CMP_PREPROCESS_NONE   },
+	{ S8("DIFF"),   CMP_PREPROCESS_DIFF   },
+	{ S8("IWT"),    CMP_PREPROCESS_IWT    },
+	{ S8("MODEL"),  CMP_PREPROCESS_MODEL  },
+	{ S8("MED"),    CMP_PREPROCESS_MED    },
+	{ S8("IWT_2D"), CMP_PREPROCESS_IWT_2D },
+	{ S8("FIXED"),  CMP_PREPROCESS_FIXED  }
 };
 static const struct s8 preprocessing_prefixes[] = { S8("CMP_PREPROCESS_"), S8("CMP_"),
 						    S8("PREPROCESS_") };
@@ -45,12 +49,18 @@ static const struct value_map preprocessing_map = {
 	ARRAY_SIZE(preprocessing_entries),
 	preprocessing_prefixes,
 	ARRAY_SIZE(preprocessing_prefixes),
+	0,
 };
 
 static const struct map_entry encoder_type_entries[] = {
-	{ S8("UNCOMPRESSED"), CMP_ENCODER_UNCOMPRESSED },
-	{ S8("GOLOMB_ZERO"),  CMP_ENCODER_GOLOMB_ZERO  },
-	{ S8("GOLOMB_MULTI"), CMP_ENCODER_GOLOMB_MULTI }
+	{ S8("UNCOMPRESSED"),  CMP_ENCODER_UNCOMPRESSED  },
+	{ S8("GOLOMB_ZERO"),   CMP_ENCODER_GOLOMB_ZERO   },
+	{ S8("GOLOMB_MULTI"),  CMP_ENCODER_GOLOMB_MULTI  },
+	{ S8("BLOCK_RICE"),    CMP_ENCODER_BLOCK_RICE    },
+	{ S8("ADAPTIVE_RICE"), CMP_ENCODER_ADAPTIVE_RICE },
+	{ S8("PFOR"),          CMP_ENCODER_PFOR          },
+	{ S8("RANS"),          CMP_ENCODER_RANS          },
+	{ S8("EXP_GOLOMB"),    CMP_ENCODER_EXP_GOLOMB    }
 };
 static const struct s8 encoder_type_prefixes[] = { S8("CMP_ENCODER_"), S8("CMP_"), S8("ENCODER_") };
 static const struct value_map encoder_type_map = {
@@ -58,6 +68,46 @@ static const struct value_map encoder_type_map = {
 	ARRAY_SIZE(encoder_type_entries),
 	encoder_type_prefixes,
 	ARRAY_SIZE(encoder_type_prefixes),
+	0,
+};
+
+static const struct map_entry encoder_param_entries[] = {
+	{ S8("AUTO"), CMP_ENCODER_PARAM_AUTO }
+};
+static const struct s8 encoder_param_prefixes[] = { S8("CMP_ENCODER_PARAM_"), S8("CMP_") };
+static const struct value_map encoder_param_map = {
+	encoder_param_entries,
+	ARRAY_SIZE(encoder_param_entries),
+	encoder_param_prefixes,
+	ARRAY_SIZE(encoder_param_prefixes),
+	1,
+};
+
+static const struct map_entry wavelet_entries[] = {
+	{ S8("5_3"),   CMP_WAVELET_5_3   },
+	{ S8("HAAR"),  CMP_WAVELET_HAAR  },
+	{ S8("2_6"),   CMP_WAVELET_2_6   },
+	{ S8("9_7_M"), CMP_WAVELET_9_7_M }
+};
+static const struct s8 wavelet_prefixes[] = { S8("CMP_WAVELET_"), S8("CMP_"), S8("WAVELET_") };
+static const struct value_map wavelet_map = {
+	wavelet_entries,
+	ARRAY_SIZE(wavelet_entries),
+	wavelet_prefixes,
+	ARRAY_SIZE(wavelet_prefixes),
+	0,
+};
+
+static const struct map_entry fixed_order_entries[] = {
+	{ S8("AUTO"), CMP_FIXED_ORDER_AUTO }
+};
+static const struct s8 fixed_order_prefixes[] = { S8("CMP_FIXED_ORDER_"), S8("CMP_") };
+static const struct value_map fixed_order_map = {
+	fixed_order_entries,
+	ARRAY_SIZE(fixed_order_entries),
+	fixed_order_prefixes,
+	ARRAY_SIZE(fixed_order_prefixes),
+	1,
 };
 
 static const struct map_entry bool_entries[] = {
@@ -72,6 +122,7 @@ static const struct value_map bool_map = {
 	ARRAY_SIZE(bool_entries),
 	bool_prefixes,
 	ARRAY_SIZE(bool_prefixes),
+	0,
 };
 
 /* Helper macro for defining cmp_params struct fields */
@@ -90,20 +141,31 @@ static const struct param_def {
 	/* Primary compression parameters */
 	{ S8("primary_preprocessing"),         PARAM_FIELD(primary_preprocessing),         &preprocessing_map },
 	{ S8("primary_encoder_type"),          PARAM_FIELD(primary_encoder_type),          &encoder_type_map  },
-	{ S8("primary_encoder_param"),         PARAM_FIELD(primary_encoder_param),         NULL               },
+	{ S8("primary_encoder_param"),         PARAM_FIELD(primary_encoder_param),         &encoder_param_map },
 	{ S8("primary_encoder_outlier"),       PARAM_FIELD(primary_encoder_outlier),       NULL               },
 	{ S8("secondary_iterations"),          PARAM_FIELD(secondary_iterations),          NULL               },
 
 	/* Secondary compression parameters */
 	{ S8("secondary_preprocessing"),       PARAM_FIELD(secondary_preprocessing),       &preprocessing_map },
 	{ S8("secondary_encoder_type"),        PARAM_FIELD(secondary_encoder_type),        &encoder_type_map  },
-	{ S8("secondary_encoder_param"),       PARAM_FIELD(secondary_encoder_param),       NULL               },
+	{ S8("secondary_encoder_param"),       PARAM_FIELD(secondary_encoder_param),       &encoder_param_map },
 	{ S8("secondary_encoder_outlier"),     PARAM_FIELD(secondary_encoder_outlier),     NULL               },
 	{ S8("model_rate"),                    PARAM_FIELD(model_rate),                    NULL               },
+	{ S8("wavelet"),                       PARAM_FIELD(wavelet),                       &wavelet_map       },
+	{ S8("fixed_order"),                   PARAM_FIELD(fixed_order),                   &fixed_order_map   },
+	{ S8("near_lossless_delta"),           PARAM_FIELD(near_lossless_delta),           NULL               },
+	{ S8("n_bits"),                        PARAM_FIELD(n_bits),                        NULL               },
+	{ S8("width"),                         PARAM_FIELD(width),                         NULL               },
+	{ S8("temporal_group_size"),           PARAM_FIELD(temporal_group_size),           NULL               },
+	{ S8("temporal_wavelet"),              PARAM_FIELD(temporal_wavelet),              &wavelet_map       },
+	{ S8("packet_size"),                   PARAM_FIELD(packet_size),                   NULL               },
 
 	/* Feature flags */
 	{ S8("checksum_enabled"),              PARAM_FIELD(checksum_enabled),              &bool_map          },
-	{ S8("uncompressed_fallback_enabled"), PARAM_FIELD(uncompressed_fallback_enabled), &bool_map          }
+	{ S8("uncompressed_fallback_enabled"), PARAM_FIELD(uncompressed_fallback_enabled), &bool_map          },
+	{ S8("zero_run_enabled"),              PARAM_FIELD(zero_run_enabled),              &bool_map          },
+	{ S8("four_streams_enabled"),          PARAM_FIELD(four_streams_enabled),          &bool_map          },
+	{ S8("compact_header_enabled"),        PARAM_FIELD(compact_header_enabled),        &bool_map          }
 };
 #undef PARAM_FIELD
 
@@ -204,6 +266,8 @@ static void log_valid_values(const struct param_def *def)
 	LOG_INFO("Hint: Valid options for '" PRIs8 "' are:", S8_PARG(def->name));
 	for (i = 0; i < def->value_map->entry_count; i++)
 		LOG_INFO("  - '" PRIs8 "'", S8_PARG(def->value_map->entries[i].name));
+	if (def->value_map->whole_numbers_allowed)
+		LOG_INFO("  - a whole number");
 }
 
 
@@ -215,14 +279,16 @@ static enum cmp_parse_status parse_value_str(const struct value_map *map, struct
 	*value_num = 0;
 
 	if (map) {
-		value_str = s8_strip_prefixes_ignore_case(value_str, map);
+		struct s8 name = s8_strip_prefixes_ignore_case(value_str, map);
+
 		for (i = 0; i < map->entry_count; i++) {
-			if (s8_equals_ignore_case(value_str, map->entries[i].name)) {
+			if (s8_equals_ignore_case(name, map->entries[i].name)) {
 				*value_num = map->entries[i].value;
 				return CMP_PARSE_OK;
 			}
 		}
-	} else { /* Handle uint32_t parameters */
+	}
+	if (!map || map->whole_numbers_allowed) { /* Handle uint32_t parameters */
 		struct s8_u32_result result = s8_to_u32(value_str);
 
 		if (result.ok) {
@@ -361,6 +427,9 @@ static struct s8 concat_value_as_string(struct arena *a, struct s8 head,
 		if (value_num == map->entries[i].value)
 			return s8_concat(a, head, map->entries[i].name);
 
+	if (map->whole_numbers_allowed)
+		return s8_concat_u32(a, head, value_num);
+
 	return s8_concat(a, head, invalid);
 }
 
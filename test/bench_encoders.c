@@ -0,0 +1,178 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Encoder throughput benchmark
+ *
+ * Compresses a synthetic frame with every encoder and prints the throughput
+ * and the compression ratio. The Golomb encoders use their best parameters for
+ * the frame. Run it with `meson test --benchmark`.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <cmp.h>
+#include <cmp_errors.h>
+
+#define BENCH_N_SAMPLES (1UL << 20)
+#define BENCH_MIN_TIME  0.5 /* seconds measured per encoder */
+#define BENCH_GOLOMB_MAX_PARAM 1024 /* largest Golomb parameter searched */
+
+
+/**
+ * @brief fills the source with a slowly varying signal plus noise
+ */
+
+static void gen_samples(uint16_t *samples, uint32_t n)
+{
+	uint32_t lfsr = 0xACE1;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1U) & 0xB400U);
+		samples[i] = (uint16_t)(20000 + (i / 64) % 512 + (lfsr & 0x3F));
+	}
+}
+
+
+/**
+ * @brief sets the Golomb parameter (and the outlier parameter of
+ *	CMP_ENCODER_GOLOMB_MULTI) giving the smallest frame
+ *
+ * CMP_ENCODER_PARAM_AUTO only estimates the Golomb parameter and leaves the
+ * outlier parameter as it is, so the Golomb encoders are searched to be
+ * compared like for like with the encoders adapting to the data.
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int set_best_golomb_param(struct cmp_params *params, const uint16_t *src,
+				 uint32_t src_size)
+{
+	static uint32_t hist[CMP_HIST_BUF_SIZE / sizeof(uint32_t)];
+	static struct cmp_golomb_cost costs[BENCH_GOLOMB_MAX_PARAM];
+	struct cmp_context ctx;
+	uint32_t best_size = UINT32_MAX;
+	uint32_t ret;
+	size_t i;
+
+	ret = cmp_initialise(&ctx, params, NULL, 0);
+	if (!cmp_is_error(ret))
+		ret = cmp_golomb_costs(&ctx, src, src_size, CMP_U16, hist, sizeof(hist), 1,
+				       BENCH_GOLOMB_MAX_PARAM, costs);
+	if (cmp_is_error(ret))
+		return -1;
+
+	for (i = 0; i < BENCH_GOLOMB_MAX_PARAM; i++) {
+		int const multi = params->primary_encoder_type == CMP_ENCODER_GOLOMB_MULTI;
+		uint32_t const size = multi ? costs[i].multi_size : costs[i].zero_size;
+
+		if (size < best_size) {
+			best_size = size;
+			params->primary_encoder_param = costs[i].encoder_param;
+			if (multi)
+				params->primary_encoder_outlier = costs[i].multi_outlier;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * @brief measures the throughput of one encoder
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int bench_encoder(const char *name, enum cmp_encoder_type encoder_type,
+			 uint32_t encoder_param, const uint16_t *src, void *dst,
+			 uint32_t dst_capacity)
+{
+	uint32_t const src_size = BENCH_N_SAMPLES * sizeof(*src);
+	struct cmp_params params = { 0 };
+	struct cmp_context ctx;
+	uint32_t cmp_size = 0;
+	unsigned long runs = 0;
+	clock_t start;
+	double seconds;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = encoder_param;
+	params.primary_encoder_outlier = 32;
+
+	if ((encoder_type == CMP_ENCODER_GOLOMB_ZERO || encoder_type == CMP_ENCODER_GOLOMB_MULTI) &&
+	    set_best_golomb_param(&params, src, src_size)) {
+		fprintf(stderr, "%s: Golomb parameter search failed\n", name);
+		return -1;
+	}
+
+	cmp_size = cmp_initialise(&ctx, &params, NULL, 0);
+	if (cmp_is_error(cmp_size)) {
+		fprintf(stderr, "%s: %s\n", name, cmp_get_error_message(cmp_size));
+		return -1;
+	}
+
+	start = clock();
+	do {
+		cmp_size = cmp_compress_u16(&ctx, dst, dst_capacity, src, src_size);
+		if (cmp_is_error(cmp_size)) {
+			fprintf(stderr, "%s: %s\n", name, cmp_get_error_message(cmp_size));
+			return -1;
+		}
+		runs++;
+		seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	} while (seconds < BENCH_MIN_TIME);
+
+	printf("%-16s %8.1f MB/s  ratio %5.3f\n", name,
+	       (double)src_size * (double)runs / seconds / 1e6,
+	       (double)src_size / (double)cmp_size);
+	return 0;
+}
+
+
+int main(void)
+{
+	static const struct {
+		const char *name;
+		enum cmp_encoder_type type;
+		uint32_t param;
+	} encoders[] = {
+		{ "UNCOMPRESSED",   CMP_ENCODER_UNCOMPRESSED,   0                      },
+		{ "GOLOMB_ZERO",    CMP_ENCODER_GOLOMB_ZERO,    CMP_ENCODER_PARAM_AUTO },
+		{ "GOLOMB_MULTI",   CMP_ENCODER_GOLOMB_MULTI,   CMP_ENCODER_PARAM_AUTO },
+		{ "BLOCK_RICE",     CMP_ENCODER_BLOCK_RICE,     CMP_ENCODER_PARAM_AUTO },
+		{ "ADAPTIVE_RICE",  CMP_ENCODER_ADAPTIVE_RICE,  CMP_ENCODER_PARAM_AUTO },
+		{ "PFOR",           CMP_ENCODER_PFOR,           CMP_ENCODER_PARAM_AUTO },
+		{ "RANS",           CMP_ENCODER_RANS,           CMP_ENCODER_PARAM_AUTO },
+		{ "EXP_GOLOMB",     CMP_ENCODER_EXP_GOLOMB,     CMP_ENCODER_PARAM_AUTO }
+	};
+	uint32_t const dst_capacity = cmp_compress_bound(BENCH_N_SAMPLES * sizeof(uint16_t));
+	uint16_t *src = malloc(BENCH_N_SAMPLES * sizeof(*src));
+	uint64_t *dst = malloc(dst_capacity);
+	int result = EXIT_SUCCESS;
+	size_t i;
+
+	if (!src || !dst || cmp_is_error(dst_capacity)) {
+		fprintf(stderr, "Memory allocation failed\n");
+		free(src);
+		free(dst);
+		return EXIT_FAILURE;
+	}
+
+	gen_samples(src, BENCH_N_SAMPLES);
+	for (i = 0; i < sizeof(encoders) / sizeof(encoders[0]); i++) {
+		if (bench_encoder(encoders[i].name, encoders[i].type, encoders[i].param, src, dst,
+				  dst_capacity))
+			result = EXIT_FAILURE;
+	}
+
+	free(src);
+	free(dst);
+	return result;
+}
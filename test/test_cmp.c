@@ -444,7 +444,9 @@ void test_bound_size_is_enough_for_uncompressed_mode_with_checksum(void)
 void test_compress_bound_provides_sufficient_buffer_size(void)
 {
 	const uint16_t worst_case_src[2] = { 0xAAAA, 0xBBBB };
-	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * (4 + 2)];
+	/* the bound also holds the channel table and padding of dual-channel data */
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * (4 + 2) + CMP_CHANNEL_TABLE_SIZE + CMP_NUM_CHANNELS];
+	uint32_t const worst_case_size = CMP_HDR_SIZE + 2 * (4 + 2);
 	struct cmp_context ctx;
 	struct cmp_params worst_case_params = { 0 };
 	uint32_t bound;
@@ -457,12 +459,15 @@ void test_compress_bound_provides_sufficient_buffer_size(void)
 	bound = cmp_compress_bound(sizeof(worst_case_src));
 
 	TEST_ASSERT_CMP_SUCCESS(bound);
-	TEST_ASSERT_LESS_OR_EQUAL(sizeof(dst), bound);
+	TEST_ASSERT_EQUAL(sizeof(dst), bound);
 	TEST_ASSERT_CMP_SUCCESS(
 		cmp_compress_u16(&ctx, dst, bound, worst_case_src, sizeof(worst_case_src)));
+	TEST_ASSERT_EQUAL(worst_case_size, cmp_compress_u16(&ctx, dst, worst_case_size,
+							    worst_case_src,
+							    sizeof(worst_case_src)));
 
 	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
-				    cmp_compress_u16(&ctx, dst, bound - 1, worst_case_src,
+				    cmp_compress_u16(&ctx, dst, worst_case_size - 1, worst_case_src,
 						     sizeof(worst_case_src)));
 }
 
@@ -976,3 +981,1679 @@ void test_detect_uninitialise_context_in_reset(void)
 
 	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_CONTEXT_INVALID, return_val);
 }
+
+
+static void fill_test_data(void *src, uint32_t num_samples, enum cmp_type dtype)
+{
+	uint32_t i;
+	uint32_t state = 12345;
+
+	for (i = 0; i < num_samples; i++) {
+		int16_t value;
+
+		state = state * 1103515245 + 12345; /* simple LCG */
+		/* a slow ramp with some noise and a few outliers */
+		value = (int16_t)(i * 3 + ((state >> 16) & 0x1F));
+		if (i % 17 == 0)
+			value = (int16_t)(state >> 8);
+
+		if (dtype == CMP_I16_IN_I32)
+			((int32_t *)src)[i] = value;
+		else
+			((int16_t *)src)[i] = value;
+	}
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16, &cmp_fixture_i16_in_i32],
+	    [CMP_PREPROCESS_NONE, CMP_PREPROCESS_DIFF, CMP_PREPROCESS_IWT,
+	     CMP_PREPROCESS_FIXED],
+	    [CMP_ENCODER_UNCOMPRESSED, CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_GOLOMB_MULTI,
+	     CMP_ENCODER_BLOCK_RICE, CMP_ENCODER_ADAPTIVE_RICE, CMP_ENCODER_PFOR,
+	     CMP_ENCODER_RANS, CMP_ENCODER_EXP_GOLOMB])
+void test_estimated_size_matches_compressed_size(const struct cmp_test_fixture *fix,
+						 enum cmp_preprocessing preprocessing,
+						 enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 100 };
+	int32_t src[NUM_SAMPLES];
+	uint32_t const src_size = NUM_SAMPLES * (fix->dtype == CMP_I16_IN_I32 ? 4 : 2);
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	uint32_t i;
+
+	fill_test_data(src, NUM_SAMPLES, fix->dtype);
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = 5;
+	params.primary_encoder_outlier = 60;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = encoder_type;
+	params.secondary_encoder_param = 3;
+	params.secondary_encoder_outlier = 10;
+	params.model_rate = 8;
+	params.checksum_enabled = 1;
+	e = make_env(&params, src_size);
+
+	for (i = 0; i < 4; i++) {
+		uint32_t estimate, cmp_size;
+
+		src[i] += 7;
+		estimate = cmp_estimate_size(&e->ctx, src, src_size, fix->dtype);
+		cmp_size = fix->compress(&e->ctx, e->dst, e->dst_cap, src, src_size);
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(cmp_size, estimate);
+	}
+	free_env(e);
+}
+
+
+TEST_MATRIX([CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_GOLOMB_MULTI, CMP_ENCODER_EXP_GOLOMB])
+void test_zero_run_coding_shrinks_sparse_frames(enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 200 };
+	int16_t src[NUM_SAMPLES] = { 0 };
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	uint32_t size_plain, size_zero_run, estimate;
+
+	src[17] = 3;
+	src[120] = -40;
+	src[121] = 1;
+	params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = 1;
+	params.primary_encoder_outlier = 8;
+	e = make_env(&params, sizeof(src));
+	size_plain = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+	free_env(e);
+
+	params.zero_run_enabled = 1;
+	e = make_env(&params, sizeof(src));
+	estimate = cmp_estimate_size(&e->ctx, src, sizeof(src), CMP_I16);
+	size_zero_run = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(size_plain);
+	TEST_ASSERT_CMP_SUCCESS(size_zero_run);
+	TEST_ASSERT_LESS_THAN(size_plain, size_zero_run);
+	TEST_ASSERT_EQUAL(size_zero_run, estimate);
+	free_env(e);
+}
+
+
+TEST_MATRIX([CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_BLOCK_RICE, CMP_ENCODER_RANS,
+	     CMP_ENCODER_EXP_GOLOMB])
+void test_four_stream_layout_lists_stream_sizes(enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 301 };
+	int16_t src[NUM_SAMPLES];
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, estimate, streams_size = 0;
+	const uint8_t *table;
+	int j;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = 5;
+	params.primary_encoder_outlier = 60;
+	params.four_streams_enabled = 1;
+	e = make_env(&params, sizeof(src));
+
+	estimate = cmp_estimate_size(&e->ctx, src, sizeof(src), CMP_I16);
+	cmp_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL_HEX(CMP_HDR_FLAG_FOUR_STREAMS, hdr.encoder_flags);
+	table = (const uint8_t *)e->dst + CMP_HDR_SIZE;
+	for (j = 0; j < CMP_NUM_STREAMS - 1; j++) {
+		uint32_t stream_size = (uint32_t)table[3 * j] << 16 |
+				       (uint32_t)table[3 * j + 1] << 8 | table[3 * j + 2];
+
+		TEST_ASSERT_NOT_EQUAL(0, stream_size);
+		streams_size += stream_size;
+	}
+	TEST_ASSERT_LESS_THAN(cmp_size, CMP_HDR_SIZE + CMP_STREAM_TABLE_SIZE + streams_size);
+	free_env(e);
+}
+
+
+void test_four_stream_layout_falls_back_to_single_stream_at_compress_bound(void)
+{
+	const uint16_t worst_case_src[2] = { 0xAAAA, 0xBBBB };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * (4 + 2) + CMP_CHANNEL_TABLE_SIZE + CMP_NUM_CHANNELS];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, estimate;
+
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 1;
+	params.primary_encoder_outlier = 32;
+	params.four_streams_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	estimate = cmp_estimate_size(&ctx, worst_case_src, sizeof(worst_case_src), CMP_U16);
+	cmp_size = cmp_compress_u16(&ctx, dst, cmp_compress_bound(sizeof(worst_case_src)),
+				    worst_case_src, sizeof(worst_case_src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL_HEX(0, hdr.encoder_flags);
+}
+
+
+void test_four_stream_layout_falls_back_to_single_stream_before_uncompressed_fallback(void)
+{
+	/* 12-bit samples: one PFor block fits, four blocks with the stream table do not */
+	const uint16_t src[8] = { 0x0123, 0x0456, 0x0789, 0x0ABC, 0x0DEF, 0x0FED, 0x0CBA, 0x0987 };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + sizeof(src)];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, estimate;
+
+	params.primary_encoder_type = CMP_ENCODER_PFOR;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	params.four_streams_enabled = 1;
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	estimate = cmp_estimate_size(&ctx, src, sizeof(src), CMP_U16);
+	cmp_size = cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_LESS_THAN(sizeof(dst), cmp_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(CMP_ENCODER_PFOR, hdr.encoder_type);
+	TEST_ASSERT_EQUAL_HEX(0, hdr.encoder_flags);
+}
+
+
+void test_temporal_group_is_written_as_aligned_subband_frames(void)
+{
+	/* four frames of two pixels; the first pixel rises, the second is static */
+	const int16_t src[] = { 1, 10, 3, 10, 5, 10, 7, 10 };
+	/*
+	 * Haar along time: 1 3 5 7 -> 4 2 4 2 and 10 10 10 10 -> 10 0 0 0,
+	 * subband t holds the coefficients with index t of both pixels
+	 */
+	const uint8_t expected_subbands[4][4] = {
+		{ 0x00, 0x04, 0x00, 0x0A },
+		{ 0x00, 0x02, 0x00, 0x00 },
+		{ 0x00, 0x04, 0x00, 0x00 },
+		{ 0x00, 0x02, 0x00, 0x00 },
+	};
+	uint32_t const frame_size = CMP_HDR_SIZE + 4;
+	uint32_t const aligned_frame_size = (frame_size + 7) & ~7U;
+	DST_ALIGNED_U8 dst[4 * ((CMP_HDR_SIZE + 4 + 7) & ~7U)];
+	uint16_t work_buf[8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t dst_size, t;
+
+	params.temporal_group_size = 4;
+	params.temporal_wavelet = CMP_WAVELET_HAAR;
+	TEST_ASSERT_EQUAL(sizeof(work_buf), cmp_cal_work_buf_size(&params, 2 * sizeof(int16_t)));
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+
+	dst_size = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+
+	TEST_ASSERT_CMP_SUCCESS(dst_size);
+	TEST_ASSERT_EQUAL(3 * aligned_frame_size + frame_size, dst_size);
+	for (t = 0; t < 4; t++) {
+		const uint8_t *frame = dst + t * aligned_frame_size;
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(frame, frame_size, &hdr));
+		TEST_ASSERT_EQUAL(frame_size, hdr.compressed_size);
+		TEST_ASSERT_EQUAL(4, hdr.original_size);
+		TEST_ASSERT_EQUAL(CMP_I16, hdr.original_dtype);
+		TEST_ASSERT_EQUAL(2, hdr.temporal_levels);
+		TEST_ASSERT_EQUAL(CMP_WAVELET_HAAR, hdr.temporal_wavelet);
+		TEST_ASSERT_EQUAL(t, hdr.temporal_index);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_subbands[t], cmp_hdr_get_cmp_data(frame), 4);
+		if (t < 3)
+			TEST_ASSERT_EACH_EQUAL_HEX8(0, frame + frame_size,
+						    aligned_frame_size - frame_size);
+	}
+}
+
+
+void test_temporal_group_compresses_all_subbands_in_one_pass(void)
+{
+	const int16_t src[] = { 1, 10, 3, 10, 5, 10, 7, 10 };
+	/* group 3 starts a new sequence after the two secondary passes */
+	const uint8_t expected_sequence_number[4] = { 0, 1, 2, 0 };
+	const enum cmp_preprocessing expected_preprocessing[4] = {
+		CMP_PREPROCESS_NONE, CMP_PREPROCESS_DIFF, CMP_PREPROCESS_DIFF, CMP_PREPROCESS_NONE
+	};
+	uint32_t const frame_size = CMP_HDR_SIZE + 4;
+	uint32_t const aligned_frame_size = (frame_size + 7) & ~7U;
+	DST_ALIGNED_U8 dst[4 * ((CMP_HDR_SIZE + 4 + 7) & ~7U)];
+	uint16_t work_buf[8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t dst_size, first_identifier = 0, g, t;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	params.secondary_iterations = 2;
+	params.secondary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.secondary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.temporal_group_size = 4;
+	params.temporal_wavelet = CMP_WAVELET_HAAR;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+
+	for (g = 0; g < 4; g++) {
+		dst_size = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+
+		TEST_ASSERT_CMP_SUCCESS(dst_size);
+		TEST_ASSERT_EQUAL(3 * aligned_frame_size + frame_size, dst_size);
+		for (t = 0; t < 4; t++) {
+			const uint8_t *frame = dst + t * aligned_frame_size;
+
+			TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(frame, frame_size, &hdr));
+			TEST_ASSERT_EQUAL(t, hdr.temporal_index);
+			TEST_ASSERT_EQUAL(expected_sequence_number[g], hdr.sequence_number);
+			TEST_ASSERT_EQUAL(expected_preprocessing[g], hdr.preprocessing);
+			if (g == 0 && t == 0)
+				first_identifier = hdr.identifier;
+			if (g < 3)
+				TEST_ASSERT_EQUAL_HEX(first_identifier, hdr.identifier);
+			else
+				TEST_ASSERT_NOT_EQUAL(first_identifier, hdr.identifier);
+		}
+	}
+}
+
+
+void test_temporal_group_failing_partway_does_not_advance_the_sequence(void)
+{
+	const int16_t src[] = { 1, 10, 3, 10, 5, 10, 7, 10 };
+	uint32_t const frame_size = CMP_HDR_SIZE + 4;
+	uint32_t const aligned_frame_size = (frame_size + 7) & ~7U;
+	DST_ALIGNED_U8 dst[4 * ((CMP_HDR_SIZE + 4 + 7) & ~7U)];
+	uint16_t work_buf[8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t dst_size, identifier, capacity;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	params.secondary_iterations = 2;
+	params.secondary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.secondary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.temporal_group_size = 4;
+	params.temporal_wavelet = CMP_WAVELET_HAAR;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src),
+						   CMP_I16));
+	identifier = ctx.identifier;
+
+	/* fails in every subband and in every padding */
+	for (capacity = frame_size; capacity < 3 * aligned_frame_size + frame_size; capacity++) {
+		dst_size = cmp_compress_group(&ctx, dst, capacity, src, sizeof(src), CMP_I16);
+
+		TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, dst_size);
+		TEST_ASSERT_EQUAL(1, ctx.sequence_number);
+		TEST_ASSERT_EQUAL_HEX(identifier, ctx.identifier);
+	}
+
+	dst_size = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL(3 * aligned_frame_size + frame_size, dst_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst + 3 * aligned_frame_size, frame_size,
+						    &hdr));
+	TEST_ASSERT_EQUAL(1, hdr.sequence_number);
+	TEST_ASSERT_EQUAL(CMP_PREPROCESS_DIFF, hdr.preprocessing);
+	TEST_ASSERT_EQUAL(2, ctx.sequence_number);
+}
+
+
+void test_temporal_group_detects_invalid_arguments(void)
+{
+	const int16_t src[6] = { 0 };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 8];
+	uint16_t work_buf[8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t return_value;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	return_value = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+
+	params.temporal_group_size = 4;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+	return_value = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, return_value);
+
+	params.temporal_group_size = 2;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, 4));
+	return_value = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_WORK_BUF_TOO_SMALL, return_value);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+	return_value = cmp_compress_group(&ctx, dst, sizeof(dst), src, sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, return_value);
+}
+
+
+void test_near_lossless_diff_predicts_from_reconstructed_samples(void)
+{
+	const int16_t src[] = { 10, 12, 20, 19 };
+	/*
+	 * step 3: 10 - 0 -> 3 (9), 12 - 9 -> 1 (12), 20 - 12 -> 3 (21),
+	 * 19 - 21 -> -1 (18); reconstructed values in brackets
+	 */
+	const uint8_t expected_residuals[] = { 0x00, 0x03, 0x00, 0x01, 0x00, 0x03, 0xFF, 0xFF };
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	struct cmp_hdr hdr;
+	uint32_t cmp_size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.near_lossless_delta = 1;
+	e = make_env(&params, sizeof(src));
+
+	cmp_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(expected_residuals), cmp_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_residuals, cmp_hdr_get_cmp_data(e->dst),
+				     sizeof(expected_residuals));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(1, hdr.near_lossless_delta);
+	free_env(e);
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16], [1, 2, 7])
+void test_near_lossless_reconstruction_error_is_bounded(const struct cmp_test_fixture *fix,
+							uint32_t delta)
+{
+	enum { NUM_SAMPLES = 200, MODEL_RATE = 5 };
+	int16_t src[NUM_SAMPLES];
+	int32_t model[NUM_SAMPLES];
+	int32_t const max = fix->dtype == CMP_U16 ? UINT16_MAX : INT16_MAX;
+	int32_t const min = fix->dtype == CMP_U16 ? 0 : INT16_MIN;
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	uint32_t frame, i;
+
+	fill_test_data(src, NUM_SAMPLES, fix->dtype);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.secondary_iterations = 3;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.model_rate = MODEL_RATE;
+	params.near_lossless_delta = delta;
+	e = make_env(&params, sizeof(src));
+
+	for (frame = 0; frame < 4; frame++) {
+		const uint8_t *residuals;
+		uint32_t estimate, cmp_size;
+		int32_t reconstructed = 0;
+
+		for (i = 0; i < NUM_SAMPLES; i += 3)
+			src[i] = (int16_t)(src[i] + 7 * frame);
+		estimate = cmp_estimate_size(&e->ctx, src, sizeof(src), fix->dtype);
+		cmp_size = fix->compress(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(estimate, cmp_size);
+
+		/* decompress like the ground segment does */
+		residuals = cmp_hdr_get_cmp_data(e->dst);
+		for (i = 0; i < NUM_SAMPLES; i++) {
+			int16_t const residual = (int16_t)(residuals[2 * i] << 8 | residuals[2 * i + 1]);
+			int32_t const prediction = frame == 0 ? reconstructed : model[i];
+			int32_t const value = fix->dtype == CMP_U16 ? (uint16_t)src[i] : src[i];
+
+			reconstructed = prediction + residual * (int32_t)(2 * delta + 1);
+			if (reconstructed < min)
+				reconstructed = min;
+			if (reconstructed > max)
+				reconstructed = max;
+			TEST_ASSERT_LESS_OR_EQUAL(delta, (uint32_t)abs(value - reconstructed));
+
+			if (frame == 0)
+				model[i] = reconstructed;
+			else
+				model[i] = (model[i] * MODEL_RATE + reconstructed * (16 - MODEL_RATE)) >> 4;
+		}
+	}
+	free_env(e);
+}
+
+
+/* estimated size of a primary pass with the given parameters in a fresh context */
+static uint32_t estimate_primary_pass(const struct cmp_params *params, const int16_t *src,
+				      uint32_t src_size, void *work_buf, uint32_t work_buf_size)
+{
+	struct cmp_context ctx;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, params, work_buf, work_buf_size));
+	return cmp_estimate_size(&ctx, src, src_size, CMP_I16);
+}
+
+
+void test_budget_compression_selects_a_better_encoder_param(void)
+{
+	enum { NUM_SAMPLES = 200 };
+	int16_t src[NUM_SAMPLES];
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * sizeof(src)];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_params auto_params;
+	struct cmp_hdr hdr;
+	uint32_t budget, cmp_size;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 1;
+	params.primary_encoder_outlier = 60;
+	auto_params = params;
+	auto_params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	budget = estimate_primary_pass(&auto_params, src, sizeof(src), NULL, 0);
+	TEST_ASSERT_LESS_THAN(estimate_primary_pass(&params, src, sizeof(src), NULL, 0), budget);
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	cmp_size = cmp_compress_i16_budget(&ctx, dst, budget, src, sizeof(src), 0, NULL, 0);
+
+	TEST_ASSERT_EQUAL(budget, cmp_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_NOT_EQUAL(1, hdr.encoder_param);
+	TEST_ASSERT_EQUAL(0, hdr.near_lossless_delta);
+	TEST_ASSERT_EQUAL(1, ctx.params.primary_encoder_param);
+}
+
+
+void test_budget_compression_searches_the_golomb_params(void)
+{
+	enum { NUM_SAMPLES = 200, NUM_PARAMS = 64 };
+	int16_t src[NUM_SAMPLES];
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * sizeof(src)];
+	struct cmp_golomb_cost costs[NUM_PARAMS];
+	uint32_t *hist_buf = t_malloc(CMP_HIST_BUF_SIZE);
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t i, best = 0, auto_size, cmp_size;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	params.primary_encoder_outlier = 60;
+	auto_size = estimate_primary_pass(&params, src, sizeof(src), NULL, 0);
+	params.primary_encoder_param = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	TEST_ASSERT_CMP_SUCCESS(cmp_golomb_costs(&ctx, src, sizeof(src), CMP_I16, hist_buf,
+						 CMP_HIST_BUF_SIZE, 1, NUM_PARAMS, costs));
+	for (i = 1; i < NUM_PARAMS; i++)
+		if (costs[i].multi_size < costs[best].multi_size)
+			best = i;
+	TEST_ASSERT_LESS_THAN(auto_size, costs[best].multi_size);
+
+	cmp_size = cmp_compress_i16_budget(&ctx, dst, costs[best].multi_size, src, sizeof(src),
+					   0, hist_buf, CMP_HIST_BUF_SIZE);
+
+	TEST_ASSERT_EQUAL(costs[best].multi_size, cmp_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(costs[best].encoder_param, hdr.encoder_param);
+	TEST_ASSERT_EQUAL(costs[best].multi_outlier, hdr.encoder_outlier);
+	TEST_ASSERT_EQUAL(0, hdr.near_lossless_delta);
+	TEST_ASSERT_EQUAL(1, ctx.params.primary_encoder_param);
+	TEST_ASSERT_EQUAL(60, ctx.params.primary_encoder_outlier);
+	free(hist_buf);
+}
+
+
+void test_budget_compression_selects_the_smallest_fitting_near_lossless_delta(void)
+{
+	enum { NUM_SAMPLES = 200 };
+	int16_t src[NUM_SAMPLES];
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * sizeof(src)];
+	uint16_t work_buf[2 * NUM_SAMPLES];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_params nl_params;
+	struct cmp_hdr hdr;
+	uint32_t budget, cmp_size;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	budget = estimate_primary_pass(&params, src, sizeof(src), NULL, 0) * 3 / 4;
+	nl_params = params;
+	nl_params.near_lossless_delta = 1;
+	TEST_ASSERT_EQUAL(sizeof(work_buf), cmp_cal_work_buf_size(&nl_params, sizeof(src)));
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+
+	cmp_size = cmp_compress_i16_budget(&ctx, dst, budget, src, sizeof(src), 16, NULL,
+					   0);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_LESS_OR_EQUAL(budget, cmp_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_GREATER_THAN(0, hdr.near_lossless_delta);
+	TEST_ASSERT_LESS_OR_EQUAL(16, hdr.near_lossless_delta);
+	nl_params.near_lossless_delta = hdr.near_lossless_delta - 1;
+	TEST_ASSERT_GREATER_THAN(budget, estimate_primary_pass(&nl_params, src, sizeof(src),
+							       work_buf, sizeof(work_buf)));
+	TEST_ASSERT_EQUAL(0, ctx.params.near_lossless_delta);
+}
+
+
+void test_budget_compression_detects_a_too_small_budget(void)
+{
+	const int16_t src[] = { 1, -300, 2000, -7 };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 2 * sizeof(src)];
+	uint16_t work_buf[2 * ARRAY_SIZE(src)];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+
+	cmp_size = cmp_compress_i16_budget(&ctx, dst, CMP_HDR_SIZE, src, sizeof(src),
+					   CMP_HDR_MAX_NL_DELTA, NULL, 0);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, cmp_size);
+	TEST_ASSERT_EQUAL(4, ctx.params.primary_encoder_param);
+}
+
+
+void test_residuals_wrap_around_at_the_sample_bit_depth(void)
+{
+	/* 16383 - 0 wraps around to -1 with 14 bits; order-0 Exp-Golomb codes 0 and 1 */
+	const uint16_t src[] = { 0, 16383 };
+	const uint8_t expected[] = { 0xA0 };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + sizeof(expected)];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_EXP_GOLOMB;
+	params.primary_encoder_param = 0;
+	params.n_bits = 14;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	cmp_size = cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(expected), cmp_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, cmp_hdr_get_cmp_data(dst), sizeof(expected));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(14, hdr.n_bits);
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16])
+void test_uncompressed_fallback_packs_samples_with_sample_bit_depth(
+	const struct cmp_test_fixture *fix)
+{
+	const uint16_t src[] = { 0x7FF, 0x000, 0x5A5, 0x0F0 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t estimate, cmp_size;
+
+	params.uncompressed_fallback_enabled = 1;
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	params.n_bits = 12;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	estimate = cmp_estimate_size(&ctx, src, sizeof(src), fix->dtype);
+	cmp_size = fix->compress(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + ARRAY_SIZE(src) * 12 / 8, cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(CMP_ENCODER_UNCOMPRESSED, hdr.encoder_type);
+	TEST_ASSERT_EQUAL(12, hdr.n_bits);
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16])
+void test_detects_samples_exceeding_the_sample_bit_depth(const struct cmp_test_fixture *fix)
+{
+	/* 2048 fits into 12 unsigned but not into 12 signed bits */
+	const uint16_t src[] = { 1, 2048, 4096 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.n_bits = 12;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	cmp_size = fix->compress(&ctx, dst, sizeof(dst), src, 2 * sizeof(src[0]));
+	if (fix->dtype == CMP_U16)
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	else
+		TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_VALUE_TOO_LARGE, cmp_size);
+
+	cmp_size = fix->compress(&ctx, dst, sizeof(dst), src, sizeof(src));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_VALUE_TOO_LARGE, cmp_size);
+}
+
+
+TEST_MATRIX([CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_EXP_GOLOMB, CMP_ENCODER_RANS])
+void test_dual_channel_data_are_compressed_as_two_independent_channels(
+	enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 101 };
+	int32_t src[NUM_SAMPLES];
+	int16_t lower[NUM_SAMPLES], upper[NUM_SAMPLES];
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_lower, *e_upper;
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, lower_size, upper_size, estimate, i;
+	const uint8_t *table;
+	int pass;
+
+	fill_test_data(lower, NUM_SAMPLES, CMP_I16);
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		upper[i] = (int16_t)(1000 - 3 * (int)i);
+		src[i] = (int32_t)((uint32_t)(uint16_t)upper[i] << 16 | (uint16_t)lower[i]);
+	}
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = encoder_type == CMP_ENCODER_RANS ? CMP_ENCODER_PARAM_AUTO
+									 : 3;
+	params.primary_encoder_outlier = 60;
+	params.secondary_iterations = 1;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = params.primary_encoder_type;
+	params.secondary_encoder_param = params.primary_encoder_param;
+	params.secondary_encoder_outlier = params.primary_encoder_outlier;
+	params.model_rate = 8;
+	e = make_env(&params, sizeof(src));
+	e_lower = make_env(&params, sizeof(lower));
+	e_upper = make_env(&params, sizeof(upper));
+
+	/* the second pass checks that every channel keeps its own model */
+	for (pass = 0; pass < 2; pass++) {
+		estimate = cmp_estimate_size(&e->ctx, src, sizeof(src), CMP_2xI16_IN_I32);
+		cmp_size = cmp_compress_2xi16_in_i32(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+		lower_size = cmp_compress_i16(&e_lower->ctx, e_lower->dst, e_lower->dst_cap, lower,
+					      sizeof(lower)) - CMP_HDR_SIZE;
+		upper_size = cmp_compress_i16(&e_upper->ctx, e_upper->dst, e_upper->dst_cap, upper,
+					      sizeof(upper)) - CMP_HDR_SIZE;
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(cmp_size, estimate);
+		TEST_ASSERT_EQUAL(CMP_HDR_SIZE + CMP_CHANNEL_TABLE_SIZE + lower_size + upper_size,
+				  cmp_size);
+		TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+		TEST_ASSERT_EQUAL(CMP_2xI16_IN_I32, hdr.original_dtype);
+		TEST_ASSERT_EQUAL(sizeof(src), hdr.original_size);
+		table = (const uint8_t *)e->dst + CMP_HDR_SIZE;
+		TEST_ASSERT_EQUAL(lower_size, (uint32_t)table[0] << 16 | (uint32_t)table[1] << 8 |
+						      table[2]);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(cmp_hdr_get_cmp_data(e_lower->dst),
+					     table + CMP_CHANNEL_TABLE_SIZE, lower_size);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(cmp_hdr_get_cmp_data(e_upper->dst),
+					     table + CMP_CHANNEL_TABLE_SIZE + lower_size, upper_size);
+	}
+	free_env(e);
+	free_env(e_lower);
+	free_env(e_upper);
+}
+
+
+void test_dual_channel_uncompressed_data_have_no_channel_table(void)
+{
+	const int32_t src[] = { 0x00020001, (int32_t)0xFFFF8000 };
+	const uint8_t expected[] = { 0x00, 0x01, 0x80, 0x00, 0x00, 0x02, 0xFF, 0xFF };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	cmp_size = cmp_compress_2xi16_in_i32(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(expected), cmp_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, cmp_hdr_get_cmp_data(dst), sizeof(expected));
+}
+
+
+void test_dual_channel_layout_fits_compress_bound(void)
+{
+	const int32_t worst_case_src[2] = { (int32_t)0xAAAAAAAA, (int32_t)0xBBBBBBBB };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 4 * (4 + 2) + CMP_CHANNEL_TABLE_SIZE + CMP_NUM_CHANNELS];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, estimate;
+
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 1;
+	params.primary_encoder_outlier = 32;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	TEST_ASSERT_EQUAL(sizeof(dst), cmp_compress_bound(sizeof(worst_case_src)));
+
+	estimate = cmp_estimate_size(&ctx, worst_case_src, sizeof(worst_case_src),
+				     CMP_2xI16_IN_I32);
+	cmp_size = cmp_compress_2xi16_in_i32(&ctx, dst, sizeof(dst), worst_case_src,
+					     sizeof(worst_case_src));
+
+	/* the uncompressed fallback is disabled, so the data stay compressed */
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(estimate, cmp_size);
+	TEST_ASSERT_GREATER_THAN(CMP_HDR_SIZE + sizeof(worst_case_src), cmp_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(CMP_ENCODER_GOLOMB_MULTI, hdr.encoder_type);
+}
+
+
+void test_dual_channel_checksum_hashes_the_lower_half_first(void)
+{
+	const int32_t src[] = { 0x00020001, 0x00040003 };
+	const int16_t interleaved[] = { 1, 2, 3, 4 };
+	uint32_t checksum, expected_checksum;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_checksum(&checksum, src, sizeof(src), CMP_2xI16_IN_I32));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_checksum(&expected_checksum, interleaved,
+						 sizeof(interleaved), CMP_I16));
+	TEST_ASSERT_EQUAL_HEX32(expected_checksum, checksum);
+}
+
+
+TEST_MATRIX([CMP_PREPROCESS_NONE, CMP_PREPROCESS_DIFF, CMP_PREPROCESS_IWT, CMP_PREPROCESS_MODEL],
+	    [CMP_ENCODER_UNCOMPRESSED, CMP_ENCODER_GOLOMB_ZERO])
+void test_strided_channel_is_compressed_like_a_contiguous_copy(
+	enum cmp_preprocessing preprocessing, enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 37, NUM_CHANNELS = 3 };
+	uint16_t interleaved[NUM_SAMPLES * NUM_CHANNELS];
+	uint16_t channel[NUM_SAMPLES];
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_copy;
+	struct cmp_hdr hdr, hdr_copy;
+	uint32_t cmp_size, copy_size, i;
+	int pass;
+
+	fill_test_data(interleaved, ARRAY_SIZE(interleaved), CMP_U16);
+	for (i = 0; i < NUM_SAMPLES; i++)
+		channel[i] = interleaved[i * NUM_CHANNELS + 1];
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = 3;
+	params.checksum_enabled = 1;
+	if (preprocessing == CMP_PREPROCESS_MODEL) {
+		params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+		params.secondary_iterations = 1;
+		params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+		params.secondary_encoder_type = encoder_type;
+		params.secondary_encoder_param = 3;
+		params.model_rate = 4;
+	}
+	e = make_env(&params, sizeof(channel));
+	e_copy = make_env(&params, sizeof(channel));
+
+	for (pass = 0; pass < 2; pass++) {
+		cmp_size = cmp_compress_strided(&e->ctx, e->dst, e->dst_cap, interleaved,
+						NUM_SAMPLES, NUM_CHANNELS * sizeof(uint16_t),
+						sizeof(uint16_t), CMP_U16);
+		copy_size = cmp_compress_u16(&e_copy->ctx, e_copy->dst, e_copy->dst_cap, channel,
+					     sizeof(channel));
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(copy_size, cmp_size);
+		TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+		TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e_copy->dst, copy_size, &hdr_copy));
+		TEST_ASSERT_EQUAL_HEX32(hdr_copy.checksum, hdr.checksum);
+		TEST_ASSERT_EQUAL(sizeof(channel), hdr.original_size);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(cmp_hdr_get_cmp_data(e_copy->dst),
+					     cmp_hdr_get_cmp_data(e->dst), copy_size - CMP_HDR_SIZE);
+	}
+	free_env(e);
+	free_env(e_copy);
+}
+
+
+void test_strided_dual_channel_words_are_compressed_like_a_contiguous_copy(void)
+{
+	const int32_t interleaved[] = { 0x00020001, 0x7F7F7F7F, 0x00040003, 0x7F7F7F7F,
+					0x00080005, 0x7F7F7F7F };
+	const int32_t words[] = { 0x00020001, 0x00040003, 0x00080005 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(words))];
+	DST_ALIGNED_U8 dst_copy[CMP_UNCOMPRESSED_BOUND(sizeof(words))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size, copy_size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), interleaved, ARRAY_SIZE(words),
+					2 * sizeof(int32_t), 0, CMP_2xI16_IN_I32);
+	copy_size = cmp_compress_2xi16_in_i32(&ctx, dst_copy, sizeof(dst_copy), words,
+					      sizeof(words));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(copy_size, cmp_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(cmp_hdr_get_cmp_data(dst_copy), cmp_hdr_get_cmp_data(dst),
+				     copy_size - CMP_HDR_SIZE);
+}
+
+
+void test_strided_compression_detects_invalid_layout(void)
+{
+	const uint32_t src[4] = { 0 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), NULL, 2, 4, 0, CMP_U16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_NULL, cmp_size);
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), src, 0, 4, 0, CMP_U16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_size);
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), src, 2, 2, 0, CMP_I16_IN_I32);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_size);
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), src, 2, 3, 0, CMP_U16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_UNALIGNED, cmp_size);
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), src, 2, 8, 2, CMP_I16_IN_I32);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_UNALIGNED, cmp_size);
+
+	cmp_size = cmp_compress_strided(&ctx, dst, sizeof(dst), src, 2, 8, 4, CMP_I16_IN_I32);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + 2 * sizeof(int16_t), cmp_size);
+}
+
+
+TEST_MATRIX([CMP_PREPROCESS_DIFF, CMP_PREPROCESS_IWT, CMP_PREPROCESS_IWT_2D, CMP_PREPROCESS_MED])
+void test_segmented_frame_is_compressed_like_the_contiguous_frame(
+	enum cmp_preprocessing preprocessing)
+{
+	enum { NUM_SAMPLES = 60 };
+	int16_t src[NUM_SAMPLES];
+	struct cmp_segment segments[4];
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_contiguous;
+	struct cmp_hdr hdr, hdr_contiguous;
+	uint32_t cmp_size, contiguous_size;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	/* rows of unequal size and an empty segment */
+	segments[0].data = src;
+	segments[0].size = 7 * sizeof(int16_t);
+	segments[1].data = src + 7;
+	segments[1].size = 0;
+	segments[2].data = src + 7;
+	segments[2].size = 30 * sizeof(int16_t);
+	segments[3].data = src + 37;
+	segments[3].size = (NUM_SAMPLES - 37) * sizeof(int16_t);
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	params.width = 12;
+	params.checksum_enabled = 1;
+	e = make_env(&params, sizeof(src));
+	e_contiguous = make_env(&params, sizeof(src));
+
+	cmp_size = cmp_compress_i16v(&e->ctx, e->dst, e->dst_cap, segments, ARRAY_SIZE(segments));
+	contiguous_size = cmp_compress_i16(&e_contiguous->ctx, e_contiguous->dst,
+					   e_contiguous->dst_cap, src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(contiguous_size, cmp_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_CMP_SUCCESS(
+		cmp_hdr_deserialize(e_contiguous->dst, contiguous_size, &hdr_contiguous));
+	TEST_ASSERT_EQUAL_HEX32(hdr_contiguous.checksum, hdr.checksum);
+	TEST_ASSERT_EQUAL(sizeof(src), hdr.original_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(cmp_hdr_get_cmp_data(e_contiguous->dst),
+				     cmp_hdr_get_cmp_data(e->dst), cmp_size - CMP_HDR_SIZE);
+	free_env(e);
+	free_env(e_contiguous);
+}
+
+
+void test_segmented_compression_detects_invalid_segments(void)
+{
+	const uint32_t src[4] = { 0 };
+	struct cmp_segment segments[2];
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	segments[0].data = src;
+	segments[0].size = sizeof(src[0]);
+	segments[1].data = src + 1;
+	segments[1].size = 3 * sizeof(src[0]);
+
+	cmp_size = cmp_compress_u16v(&ctx, dst, sizeof(dst), NULL, 2);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_NULL, cmp_size);
+
+	cmp_size = cmp_compress_u16v(&ctx, dst, sizeof(dst), segments, 0);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_size);
+
+	segments[1].size = 3;
+	cmp_size = cmp_compress_u16v(&ctx, dst, sizeof(dst), segments, 2);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_size);
+
+	segments[1].data = (const uint8_t *)(src + 1) + 2;
+	segments[1].size = sizeof(src[0]);
+	cmp_size = cmp_compress_i16_in_i32v(&ctx, dst, sizeof(dst), segments, 2);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_UNALIGNED, cmp_size);
+
+	segments[1].data = NULL;
+	cmp_size = cmp_compress_u16v(&ctx, dst, sizeof(dst), segments, 2);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_NULL, cmp_size);
+}
+
+
+TEST_MATRIX([CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_BLOCK_RICE, CMP_ENCODER_PFOR,
+	     CMP_ENCODER_ADAPTIVE_RICE, CMP_ENCODER_RANS, CMP_ENCODER_EXP_GOLOMB])
+void test_packets_of_every_encoder_are_estimated_exactly(enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 1000, PACKET_SIZE = 64 };
+	int16_t src[NUM_SAMPLES];
+	uint32_t cmp_size, estimate;
+	struct test_env *e;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	params.primary_encoder_outlier = 32;
+	params.zero_run_enabled = 1;
+	params.packet_size = PACKET_SIZE;
+	e = make_env(&params, sizeof(src));
+
+	estimate = cmp_estimate_size(&e->ctx, src, sizeof(src), CMP_I16);
+	cmp_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(0, (cmp_size - CMP_HDR_SIZE) % PACKET_SIZE);
+
+	free_env(e);
+}
+
+void test_packetized_frame_fits_its_compress_bound(void)
+{
+	enum { NUM_SAMPLES = 10, PACKET_SIZE = 4096 };
+	int16_t src[NUM_SAMPLES];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t bound, cmp_size, estimate;
+	void *dst;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 1;
+	params.primary_encoder_outlier = 32;
+	params.packet_size = PACKET_SIZE;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	bound = cmp_compress_bound_params(&params, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(bound);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + NUM_SAMPLES * PACKET_SIZE, bound);
+	TEST_ASSERT_GREATER_THAN(cmp_compress_bound(sizeof(src)), bound);
+	dst = t_malloc(bound);
+
+	estimate = cmp_estimate_size(&ctx, src, sizeof(src), CMP_I16);
+	cmp_size = cmp_compress_i16(&ctx, dst, bound, src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(estimate, cmp_size);
+	TEST_ASSERT_LESS_OR_EQUAL(bound, cmp_size);
+	free(dst);
+}
+
+
+void test_compress_bound_params_without_packets_is_compress_bound(void)
+{
+	struct cmp_params params = { 0 };
+
+	TEST_ASSERT_EQUAL(cmp_compress_bound(100), cmp_compress_bound_params(&params, 100));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_GENERIC, cmp_compress_bound_params(NULL, 100));
+
+	params.packet_size = CMP_HDR_MAX_PACKET_SIZE;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_CMP_SIZE_TOO_LARGE,
+				    cmp_compress_bound_params(&params, 1024));
+}
+
+
+void test_packets_start_at_sample_boundaries_and_restart_the_prediction(void)
+{
+	enum { NUM_SAMPLES = 100, PACKET_SIZE = 40 };
+	int16_t src[NUM_SAMPLES];
+	uint64_t dst[(CMP_HDR_SIZE + 8 * PACKET_SIZE) / 8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, estimate, offset, first = 0, i;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	/* raw residuals, so that the packets can be checked without a decoder */
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.packet_size = PACKET_SIZE;
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	estimate = cmp_estimate_size(&ctx, src, sizeof(src), CMP_I16);
+	cmp_size = cmp_compress_i16(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(PACKET_SIZE, hdr.packet_size);
+	TEST_ASSERT_EQUAL(CMP_PREPROCESS_DIFF, hdr.preprocessing);
+	TEST_ASSERT_EQUAL(0, (cmp_size - CMP_HDR_SIZE) % PACKET_SIZE);
+	for (offset = CMP_HDR_SIZE; offset < cmp_size; offset += PACKET_SIZE) {
+		const uint8_t *packet = (const uint8_t *)dst + offset;
+		uint32_t const index = (uint32_t)packet[0] << 16 | packet[1] << 8 | packet[2];
+		uint32_t const n_samples = (uint32_t)packet[3] << 8 | packet[4];
+		int16_t sample = (int16_t)(packet[5] << 8 | packet[6]);
+
+		TEST_ASSERT_EQUAL(first, index);
+		if (offset + PACKET_SIZE < cmp_size)
+			TEST_ASSERT_EQUAL((PACKET_SIZE - CMP_PACKET_HDR_SIZE) / 2, n_samples);
+		else
+			TEST_ASSERT_EQUAL(NUM_SAMPLES - first, n_samples);
+		TEST_ASSERT_EQUAL_HEX16(first ? src[first - 1] : 0, sample);
+		for (i = 0; i < n_samples && first + i < NUM_SAMPLES; i++) {
+			const uint8_t *residual = packet + CMP_PACKET_HDR_SIZE + 2 * i;
+
+			sample = (int16_t)(sample + (int16_t)(residual[0] << 8 | residual[1]));
+			TEST_ASSERT_EQUAL_INT16(src[first + i], sample);
+		}
+		first += n_samples;
+	}
+	TEST_ASSERT_EQUAL(NUM_SAMPLES, first);
+}
+
+
+/* collects the data a sink receives */
+struct sink_buffer {
+	uint8_t data[1024];
+	uint32_t size;
+	uint32_t n_calls;
+	uint32_t fail_call; /* number of the call failing; 0 for none */
+};
+
+
+static int sink_buffer_write(void *opaque, const void *data, uint32_t size)
+{
+	struct sink_buffer *sb = opaque;
+
+	sb->n_calls++;
+	if (sb->n_calls == sb->fail_call)
+		return -1;
+
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(sb->data) - sb->size, size);
+	memcpy(sb->data + sb->size, data, size);
+	sb->size += size;
+	return 0;
+}
+
+
+TEST_MATRIX([CMP_I16_IN_I32, CMP_2xI16_IN_I32], [0, 1])
+void test_sink_receives_the_frame_following_the_head(enum cmp_type dtype, int four_streams)
+{
+	enum { NUM_SAMPLES = 120 };
+	int32_t src[NUM_SAMPLES];
+	DST_ALIGNED_U8 hdr_buf[CMP_SINK_HDR_BUF_SIZE];
+	uint64_t chunk[1];
+	struct sink_buffer sb;
+	struct cmp_sink sink;
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_sink;
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, sink_size, hdr_size;
+	int pass;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16_IN_I32);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	params.primary_encoder_outlier = 60;
+	params.secondary_iterations = 1;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 2;
+	params.secondary_encoder_outlier = 60;
+	params.model_rate = 8;
+	params.four_streams_enabled = four_streams;
+	params.checksum_enabled = 1;
+	e = make_env(&params, sizeof(src));
+	e_sink = make_env(&params, sizeof(src));
+	sink.write = sink_buffer_write;
+	sink.opaque = &sb;
+	sink.buf = chunk;
+	sink.buf_size = sizeof(chunk);
+
+	for (pass = 0; pass < 2; pass++) {
+		memset(&sb, 0, sizeof(sb));
+		cmp_size = dtype == CMP_I16_IN_I32
+				   ? cmp_compress_i16_in_i32(&e->ctx, e->dst, e->dst_cap, src,
+							     sizeof(src))
+				   : cmp_compress_2xi16_in_i32(&e->ctx, e->dst, e->dst_cap, src,
+							       sizeof(src));
+		sink_size = cmp_compress_sink(&e_sink->ctx, hdr_buf, sizeof(hdr_buf), &hdr_size,
+					      &sink, src, sizeof(src), dtype);
+
+		TEST_ASSERT_CMP_SUCCESS(sink_size);
+		TEST_ASSERT_EQUAL(cmp_size, sink_size);
+		TEST_ASSERT_EQUAL(sink_size, hdr_size + sb.size);
+		TEST_ASSERT_GREATER_THAN(1, sb.n_calls);
+		TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(hdr_buf, hdr_size, &hdr));
+		TEST_ASSERT_EQUAL(sink_size, hdr.compressed_size);
+		if (four_streams && dtype == CMP_I16_IN_I32)
+			TEST_ASSERT_EQUAL(CMP_HDR_SIZE + CMP_STREAM_TABLE_SIZE, hdr_size);
+		else if (dtype == CMP_2xI16_IN_I32)
+			TEST_ASSERT_EQUAL(CMP_HDR_SIZE + CMP_CHANNEL_TABLE_SIZE, hdr_size);
+		else
+			TEST_ASSERT_EQUAL(CMP_HDR_SIZE, hdr_size);
+		/* the identifiers of the contexts differ */
+		TEST_ASSERT_EQUAL_HEX8_ARRAY((uint8_t *)e->dst + CMP_HDR_OFFSET_SEQUENCE_NUMBER,
+					     hdr_buf + CMP_HDR_OFFSET_SEQUENCE_NUMBER,
+					     hdr_size - CMP_HDR_OFFSET_SEQUENCE_NUMBER);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY((uint8_t *)e->dst + hdr_size, sb.data, sb.size);
+	}
+	free_env(e);
+	free_env(e_sink);
+}
+
+
+void test_sink_takes_the_single_stream_layout_of_the_uncompressed_fallback(void)
+{
+	/* the four streams do not fit into the uncompressed size, one stream does */
+	const uint16_t src[8] = { 0x0123, 0x0456, 0x0789, 0x0ABC, 0x0DEF, 0x0FED, 0x0CBA, 0x0987 };
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + sizeof(src)];
+	DST_ALIGNED_U8 hdr_buf[CMP_SINK_HDR_BUF_SIZE];
+	uint64_t chunk[1];
+	struct sink_buffer sb;
+	struct cmp_sink sink;
+	struct cmp_context ctx, ctx_sink;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, sink_size, hdr_size;
+
+	params.primary_encoder_type = CMP_ENCODER_PFOR;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	params.four_streams_enabled = 1;
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx_sink, &params, NULL, 0));
+	memset(&sb, 0, sizeof(sb));
+	sink.write = sink_buffer_write;
+	sink.opaque = &sb;
+	sink.buf = chunk;
+	sink.buf_size = sizeof(chunk);
+
+	cmp_size = cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src));
+	sink_size = cmp_compress_sink(&ctx_sink, hdr_buf, sizeof(hdr_buf), &hdr_size, &sink, src,
+				      sizeof(src), CMP_U16);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, sink_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE, hdr_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(hdr_buf, hdr_size, &hdr));
+	TEST_ASSERT_EQUAL(CMP_ENCODER_PFOR, hdr.encoder_type);
+	TEST_ASSERT_EQUAL_HEX(0, hdr.encoder_flags);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(dst + hdr_size, sb.data, sb.size);
+	TEST_ASSERT_EQUAL(1, ctx_sink.params.four_streams_enabled);
+}
+
+void test_sink_compression_detects_errors(void)
+{
+	const int16_t src[64] = { 0 };
+	DST_ALIGNED_U8 hdr_buf[CMP_SINK_HDR_BUF_SIZE];
+	uint64_t chunk[1];
+	struct sink_buffer sb;
+	struct cmp_sink sink;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t cmp_size;
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	memset(&sb, 0, sizeof(sb));
+	sink.write = sink_buffer_write;
+	sink.opaque = &sb;
+	sink.buf = chunk;
+	sink.buf_size = sizeof(chunk);
+
+	cmp_size = cmp_compress_sink(&ctx, hdr_buf, sizeof(hdr_buf), NULL, NULL, src,
+				     sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_NULL, cmp_size);
+
+	cmp_size = cmp_compress_sink(&ctx, hdr_buf, CMP_HDR_SIZE, NULL, &sink, src, sizeof(src),
+				     CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, cmp_size);
+
+	cmp_size = cmp_compress_sink(&ctx, hdr_buf + 1, sizeof(hdr_buf) - 1, NULL, &sink, src,
+				     sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_UNALIGNED, cmp_size);
+
+	sink.buf_size = 4;
+	cmp_size = cmp_compress_sink(&ctx, hdr_buf, sizeof(hdr_buf), NULL, &sink, src,
+				     sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, cmp_size);
+	TEST_ASSERT_EQUAL(0, sb.n_calls);
+
+	sink.buf_size = sizeof(chunk);
+	sb.fail_call = 3;
+	cmp_size = cmp_compress_sink(&ctx, hdr_buf, sizeof(hdr_buf), NULL, &sink, src,
+				     sizeof(src), CMP_I16);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_SINK, cmp_size);
+	TEST_ASSERT_EQUAL(3, sb.n_calls);
+}
+
+
+TEST_MATRIX([0, 1])
+void test_compact_headers_follow_the_full_header_of_a_sequence(int four_streams)
+{
+	enum { NUM_SAMPLES = 120, NUM_FRAMES = 5 };
+	int16_t src[NUM_SAMPLES];
+	DST_ALIGNED_U8 hdr_buf[CMP_SINK_HDR_BUF_SIZE];
+	uint64_t chunk[1];
+	struct sink_buffer sb;
+	struct cmp_sink sink;
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_sink;
+	struct cmp_hdr hdr, seq_hdr = { 0 };
+	uint32_t cmp_size, estimate, hdr_size, full_size = 0;
+	int frame;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	params.primary_encoder_outlier = 60;
+	params.secondary_iterations = 3;
+	params.secondary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 4;
+	params.secondary_encoder_outlier = 60;
+	params.four_streams_enabled = four_streams;
+	params.checksum_enabled = 1;
+	params.compact_header_enabled = 1;
+	e = make_env(&params, sizeof(src));
+	e_sink = make_env(&params, sizeof(src));
+	sink.write = sink_buffer_write;
+	sink.opaque = &sb;
+	sink.buf = chunk;
+	sink.buf_size = sizeof(chunk);
+
+	for (frame = 0; frame < NUM_FRAMES; frame++) {
+		/* the frame after the secondary iterations starts a new sequence */
+		int const is_full = frame == 0 || frame == NUM_FRAMES - 1;
+		const uint8_t *dst = e->dst;
+
+		estimate = cmp_estimate_size(&e->ctx, src, sizeof(src), CMP_I16);
+		cmp_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(estimate, cmp_size);
+		TEST_ASSERT_EQUAL(!is_full, !!(dst[0] & CMP_HDR_COMPACT_MARKER));
+		hdr_size = cmp_hdr_deserialize(dst, cmp_size, &seq_hdr);
+		TEST_ASSERT_CMP_SUCCESS(hdr_size);
+		TEST_ASSERT_EQUAL(cmp_size, seq_hdr.compressed_size);
+		TEST_ASSERT_EQUAL(sizeof(src), seq_hdr.original_size);
+		TEST_ASSERT_EQUAL(is_full ? 0 : frame, seq_hdr.sequence_number);
+		TEST_ASSERT_EQUAL(4, seq_hdr.encoder_param);
+		TEST_ASSERT_EQUAL(CMP_PREPROCESS_DIFF, seq_hdr.preprocessing);
+		if (is_full) {
+			TEST_ASSERT_EQUAL(CMP_HDR_SIZE, hdr_size);
+			full_size = cmp_size;
+		} else {
+			TEST_ASSERT_LESS_THAN(CMP_HDR_SIZE, hdr_size);
+			/* only the header shrinks */
+			TEST_ASSERT_EQUAL(full_size - CMP_HDR_SIZE + hdr_size, cmp_size);
+		}
+		TEST_ASSERT_CMP_SUCCESS(cmp_hdr_checksum(&hdr.checksum, src, sizeof(src), CMP_I16));
+		TEST_ASSERT_EQUAL_HEX(hdr.checksum, seq_hdr.checksum);
+
+		/* the sink gets the same frame */
+		memset(&sb, 0, sizeof(sb));
+		cmp_size = cmp_compress_sink(&e_sink->ctx, hdr_buf, sizeof(hdr_buf), &hdr_size,
+					     &sink, src, sizeof(src), CMP_I16);
+		TEST_ASSERT_EQUAL(seq_hdr.compressed_size, cmp_size);
+		TEST_ASSERT_EQUAL(cmp_size, hdr_size + sb.size);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(dst + hdr_size, sb.data, sb.size);
+		if (!is_full)
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(dst, hdr_buf, hdr_size);
+	}
+	free_env(e);
+	free_env(e_sink);
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16])
+void test_estimated_size_considers_uncompressed_fallback(const struct cmp_test_fixture *fix)
+{
+	const uint16_t src[] = { 0xAAAA, 0xBBBB, 0xCCCC };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t estimate, cmp_size;
+
+	params.uncompressed_fallback_enabled = 1;
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	estimate = cmp_estimate_size(&ctx, src, sizeof(src), fix->dtype);
+	cmp_size = fix->compress(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(src), estimate);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+}
+
+
+void test_estimated_size_detects_model_size_mismatch(void)
+{
+	const uint16_t src[] = { 1, 2, 3, 4 };
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	uint32_t return_val;
+
+	params.secondary_iterations = 1;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	e = make_env(&params, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_u16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src)));
+
+	return_val = cmp_estimate_size(&e->ctx, src, sizeof(src) - 2, CMP_U16);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_MISMATCH, return_val);
+	free_env(e);
+}
+
+
+void test_estimated_size_detects_invalid_context(void)
+{
+	const uint16_t src[] = { 1, 2 };
+	struct cmp_context ctx;
+
+	cmp_deinitialise(&ctx);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_CONTEXT_INVALID,
+				    cmp_estimate_size(&ctx, src, sizeof(src), CMP_U16));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_GENERIC,
+				    cmp_estimate_size(NULL, src, sizeof(src), CMP_U16));
+}
+
+
+static uint32_t compressed_size_with(const struct cmp_test_fixture *fix, const void *src,
+				     uint32_t src_size, enum cmp_encoder_type encoder_type,
+				     uint32_t encoder_param, uint32_t outlier)
+{
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	uint32_t cmp_size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = encoder_param;
+	params.primary_encoder_outlier = outlier;
+	e = make_env(&params, src_size);
+
+	cmp_size = fix->compress(&e->ctx, e->dst, e->dst_cap, src, src_size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+
+	free_env(e);
+	return cmp_size;
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16, &cmp_fixture_i16_in_i32])
+void test_golomb_costs_match_compressed_sizes(const struct cmp_test_fixture *fix)
+{
+	enum { NUM_SAMPLES = 100, PARAM_MIN = 1, PARAM_MAX = 40 };
+	int32_t src[NUM_SAMPLES];
+	uint32_t const src_size = NUM_SAMPLES * (fix->dtype == CMP_I16_IN_I32 ? 4 : 2);
+	struct cmp_golomb_cost costs[PARAM_MAX - PARAM_MIN + 1];
+	struct cmp_params params = { 0 };
+	struct cmp_context ctx;
+	uint32_t *hist = t_malloc(CMP_HIST_BUF_SIZE);
+	uint32_t i;
+
+	fill_test_data(src, NUM_SAMPLES, fix->dtype);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_golomb_costs(&ctx, src, src_size, fix->dtype, hist,
+						 CMP_HIST_BUF_SIZE, PARAM_MIN, PARAM_MAX, costs));
+
+	for (i = 0; i < ARRAY_SIZE(costs); i++) {
+		struct cmp_golomb_cost *c = &costs[i];
+		uint32_t outlier;
+
+		TEST_ASSERT_EQUAL(PARAM_MIN + i, c->encoder_param);
+		TEST_ASSERT_EQUAL(compressed_size_with(fix, src, src_size,
+						       CMP_ENCODER_GOLOMB_ZERO,
+						       c->encoder_param, 0),
+				  c->zero_size);
+		TEST_ASSERT_EQUAL(compressed_size_with(fix, src, src_size,
+						       CMP_ENCODER_GOLOMB_MULTI,
+						       c->encoder_param, c->multi_outlier),
+				  c->multi_size);
+		/* no other outlier is better */
+		for (outlier = 1; outlier < c->multi_outlier + 20; outlier += 7)
+			TEST_ASSERT_TRUE(compressed_size_with(fix, src, src_size,
+							      CMP_ENCODER_GOLOMB_MULTI,
+							      c->encoder_param, outlier) >=
+					 c->multi_size);
+	}
+	free(hist);
+}
+
+
+void test_golomb_costs_match_estimate_with_compact_headers(void)
+{
+	enum { NUM_SAMPLES = 100, PARAM_MIN = 1, PARAM_MAX = 40, FIRST_PARAM = 3 };
+	int16_t src[NUM_SAMPLES];
+	DST_ALIGNED_U8 dst[CMP_HDR_SIZE + 6 * NUM_SAMPLES + 8];
+	struct cmp_golomb_cost costs[PARAM_MAX - PARAM_MIN + 1];
+	struct cmp_params params = { 0 };
+	struct cmp_context ctx;
+	uint32_t *hist = t_malloc(CMP_HIST_BUF_SIZE);
+	uint32_t i;
+
+	fill_test_data(src, NUM_SAMPLES, CMP_I16);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = FIRST_PARAM;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = FIRST_PARAM;
+	params.compact_header_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	/* the next frame continues the sequence and can get a compact header */
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), src, sizeof(src)));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_golomb_costs(&ctx, src, sizeof(src), CMP_I16, hist,
+						 CMP_HIST_BUF_SIZE, PARAM_MIN, PARAM_MAX, costs));
+
+	for (i = 0; i < ARRAY_SIZE(costs); i++) {
+		struct cmp_golomb_cost *c = &costs[i];
+		struct cmp_context zero_ctx = ctx, multi_ctx = ctx;
+
+		zero_ctx.params.secondary_encoder_param = c->encoder_param;
+		multi_ctx.params.secondary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+		multi_ctx.params.secondary_encoder_param = c->encoder_param;
+		multi_ctx.params.secondary_encoder_outlier = c->multi_outlier;
+
+		TEST_ASSERT_EQUAL(cmp_estimate_size(&zero_ctx, src, sizeof(src), CMP_I16),
+				  c->zero_size);
+		TEST_ASSERT_EQUAL(cmp_estimate_size(&multi_ctx, src, sizeof(src), CMP_I16),
+				  c->multi_size);
+		if (c->encoder_param == FIRST_PARAM) {
+			zero_ctx.params.compact_header_enabled = 0;
+			TEST_ASSERT_LESS_THAN(cmp_estimate_size(&zero_ctx, src, sizeof(src),
+								CMP_I16),
+					      c->zero_size);
+		}
+	}
+	free(hist);
+}
+
+
+TEST_MATRIX([0, 1, 2])
+void test_golomb_costs_rejects_order_dependent_layouts(int layout)
+{
+	const uint16_t src[] = { 1, 0, 0, 0, 5, 6, 0, 0 };
+	struct cmp_golomb_cost costs[2];
+	struct cmp_params params = { 0 };
+	struct cmp_context ctx;
+	uint32_t *hist = t_malloc(CMP_HIST_BUF_SIZE);
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	params.zero_run_enabled = layout == 0;
+	params.four_streams_enabled = layout == 1;
+	params.packet_size = layout == 2 ? CMP_PACKET_MIN_SIZE : 0;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	/* the sizes depend on the order of the values, not only on their histogram */
+	TEST_ASSERT_CMP_SUCCESS(cmp_estimate_size(&ctx, src, sizeof(src), CMP_U16));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_golomb_costs(&ctx, src, sizeof(src), CMP_U16, hist,
+						     CMP_HIST_BUF_SIZE, 1, 2, costs));
+	free(hist);
+}
+
+
+void test_golomb_costs_detects_invalid_arguments(void)
+{
+	const uint16_t src[] = { 1, 2, 3, 4 };
+	struct cmp_golomb_cost costs[2];
+	uint32_t hist[1];
+	struct cmp_context ctx = create_uncompressed_context();
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_golomb_costs(&ctx, src, sizeof(src), CMP_U16, hist,
+						     CMP_HIST_BUF_SIZE, 0, 1, costs));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_golomb_costs(&ctx, src, sizeof(src), CMP_U16, hist,
+						     CMP_HIST_BUF_SIZE, 2, 1, costs));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_WORK_BUF_NULL,
+				    cmp_golomb_costs(&ctx, src, sizeof(src), CMP_U16, NULL,
+						     CMP_HIST_BUF_SIZE, 1, 2, costs));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_WORK_BUF_TOO_SMALL,
+				    cmp_golomb_costs(&ctx, src, sizeof(src), CMP_U16, hist,
+						     sizeof(hist), 1, 2, costs));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_GENERIC,
+				    cmp_golomb_costs(&ctx, src, sizeof(src), CMP_U16, hist,
+						     CMP_HIST_BUF_SIZE, 1, 2, NULL));
+}
+
+
+TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16, &cmp_fixture_i16_in_i32],
+	    [CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_GOLOMB_MULTI])
+void test_auto_encoder_param_is_selected_from_data(const struct cmp_test_fixture *fix,
+						   enum cmp_encoder_type encoder_type)
+{
+	enum { NUM_SAMPLES = 50 };
+	int32_t src[NUM_SAMPLES];
+	uint32_t const src_size = NUM_SAMPLES * (fix->dtype == CMP_I16_IN_I32 ? 4 : 2);
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	struct cmp_hdr hdr;
+	uint32_t i, estimate, cmp_size;
+
+	/* all DIFF residuals are 5 -> mapped value 10 -> Golomb parameter 7 */
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		if (fix->dtype == CMP_I16_IN_I32)
+			src[i] = (int32_t)(5 * (i + 1));
+		else
+			((int16_t *)src)[i] = (int16_t)(5 * (i + 1));
+	}
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	params.primary_encoder_outlier = 100;
+	e = make_env(&params, src_size);
+
+	estimate = cmp_estimate_size(&e->ctx, src, src_size, fix->dtype);
+	cmp_size = fix->compress(&e->ctx, e->dst, e->dst_cap, src, src_size);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(cmp_size, estimate);
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(7, hdr.encoder_param);
+	free_env(e);
+}
+
+
+void test_auto_encoder_param_for_every_frame(void)
+{
+	uint16_t src[16] = { 0 };
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	struct cmp_hdr hdr;
+	uint32_t cmp_size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	e = make_env(&params, sizeof(src));
+
+	/* all zero -> smallest parameter */
+	cmp_size = cmp_compress_u16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(1, hdr.encoder_param);
+
+	/* mapped mean 1000 -> ln(2) * 1000 */
+	memset(src, 0, sizeof(src));
+	src[0] = 8000;
+	cmp_size = cmp_compress_u16(&e->ctx, e->dst, e->dst_cap, src, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(e->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(693, hdr.encoder_param);
+	free_env(e);
+}
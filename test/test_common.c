@@ -60,6 +60,8 @@ static const char *cmp_error_enum_to_str(enum cmp_error error)
 		return "CMP_ERR_DST_NULL";
 	case CMP_ERR_DST_UNALIGNED:
 		return "CMP_ERR_DST_UNALIGNED";
+	case CMP_ERR_DST_SINK:
+		return "CMP_ERR_DST_SINK";
 	case CMP_ERR_SRC_NULL:
 		return "CMP_ERR_SRC_NULL";
 	case CMP_ERR_SRC_SIZE_WRONG:
@@ -68,6 +70,10 @@ static const char *cmp_error_enum_to_str(enum cmp_error error)
 		return "CMP_ERR_DST_TOO_SMALL";
 	case CMP_ERR_SRC_SIZE_MISMATCH:
 		return "CMP_ERR_SRC_SIZE_MISMATCH";
+	case CMP_ERR_SRC_VALUE_TOO_LARGE:
+		return "CMP_ERR_SRC_VALUE_TOO_LARGE";
+	case CMP_ERR_SRC_UNALIGNED:
+		return "CMP_ERR_SRC_UNALIGNED";
 	case CMP_ERR_INT_HDR:
 		return "CMP_ERR_INT_HDR";
 	case CMP_ERR_INT_ENCODER:
@@ -78,6 +84,8 @@ static const char *cmp_error_enum_to_str(enum cmp_error error)
 		return "CMP_ERR_HDR_CMP_SIZE_TOO_LARGE";
 	case CMP_ERR_HDR_ORIGINAL_TOO_LARGE:
 		return "CMP_ERR_HDR_ORIGINAL_TOO_LARGE";
+	case CMP_ERR_HDR_CHUNK_INDEX:
+		return "CMP_ERR_HDR_CHUNK_INDEX";
 	case CMP_ERR_MAX_CODE:
 	default:
 		TEST_FAIL_MESSAGE("Missing error name");
@@ -98,6 +98,24 @@ void assert_equal_cmp_error_internal(enum cmp_error expected_error, uint32_t cmp
 		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.preprocess_param,                           \
 					  assert_hdr.preprocess_param,                             \
 					  "header preprocess param mismatch");                     \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.encoder_flags, assert_hdr.encoder_flags,    \
+					  "header encoder flags mismatch");                        \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.width, assert_hdr.width,                    \
+					  "header width mismatch");                                \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.temporal_levels,                            \
+					  assert_hdr.temporal_levels,                              \
+					  "header temporal levels mismatch");                      \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.temporal_wavelet,                           \
+					  assert_hdr.temporal_wavelet,                             \
+					  "header temporal wavelet mismatch");                     \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.temporal_index,                             \
+					  assert_hdr.temporal_index,                               \
+					  "header temporal index mismatch");                       \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.near_lossless_delta,                        \
+					  assert_hdr.near_lossless_delta,                          \
+					  "header near-lossless delta mismatch");                  \
+		TEST_ASSERT_EQUAL_MESSAGE(expected_hdr.n_bits, assert_hdr.n_bits,                  \
+					  "header bits per sample mismatch");                      \
 		TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&expected_hdr, &assert_hdr, sizeof(expected_hdr), \
 						 "header mismatch");                               \
 	} while (0)
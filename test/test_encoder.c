@@ -155,6 +155,92 @@ void test_bitstream_write_16in32_array_than_bits(void)
 }
 
 
+void test_bitstream_write_packed_array_like_single_values(void)
+{
+	uint16_t src[40];
+	uint64_t packed[12], single[12];
+	struct bitstream_writer bsw_packed, bsw_single;
+	unsigned int nb_bits;
+	uint32_t i, size;
+
+	for (i = 0; i < ARRAY_SIZE(src); i++)
+		src[i] = (uint16_t)(0xA5C3 * (i + 1));
+
+	for (nb_bits = 0; nb_bits <= 16; nb_bits++) {
+		/* the second size leaves no room for the fast path */
+		uint32_t const buf_sizes[2] = { sizeof(packed), (nb_bits * 40 + 3 + 7) / 8 };
+		int k;
+
+		for (k = 0; k < 2; k++) {
+			memset(packed, 0xFF, sizeof(packed));
+			memset(single, 0xFF, sizeof(single));
+			TEST_ASSERT_CMP_SUCCESS(
+				bitstream_writer_init(&bsw_packed, packed, buf_sizes[k]));
+			TEST_ASSERT_CMP_SUCCESS(
+				bitstream_writer_init(&bsw_single, single, buf_sizes[k]));
+
+			bitstream_add_bits32(&bsw_packed, 0x5, 3);
+			bitstream_add_bits32(&bsw_single, 0x5, 3);
+			bitstream_add_packed_u16_array(&bsw_packed, src, ARRAY_SIZE(src), nb_bits);
+			for (i = 0; i < ARRAY_SIZE(src); i++)
+				bitstream_add_bits32(&bsw_single, src[i] & ((1U << nb_bits) - 1),
+						     nb_bits);
+			size = bitstream_flush(&bsw_packed);
+
+			TEST_ASSERT_CMP_SUCCESS(size);
+			TEST_ASSERT_EQUAL(bitstream_flush(&bsw_single), size);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(single, packed, size);
+		}
+	}
+}
+
+
+void test_bitstream_split_and_join_like_one_writer(void)
+{
+	uint64_t joined[8], single[8];
+	struct bitstream_writer bsw_joined, bsw_upper, bsw_single;
+	uint32_t n_lower, n_upper, i, size;
+
+	for (n_lower = 0; n_lower <= 17; n_lower++) {
+		for (n_upper = 0; n_upper <= 17; n_upper++) {
+			memset(joined, 0xFF, sizeof(joined));
+			memset(single, 0xFF, sizeof(single));
+			TEST_ASSERT_CMP_SUCCESS(
+				bitstream_writer_init(&bsw_joined, joined, sizeof(joined)));
+			TEST_ASSERT_CMP_SUCCESS(
+				bitstream_writer_init(&bsw_single, single, sizeof(single)));
+			TEST_ASSERT_CMP_SUCCESS(bitstream_split(&bsw_joined, &bsw_upper, 20));
+
+			for (i = 0; i < n_lower; i++)
+				bitstream_add_bits32(&bsw_joined, i + 1, 8);
+			for (i = 0; i < n_upper; i++)
+				bitstream_add_bits32(&bsw_upper, 0xA0 + i, 8);
+			bitstream_add_bits32(&bsw_upper, 0x3, 2);
+			bitstream_pad_to_byte(&bsw_upper);
+			for (i = 0; i < n_lower; i++)
+				bitstream_add_bits32(&bsw_single, i + 1, 8);
+			for (i = 0; i < n_upper; i++)
+				bitstream_add_bits32(&bsw_single, 0xA0 + i, 8);
+			bitstream_add_bits32(&bsw_single, 0x3, 2);
+			bitstream_pad_to_byte(&bsw_single);
+
+			size = bitstream_join(&bsw_joined, &bsw_upper);
+			TEST_ASSERT_CMP_SUCCESS(size);
+			TEST_ASSERT_EQUAL(n_lower + n_upper + 1, size);
+			TEST_ASSERT_EQUAL(size, bitstream_size(&bsw_joined));
+
+			/* the joined writer goes on like the single one */
+			bitstream_add_bits32(&bsw_joined, 0x12345, 20);
+			bitstream_add_bits32(&bsw_single, 0x12345, 20);
+			size = bitstream_flush(&bsw_joined);
+			TEST_ASSERT_CMP_SUCCESS(size);
+			TEST_ASSERT_EQUAL(bitstream_flush(&bsw_single), size);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(single, joined, size);
+		}
+	}
+}
+
+
 static void run_encoder_test(enum cmp_encoder_type type, uint32_t encoder_param,
 			     uint32_t encoder_outlier, const int16_t *input_data,
 			     uint32_t input_size, const uint8_t *expected, uint32_t expected_size,
@@ -354,6 +440,240 @@ void test_golomb_multi_param_max_encodes_largest_value(void)
 }
 
 
+void test_block_rice_encodes_zero_block(void)
+{
+	const int16_t data[] = { 0, 0, 0, 0 };
+	const uint8_t expected[] = { 0x00 };
+
+	run_encoder_test(CMP_ENCODER_BLOCK_RICE, 4, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_block_rice_encodes_rice_block(void)
+{
+	/* mapped: 2, 1, 4, 0 -> k = 0 is the shortest option */
+	const int16_t data[] = { 1, -1, 2, 0 };
+	const uint8_t expected[] = { 0x1D, 0x78 };
+
+	run_encoder_test(CMP_ENCODER_BLOCK_RICE, 4, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_block_rice_encodes_raw_block(void)
+{
+	const int16_t data[] = { INT16_MIN, INT16_MAX };
+	const uint8_t expected[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xE0 };
+
+	run_encoder_test(CMP_ENCODER_BLOCK_RICE, 2, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_block_rice_encodes_last_incomplete_block(void)
+{
+	/* zero block followed by a single sample block with k = 2 */
+	const int16_t data[] = { 0, 0, 3 };
+	const uint8_t expected[] = { 0x03, 0xA0 };
+
+	run_encoder_test(CMP_ENCODER_BLOCK_RICE, 2, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_adaptive_rice_adapts_parameter_to_previous_samples(void)
+{
+	/* mapped: 2, 1, 0, 16 -> k = 2, 2, 2, 1 */
+	const int16_t data[] = { 1, -1, 0, 8 };
+	const uint8_t expected[] = { 0x44, 0x7F, 0x80 };
+
+	run_encoder_test(CMP_ENCODER_ADAPTIVE_RICE, 64, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_adaptive_rice_escapes_large_values_and_resets_statistics(void)
+{
+	/* escape symbol with raw value followed by a zero coded with the largest k */
+	const int16_t data[] = { INT16_MIN, 0 };
+	const uint8_t expected[] = { 0xFF, 0xFF, 0xFF, 0xFE, 0x00, 0x00 };
+
+	run_encoder_test(CMP_ENCODER_ADAPTIVE_RICE, 2, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_pfor_packs_block_with_smallest_width(void)
+{
+	/* mapped: 2, 1, 4, 0 -> width 3 without exceptions */
+	const int16_t data[] = { 1, -1, 2, 0 };
+	const uint8_t expected[] = { 0x1A, 0x30, 0x00 };
+
+	run_encoder_test(CMP_ENCODER_PFOR, 4, 0, data, sizeof(data), expected, sizeof(expected),
+			 0);
+}
+
+
+void test_pfor_patches_exceptions(void)
+{
+	/* mapped: 0, 2, 0, 65535 -> width 2 with one exception at position 3 */
+	const int16_t data[] = { 0, 1, 0, INT16_MIN };
+	const uint8_t expected[] = { 0x11, 0x19, 0xFF, 0xFF };
+
+	run_encoder_test(CMP_ENCODER_PFOR, 4, 0, data, sizeof(data), expected, sizeof(expected),
+			 0);
+}
+
+
+void test_pfor_encodes_last_incomplete_block(void)
+{
+	/* zero block followed by a single sample block with width 3 */
+	const int16_t data[] = { 0, 0, 0, 0, 3 };
+	const uint8_t expected[] = { 0x00, 0x1E, 0x00 };
+
+	run_encoder_test(CMP_ENCODER_PFOR, 4, 0, data, sizeof(data), expected, sizeof(expected),
+			 0);
+}
+
+
+void test_rans_stores_short_frames_raw(void)
+{
+	/* empty frequency table followed by the mapped samples 2 and 1 */
+	const int16_t data[] = { 1, -1 };
+	const uint8_t expected[] = { 0x00, 0x00, 0x10, 0x00, 0x08 };
+
+	run_encoder_test(CMP_ENCODER_RANS, 4, 0, data, sizeof(data), expected, sizeof(expected),
+			 0);
+}
+
+
+void test_rans_encodes_frequency_table_and_final_state(void)
+{
+	/* a single symbol with the full frequency does not change the state */
+	const int16_t data[32] = { 0 };
+	const uint8_t expected[] = { 0x0C, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00 };
+
+	run_encoder_test(CMP_ENCODER_RANS, 1, 0, data, sizeof(data), expected, sizeof(expected),
+			 0);
+}
+
+
+void test_exp_golomb_order0_encodes_values_without_escape(void)
+{
+	/* mapped: 0, 2, 1, 65535 -> the largest value needs 33 bits */
+	const int16_t data[] = { 0, 1, -1, INT16_MIN };
+	const uint8_t expected[] = { 0xB4, 0x00, 0x01, 0x00, 0x00 };
+
+	run_encoder_test(CMP_ENCODER_EXP_GOLOMB, 0, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_exp_golomb_order3_encodes_normal_values(void)
+{
+	/* mapped: 0, 8, 9 */
+	const int16_t data[] = { 0, 4, -5 };
+	const uint8_t expected[] = { 0x84, 0x11 };
+
+	run_encoder_test(CMP_ENCODER_EXP_GOLOMB, 3, 0, data, sizeof(data), expected,
+			 sizeof(expected), 0);
+}
+
+
+void test_zero_run_coding_collapses_runs_of_zero_residuals(void)
+{
+	/* run of 3, mapped 2, run of 1 coded with order-0 Exp-Golomb codewords */
+	const int16_t input_data[] = { 0, 0, 0, 1, 0 };
+	const uint8_t expected[] = { 0xB7, 0x80 };
+	DST_ALIGNED_U8 output_buf[CMP_HDR_SIZE + sizeof(expected)];
+	uint32_t output_size;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr expected_hdr = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_EXP_GOLOMB;
+	params.primary_encoder_param = 0;
+	params.zero_run_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	output_size = cmp_compress_i16(&ctx, output_buf, sizeof(output_buf), input_data,
+				       sizeof(input_data));
+
+	TEST_ASSERT_CMP_SUCCESS(output_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(expected), output_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, cmp_hdr_get_cmp_data(output_buf), sizeof(expected));
+	expected_hdr.compressed_size = output_size;
+	expected_hdr.original_size = sizeof(input_data);
+	expected_hdr.encoder_type = CMP_ENCODER_EXP_GOLOMB;
+	expected_hdr.original_dtype = CMP_I16;
+	expected_hdr.encoder_flags = CMP_HDR_FLAG_ZERO_RUN;
+	TEST_ASSERT_CMP_HDR(output_buf, output_size, expected_hdr);
+}
+
+
+void test_golomb_zero_escapes_outliers_with_sample_bit_depth(void)
+{
+	/* zero escape symbol followed by the 12-bit mapped sample 4095 */
+	const int16_t input_data[] = { -2048 };
+	const uint8_t expected[] = { 0x7F, 0xF8 };
+	DST_ALIGNED_U8 output_buf[CMP_HDR_SIZE + sizeof(expected)];
+	uint32_t output_size;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr expected_hdr = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	params.n_bits = 12;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	output_size = cmp_compress_i16(&ctx, output_buf, sizeof(output_buf), input_data,
+				       sizeof(input_data));
+
+	TEST_ASSERT_CMP_SUCCESS(output_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(expected), output_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, cmp_hdr_get_cmp_data(output_buf), sizeof(expected));
+	expected_hdr.compressed_size = output_size;
+	expected_hdr.original_size = sizeof(input_data);
+	expected_hdr.encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	expected_hdr.encoder_param = 1;
+	expected_hdr.encoder_outlier = 12;
+	expected_hdr.original_dtype = CMP_I16;
+	expected_hdr.n_bits = 12;
+	TEST_ASSERT_CMP_HDR(output_buf, output_size, expected_hdr);
+}
+
+
+void test_uncompressed_encoder_packs_samples_with_sample_bit_depth(void)
+{
+	const uint16_t input_data[] = { 0x123, 0xABC, 0xFFF };
+	const uint8_t expected[] = { 0x12, 0x3A, 0xBC, 0xFF, 0xF0 };
+	DST_ALIGNED_U8 output_buf[CMP_HDR_SIZE + sizeof(expected)];
+	uint32_t output_size;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr expected_hdr = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.n_bits = 12;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	output_size = cmp_compress_u16(&ctx, output_buf, sizeof(output_buf), input_data,
+				       sizeof(input_data));
+
+	TEST_ASSERT_CMP_SUCCESS(output_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(expected), output_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, cmp_hdr_get_cmp_data(output_buf), sizeof(expected));
+	expected_hdr.compressed_size = output_size;
+	expected_hdr.original_size = sizeof(input_data);
+	expected_hdr.encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	expected_hdr.original_dtype = CMP_U16;
+	expected_hdr.n_bits = 12;
+	TEST_ASSERT_CMP_HDR(output_buf, output_size, expected_hdr);
+}
+
+
 void test_use_secondary_encoder_for_second_pass(void)
 {
 	const uint16_t input_data[] = { 82, 4, 0 };
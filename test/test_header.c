@@ -38,11 +38,19 @@ void test_serialize_compression_header(void)
 	hdr.identifier = 0x0C0D0E0F;
 	hdr.sequence_number = 0x10;
 	hdr.preprocessing = 0x0;
-	hdr.encoder_type = 0x2;
+	hdr.encoder_type = 0x4;
 	hdr.original_dtype = 0x1;
 	hdr.encoder_param = 0x1213;
 	hdr.encoder_outlier = 0x141516;
 	hdr.preprocess_param = 0x17;
+	hdr.encoder_flags = 0x18;
+	hdr.width = 0x191A;
+	hdr.temporal_levels = 0x0;
+	hdr.temporal_wavelet = 0x1;
+	hdr.temporal_index = 0xB;
+	hdr.near_lossless_delta = 0x1C;
+	hdr.n_bits = 0x1D;
+	hdr.packet_size = 0x1E1F;
 
 	hdr_size = cmp_hdr_serialize(&bs, &hdr);
 
@@ -62,7 +70,7 @@ void test_serialize_compression_header_with_maximum_values(void)
 
 	memset(buf, 0xAB, sizeof(buf));
 	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bs, buf, sizeof(buf)));
-	hdr.version = MAX_VALUE(CMP_HDR_BITS_VERSION);
+	hdr.version = CMP_HDR_MAX_VERSION;
 	hdr.compressed_size = MAX_VALUE(CMP_HDR_BITS_COMPRESSED_SIZE);
 	hdr.original_size = MAX_VALUE(CMP_HDR_BITS_ORIGINAL_SIZE);
 	hdr.checksum = MAX_VALUE(CMP_HDR_BITS_CHECKSUM);
@@ -74,12 +82,21 @@ void test_serialize_compression_header_with_maximum_values(void)
 	hdr.encoder_outlier = MAX_VALUE(CMP_HDR_BITS_ENCODER_OUTLIER);
 	hdr.original_dtype = MAX_VALUE(CMP_HDR_BITS_ORIGINAL_DTYPE);
 	hdr.preprocess_param = MAX_VALUE(CMP_HDR_BITS_PREPROCESS_PARAM);
+	hdr.encoder_flags = MAX_VALUE(CMP_HDR_BITS_ENCODER_FLAGS);
+	hdr.width = MAX_VALUE(CMP_HDR_BITS_WIDTH);
+	hdr.temporal_levels = MAX_VALUE(CMP_HDR_BITS_TEMPORAL_LEVELS);
+	hdr.temporal_wavelet = MAX_VALUE(CMP_HDR_BITS_TEMPORAL_WAVELET);
+	hdr.temporal_index = MAX_VALUE(CMP_HDR_BITS_TEMPORAL_INDEX);
+	hdr.near_lossless_delta = MAX_VALUE(CMP_HDR_BITS_NL_DELTA);
+	hdr.n_bits = MAX_VALUE(CMP_HDR_BITS_N_BITS);
+	hdr.packet_size = MAX_VALUE(CMP_HDR_BITS_PACKET_SIZE);
 
 	hdr_size = cmp_hdr_serialize(&bs, &hdr);
 
 	TEST_ASSERT_CMP_SUCCESS(hdr_size);
 	TEST_ASSERT_EQUAL(CMP_HDR_SIZE, hdr_size);
-	TEST_ASSERT_EACH_EQUAL_HEX8(0xFF, buf, CMP_HDR_SIZE);
+	TEST_ASSERT_EQUAL_HEX8(0x7F, buf[0]);
+	TEST_ASSERT_EACH_EQUAL_HEX8(0xFF, buf + 1, CMP_HDR_SIZE - 1);
 }
 
 
@@ -98,11 +115,19 @@ void test_deserialize_compression_header(void)
 	expected_hdr.identifier = 0x0C0D0E0F;
 	expected_hdr.sequence_number = 0x10;
 	expected_hdr.preprocessing = 0x0;
-	expected_hdr.encoder_type = 0x2;
+	expected_hdr.encoder_type = 0x4;
 	expected_hdr.original_dtype = 0x1;
 	expected_hdr.encoder_param = 0x1213;
 	expected_hdr.encoder_outlier = 0x141516;
 	expected_hdr.preprocess_param = 0x17;
+	expected_hdr.encoder_flags = 0x18;
+	expected_hdr.width = 0x191A;
+	expected_hdr.temporal_levels = 0x0;
+	expected_hdr.temporal_wavelet = 0x1;
+	expected_hdr.temporal_index = 0xB;
+	expected_hdr.near_lossless_delta = 0x1C;
+	expected_hdr.n_bits = 0x1D;
+	expected_hdr.packet_size = 0x1E1F;
 	for (i = 0; i < CMP_HDR_SIZE; i++)
 		buf[i] = (uint8_t)i;
 
@@ -122,6 +147,14 @@ void test_deserialize_compression_header(void)
 	TEST_ASSERT_EQUAL_HEX(expected_hdr.encoder_outlier, hdr.encoder_outlier);
 	TEST_ASSERT_EQUAL_HEX(expected_hdr.original_dtype, hdr.original_dtype);
 	TEST_ASSERT_EQUAL_HEX(expected_hdr.preprocess_param, hdr.preprocess_param);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.encoder_flags, hdr.encoder_flags);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.width, hdr.width);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.temporal_levels, hdr.temporal_levels);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.temporal_wavelet, hdr.temporal_wavelet);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.temporal_index, hdr.temporal_index);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.near_lossless_delta, hdr.near_lossless_delta);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.n_bits, hdr.n_bits);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.packet_size, hdr.packet_size);
 }
 
 void test_deserialize_compression_header_with_maximum_values(void)
@@ -131,7 +164,7 @@ void test_deserialize_compression_header_with_maximum_values(void)
 	struct cmp_hdr expected_hdr;
 	uint32_t hdr_size;
 
-	expected_hdr.version = MAX_VALUE(CMP_HDR_BITS_VERSION);
+	expected_hdr.version = CMP_HDR_MAX_VERSION;
 	expected_hdr.compressed_size = MAX_VALUE(CMP_HDR_BITS_COMPRESSED_SIZE);
 	expected_hdr.original_size = MAX_VALUE(CMP_HDR_BITS_ORIGINAL_SIZE);
 	expected_hdr.checksum = MAX_VALUE(CMP_HDR_BITS_CHECKSUM);
@@ -143,7 +176,16 @@ void test_deserialize_compression_header_with_maximum_values(void)
 	expected_hdr.encoder_outlier = MAX_VALUE(CMP_HDR_BITS_ENCODER_OUTLIER);
 	expected_hdr.original_dtype = MAX_VALUE(CMP_HDR_BITS_ORIGINAL_DTYPE);
 	expected_hdr.preprocess_param = MAX_VALUE(CMP_HDR_BITS_PREPROCESS_PARAM);
+	expected_hdr.encoder_flags = MAX_VALUE(CMP_HDR_BITS_ENCODER_FLAGS);
+	expected_hdr.width = MAX_VALUE(CMP_HDR_BITS_WIDTH);
+	expected_hdr.temporal_levels = MAX_VALUE(CMP_HDR_BITS_TEMPORAL_LEVELS);
+	expected_hdr.temporal_wavelet = MAX_VALUE(CMP_HDR_BITS_TEMPORAL_WAVELET);
+	expected_hdr.temporal_index = MAX_VALUE(CMP_HDR_BITS_TEMPORAL_INDEX);
+	expected_hdr.near_lossless_delta = MAX_VALUE(CMP_HDR_BITS_NL_DELTA);
+	expected_hdr.n_bits = MAX_VALUE(CMP_HDR_BITS_N_BITS);
+	expected_hdr.packet_size = MAX_VALUE(CMP_HDR_BITS_PACKET_SIZE);
 	memset(buf, 0xFF, sizeof(buf));
+	buf[0] = 0x7F; /* a set MSB marks a compact header */
 
 	hdr_size = cmp_hdr_deserialize(buf, sizeof(buf), &hdr);
 
@@ -161,6 +203,14 @@ void test_deserialize_compression_header_with_maximum_values(void)
 	TEST_ASSERT_EQUAL_HEX(expected_hdr.encoder_outlier, hdr.encoder_outlier);
 	TEST_ASSERT_EQUAL_HEX(expected_hdr.original_dtype, hdr.original_dtype);
 	TEST_ASSERT_EQUAL_HEX(expected_hdr.preprocess_param, hdr.preprocess_param);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.encoder_flags, hdr.encoder_flags);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.width, hdr.width);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.temporal_levels, hdr.temporal_levels);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.temporal_wavelet, hdr.temporal_wavelet);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.temporal_index, hdr.temporal_index);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.near_lossless_delta, hdr.near_lossless_delta);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.n_bits, hdr.n_bits);
+	TEST_ASSERT_EQUAL_HEX(expected_hdr.packet_size, hdr.packet_size);
 }
 
 
@@ -185,7 +235,7 @@ void test_hdr_serialize_detects_when_a_field_is_too_big(void)
 		TEST_ASSERT_CMP_SUCCESS(hdr_size);                                     \
 	} while (0)
 
-	/* TEST_HDR_FIELD_TOO_BIG(version, CMP_HDR_BITS_VERSION, CMP_ERR_NO_ERROR); */
+	TEST_HDR_FIELD_TOO_BIG(version, CMP_HDR_BITS_VERSION - 1, CMP_ERR_INT_HDR);
 	TEST_HDR_FIELD_TOO_BIG(compressed_size, CMP_HDR_BITS_COMPRESSED_SIZE,
 			       CMP_ERR_HDR_CMP_SIZE_TOO_LARGE);
 	TEST_HDR_FIELD_TOO_BIG(original_size, CMP_HDR_BITS_ORIGINAL_SIZE,
@@ -203,10 +253,170 @@ void test_hdr_serialize_detects_when_a_field_is_too_big(void)
 			       CMP_ERR_INT_BITSTREAM);
 	TEST_HDR_FIELD_TOO_BIG(original_dtype, CMP_HDR_BITS_ORIGINAL_DTYPE, CMP_ERR_INT_BITSTREAM);
 	TEST_HDR_FIELD_TOO_BIG(preprocess_param, CMP_HDR_BITS_PREPROCESS_PARAM, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(encoder_flags, CMP_HDR_BITS_ENCODER_FLAGS, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(width, CMP_HDR_BITS_WIDTH, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(temporal_levels, CMP_HDR_BITS_TEMPORAL_LEVELS,
+			       CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(temporal_wavelet, CMP_HDR_BITS_TEMPORAL_WAVELET,
+			       CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(temporal_index, CMP_HDR_BITS_TEMPORAL_INDEX, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(near_lossless_delta, CMP_HDR_BITS_NL_DELTA, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(n_bits, CMP_HDR_BITS_N_BITS, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(packet_size, CMP_HDR_BITS_PACKET_SIZE, CMP_ERR_INT_BITSTREAM);
 #undef TEST_HDR_FIELD_TOO_BIG
 }
 
 
+void test_compact_header_holds_only_the_frame_dependent_fields(void)
+{
+	DST_ALIGNED_U8 buf[CMP_HDR_SIZE];
+	const uint8_t expected[] = { 0xC5, 0x12, 0x82, 0x2C, 0xA4, 0x34, 0xDE, 0xAD, 0xBE, 0xEF };
+	struct cmp_hdr hdr = { 0 };
+	struct cmp_hdr seq_hdr = { 0 };
+	uint32_t hdr_size;
+	struct bitstream_writer bs;
+
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bs, buf, sizeof(buf)));
+	hdr.compressed_size = 300;
+	hdr.original_size = 0x1234;
+	hdr.checksum = 0xDEADBEEF;
+	hdr.sequence_number = 0x12;
+	hdr.temporal_index = 5;
+	hdr.encoder_param = 3;
+
+	hdr_size = cmp_hdr_serialize_compact(&bs, &hdr, 1000);
+
+	TEST_ASSERT_EQUAL(sizeof(expected), hdr_size);
+	TEST_ASSERT_EQUAL(hdr_size, cmp_hdr_compact_size(&hdr, 1000));
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buf, sizeof(expected));
+
+	/* the other fields are taken from the last full header */
+	seq_hdr.encoder_param = 7;
+	seq_hdr.identifier = 0x0C0D0E0F;
+	hdr_size = cmp_hdr_deserialize(buf, sizeof(expected), &seq_hdr);
+
+	TEST_ASSERT_EQUAL(sizeof(expected), hdr_size);
+	TEST_ASSERT_EQUAL(300, seq_hdr.compressed_size);
+	TEST_ASSERT_EQUAL_HEX(0x1234, seq_hdr.original_size);
+	TEST_ASSERT_EQUAL_HEX(0xDEADBEEF, seq_hdr.checksum);
+	TEST_ASSERT_EQUAL_HEX(0x12, seq_hdr.sequence_number);
+	TEST_ASSERT_EQUAL(5, seq_hdr.temporal_index);
+	TEST_ASSERT_EQUAL(7, seq_hdr.encoder_param);
+	TEST_ASSERT_EQUAL_HEX(0x0C0D0E0F, seq_hdr.identifier);
+
+	/* without checksum */
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bs, buf, sizeof(buf)));
+	hdr.checksum = 0;
+	hdr_size = cmp_hdr_serialize_compact(&bs, &hdr, 1000);
+	TEST_ASSERT_EQUAL(sizeof(expected) - 4, hdr_size);
+	TEST_ASSERT_EQUAL_HEX8(0x85, buf[0]);
+	TEST_ASSERT_EQUAL(hdr_size, cmp_hdr_deserialize(buf, hdr_size, &seq_hdr));
+	TEST_ASSERT_EQUAL(0, seq_hdr.checksum);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_INT_HDR, cmp_hdr_deserialize(buf, hdr_size - 1, &seq_hdr));
+}
+
+
+void test_compressed_size_is_patched_in_place(void)
+{
+	DST_ALIGNED_U8 buf[CMP_HDR_SIZE];
+	struct cmp_hdr hdr = { 0 };
+	uint32_t hdr_size;
+	struct bitstream_writer bs;
+
+	/* compact header with a place holder as wide as the size limit */
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bs, buf, sizeof(buf)));
+	hdr.original_size = 100;
+	hdr_size = cmp_hdr_serialize_compact(&bs, &hdr, 20000);
+	TEST_ASSERT_EQUAL(6, hdr_size);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_patch_compressed_size(buf, hdr_size, 300));
+
+	TEST_ASSERT_EQUAL(hdr_size, cmp_hdr_deserialize(buf, hdr_size, &hdr));
+	TEST_ASSERT_EQUAL(300, hdr.compressed_size);
+	TEST_ASSERT_EQUAL(100, hdr.original_size);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_CMP_SIZE_TOO_LARGE,
+				    cmp_hdr_patch_compressed_size(buf, hdr_size, 1UL << 21));
+
+	/* full header */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.version = 1;
+	hdr.original_size = 100;
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bs, buf, sizeof(buf)));
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE, cmp_hdr_serialize(&bs, &hdr));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_patch_compressed_size(buf, sizeof(buf), 0x020304));
+
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE, cmp_hdr_deserialize(buf, sizeof(buf), &hdr));
+	TEST_ASSERT_EQUAL_HEX(0x020304, hdr.compressed_size);
+	TEST_ASSERT_EQUAL(100, hdr.original_size);
+}
+
+
+void test_chunk_index_round_trip(void)
+{
+	const struct cmp_chunk_entry entries[3] = {
+		{ 0x01020304, 0x00400000 }, { 0x12, 0x34 }, { 0xFFFFFF, 0 }
+	};
+	struct cmp_chunk_entry read[3];
+	uint8_t buf[CMP_CHUNK_INDEX_SIZE(3) + 5];
+	uint8_t *index = buf + 5; /* the index follows the frames unaligned */
+	const uint8_t expected_trailer[CMP_CHUNK_TRAILER_SIZE] = { 0x00, 0x00, 0x00, 0x03,
+								   'A',  'I',  'R',  'C' };
+
+	TEST_ASSERT_EQUAL(CMP_CHUNK_INDEX_SIZE(3),
+			  cmp_chunk_index_serialize(index, CMP_CHUNK_INDEX_SIZE(3), entries, 3));
+	TEST_ASSERT_EQUAL_HEX8(0x01, index[0]);
+	TEST_ASSERT_EQUAL_HEX8(0x04, index[3]);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_trailer, index + 3 * CMP_CHUNK_ENTRY_SIZE,
+				     CMP_CHUNK_TRAILER_SIZE);
+
+	TEST_ASSERT_EQUAL(3, cmp_chunk_index_deserialize(buf, sizeof(buf), NULL, 0));
+	TEST_ASSERT_EQUAL(3, cmp_chunk_index_deserialize(buf, sizeof(buf), read, 3));
+	TEST_ASSERT_EQUAL_MEMORY(entries, read, sizeof(entries));
+
+	TEST_ASSERT_EQUAL(CMP_CHUNK_TRAILER_SIZE,
+			  cmp_chunk_index_serialize(buf, CMP_CHUNK_TRAILER_SIZE, NULL, 0));
+	TEST_ASSERT_EQUAL(0, cmp_chunk_index_deserialize(buf, CMP_CHUNK_TRAILER_SIZE, read, 0));
+}
+
+
+void test_detect_invalid_chunk_index(void)
+{
+	const struct cmp_chunk_entry entries[2] = { { 10, 20 }, { 30, 40 } };
+	struct cmp_chunk_entry read[2];
+	uint8_t buf[CMP_CHUNK_INDEX_SIZE(2)];
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_chunk_index_serialize(buf, sizeof(buf) - 1, entries, 2));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_chunk_index_serialize(buf, 4, entries, 0));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_NULL,
+				    cmp_chunk_index_serialize(NULL, sizeof(buf), entries, 2));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_NULL,
+				    cmp_chunk_index_serialize(buf, sizeof(buf), NULL, 2));
+	TEST_ASSERT_EQUAL(sizeof(buf), cmp_chunk_index_serialize(buf, sizeof(buf), entries, 2));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_chunk_index_deserialize(buf, sizeof(buf), read, 1));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_NULL,
+				    cmp_chunk_index_deserialize(NULL, sizeof(buf), read, 2));
+	/* the index is cut off */
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_CHUNK_INDEX,
+				    cmp_chunk_index_deserialize(buf + 1, sizeof(buf) - 1, read, 2));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_CHUNK_INDEX,
+				    cmp_chunk_index_deserialize(buf, CMP_CHUNK_TRAILER_SIZE - 1, read, 2));
+	/* corrupted magic */
+	buf[sizeof(buf) - 1] ^= 0x01;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_CHUNK_INDEX,
+				    cmp_chunk_index_deserialize(buf, sizeof(buf), read, 2));
+	/* corrupted number of chunks */
+	buf[sizeof(buf) - 1] ^= 0x01;
+	buf[sizeof(buf) - 5] = 3;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_CHUNK_INDEX,
+				    cmp_chunk_index_deserialize(buf, sizeof(buf), read, 2));
+}
+
+
 void test_detect_null_hdr_during_serialize(void)
 {
 	DST_ALIGNED_U8 buf[CMP_HDR_SIZE];
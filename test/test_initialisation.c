@@ -236,6 +236,42 @@ void test_detect_invalid_primary_golomb_encoder_parameter(void)
 }
 
 
+void test_accept_auto_golomb_encoder_parameter(void)
+{
+	struct cmp_params par = { 0 };
+	struct cmp_context ctx;
+
+	par.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	par.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	par.secondary_iterations = 1;
+	par.secondary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	par.secondary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	par.secondary_encoder_outlier = 1;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &par, NULL, 0));
+
+	/* the outlier is still checked */
+	par.secondary_encoder_outlier = 0;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, cmp_initialise(&ctx, &par, NULL, 0));
+}
+
+
+TEST_MATRIX([CMP_ENCODER_UNCOMPRESSED, CMP_ENCODER_GOLOMB_ZERO, CMP_ENCODER_GOLOMB_MULTI,
+	     CMP_ENCODER_BLOCK_RICE, CMP_ENCODER_ADAPTIVE_RICE, CMP_ENCODER_PFOR,
+	     CMP_ENCODER_RANS, CMP_ENCODER_EXP_GOLOMB])
+void test_accept_auto_encoder_parameter_for_every_encoder(enum cmp_encoder_type encoder_type)
+{
+	struct cmp_params par = { 0 };
+	struct cmp_context ctx;
+
+	par.primary_encoder_type = encoder_type;
+	par.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	par.primary_encoder_outlier = 16;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &par, NULL, 0));
+}
+
+
 void test_ignore_invalid_primary_golomb_encoder_parameter_when_not_used(void)
 {
 	const uint16_t src[2] = { 0x0001, 0x0203 };
@@ -326,6 +362,185 @@ void test_ignore_invalid_secondary_golomb_encoder_parameter_when_not_used(void)
 }
 
 
+void test_detects_invalid_frame_width(void)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = CMP_PREPROCESS_MED;
+	params.width = CMP_HDR_MAX_WIDTH + 1;
+
+	return_value = cmp_initialise(&ctx, &params, NULL, 0);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+void test_detects_invalid_wavelet(void)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[4];
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.wavelet = CMP_WAVELET_9_7_M + 1;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+void test_detects_invalid_fixed_predictor_order(void)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[4];
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = CMP_PREPROCESS_FIXED;
+	params.fixed_order = CMP_FIXED_ORDER_MAX + 1;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+TEST_MATRIX([CMP_PREPROCESS_IWT, CMP_PREPROCESS_MED, CMP_PREPROCESS_FIXED])
+void test_detects_near_lossless_delta_with_unsupported_preprocessing(
+	enum cmp_preprocessing preprocessing)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[32];
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = preprocessing;
+	params.near_lossless_delta = 1;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+void test_detects_too_large_near_lossless_delta(void)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[32];
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.near_lossless_delta = CMP_HDR_MAX_NL_DELTA + 1;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+void test_detects_too_large_n_bits(void)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+
+	params.n_bits = 17;
+
+	return_value = cmp_initialise(&ctx, &params, NULL, 0);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+TEST_MATRIX([CMP_PREPROCESS_IWT, CMP_PREPROCESS_IWT_2D])
+void test_detects_reduced_n_bits_with_transform(enum cmp_preprocessing preprocessing)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[32];
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = preprocessing;
+	params.n_bits = 14;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+TEST_MATRIX([14, 65536])
+void test_detects_invalid_packet_size(uint32_t packet_size)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.packet_size = packet_size;
+
+	return_value = cmp_initialise(&ctx, &params, NULL, 0);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+TEST_MATRIX([CMP_PREPROCESS_IWT, CMP_PREPROCESS_MODEL, CMP_PREPROCESS_MED])
+void test_detects_packets_with_stateful_preprocessing(enum cmp_preprocessing preprocessing)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[32];
+	struct cmp_params params = { 0 };
+
+	params.secondary_iterations = 1;
+	params.secondary_preprocessing = preprocessing;
+	params.packet_size = 64;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+TEST_MATRIX([1, 3, 16])
+void test_detects_invalid_temporal_group_size(uint32_t temporal_group_size)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[32];
+	struct cmp_params params = { 0 };
+
+	params.temporal_group_size = temporal_group_size;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
+void test_detects_temporal_decomposition_with_model(void)
+{
+	uint32_t return_value;
+	struct cmp_context ctx;
+	uint16_t work_buf[32];
+	struct cmp_params params = { 0 };
+
+	params.temporal_group_size = 2;
+	params.secondary_iterations = 1;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+
+	return_value = cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, return_value);
+}
+
+
 void test_detects_invalid_model_rate(void)
 {
 	uint32_t return_value;
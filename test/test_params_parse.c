@@ -41,6 +41,9 @@ void test_parse_preprocess_enums(void)
 		{ "DIFF",                CMP_PREPROCESS_DIFF  },
 		{ "IWT",                 CMP_PREPROCESS_IWT   },
 		{ "MODEL",               CMP_PREPROCESS_MODEL },
+		{ "MED",                 CMP_PREPROCESS_MED   },
+		{ "IWT_2D",              CMP_PREPROCESS_IWT_2D },
+		{ "FIXED",               CMP_PREPROCESS_FIXED },
 		{ "DiFf",                CMP_PREPROCESS_DIFF  },
 		{ "PREPROCESS_DIFF",     CMP_PREPROCESS_DIFF  },
 		{ "CMP_PREPROCESS_DIFF", CMP_PREPROCESS_DIFF  },
@@ -90,6 +93,11 @@ void test_parse_encoder_types_enums(void)
 		{ "UNCOMPRESSED",             CMP_ENCODER_UNCOMPRESSED },
 		{ "GOLOMB_ZERO",              CMP_ENCODER_GOLOMB_ZERO  },
 		{ "GOLOMB_MULTI",             CMP_ENCODER_GOLOMB_MULTI },
+		{ "BLOCK_RICE",               CMP_ENCODER_BLOCK_RICE   },
+		{ "ADAPTIVE_RICE",            CMP_ENCODER_ADAPTIVE_RICE },
+		{ "PFOR",                     CMP_ENCODER_PFOR         },
+		{ "RANS",                     CMP_ENCODER_RANS         },
+		{ "EXP_GOLOMB",               CMP_ENCODER_EXP_GOLOMB   },
 		{ "ENCODER_UNCOMPRESSED",     CMP_ENCODER_UNCOMPRESSED },
 		{ "CMP_ENCODER_UNCOMPRESSED", CMP_ENCODER_UNCOMPRESSED },
 		{ "CMP_UNCOMPRESSED",         CMP_ENCODER_UNCOMPRESSED },
@@ -213,6 +221,28 @@ void test_parse_maximum_numeric_value(void)
 }
 
 
+void test_parse_encoder_param_auto(void)
+{
+	struct arena *a = create_test_arena();
+	enum cmp_parse_status status;
+	struct cmp_params par = { 0 };
+	struct cmp_params par_exp = { 0 };
+	const char *str;
+
+	par_exp.primary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+	par_exp.secondary_encoder_param = CMP_ENCODER_PARAM_AUTO;
+
+	status = cmp_params_parse(
+		"primary_encoder_param=AUTO, secondary_encoder_param=cmp_encoder_param_auto", &par);
+
+	TEST_ASSERT_EQUAL(CMP_PARSE_OK, status);
+	TEST_ASSERT_EQUAL_MEMORY(&par_exp, &par, sizeof(par_exp));
+	str = cmp_params_to_string(a, &par);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "primary_encoder_param = AUTO,"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "secondary_encoder_param = AUTO,"), str);
+}
+
+
 void test_use_last_if_same_key_twice(void)
 {
 	enum cmp_parse_status status;
@@ -291,9 +321,20 @@ void test_parse_all_compression_parameters(void)
 		"secondary_encoder_param = 42,"
 		"secondary_encoder_outlier = 1,"
 		"model_rate = 16,"
+		"wavelet = CMP_WAVELET_9_7_M,"
+		"fixed_order = AUTO,"
+		"near_lossless_delta = 2,"
+		"n_bits = 14,"
+		"width = 640,"
+		"temporal_group_size = 4,"
+		"temporal_wavelet = HAAR,"
+		"packet_size = 1024,"
 
 		"checksum_enabled = FALSE,"
 		"uncompressed_fallback_enabled = TRUE,"
+		"zero_run_enabled = TRUE,"
+		"four_streams_enabled = TRUE,"
+		"compact_header_enabled = TRUE,"
 	};
 
 	par_exp.primary_preprocessing = CMP_PREPROCESS_IWT;
@@ -307,9 +348,20 @@ void test_parse_all_compression_parameters(void)
 	par_exp.secondary_encoder_param = 42;
 	par_exp.secondary_encoder_outlier = 1;
 	par_exp.model_rate = 16;
+	par_exp.wavelet = CMP_WAVELET_9_7_M;
+	par_exp.fixed_order = CMP_FIXED_ORDER_AUTO;
+	par_exp.near_lossless_delta = 2;
+	par_exp.n_bits = 14;
+	par_exp.width = 640;
+	par_exp.temporal_group_size = 4;
+	par_exp.temporal_wavelet = CMP_WAVELET_HAAR;
+	par_exp.packet_size = 1024;
 
 	par_exp.checksum_enabled = 0;
 	par_exp.uncompressed_fallback_enabled = 1;
+	par_exp.zero_run_enabled = 1;
+	par_exp.four_streams_enabled = 1;
+	par_exp.compact_header_enabled = 1;
 
 	/* act */
 	status = cmp_params_parse(str, &par);
@@ -442,6 +494,7 @@ void test_stringify_all_parameters(void)
 	par.secondary_encoder_param = 42;
 	par.secondary_encoder_outlier = 1;
 	par.model_rate = 16;
+	par.wavelet = CMP_WAVELET_HAAR;
 
 	par.checksum_enabled = 0;
 	par.uncompressed_fallback_enabled = 1;
@@ -461,9 +514,13 @@ void test_stringify_all_parameters(void)
 	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "secondary_encoder_param = 42,"), str);
 	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "secondary_encoder_outlier = 1,"), str);
 	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "model_rate = 16,"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "wavelet = HAAR,"), str);
 
 	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "checksum_enabled = FALSE,"), str);
-	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "uncompressed_fallback_enabled = TRUE\n"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "uncompressed_fallback_enabled = TRUE,"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "zero_run_enabled = FALSE,"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "four_streams_enabled = FALSE,"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "compact_header_enabled = FALSE\n"), str);
 	/* no ',' on last line*/
 }
 
@@ -520,8 +577,16 @@ void test_to_string_parse_roundtrip(void)
 	a.secondary_encoder_param = 42;
 	a.secondary_encoder_outlier = 1;
 	a.model_rate = 16;
+	a.wavelet = CMP_WAVELET_2_6;
+	a.fixed_order = 2;
+	a.near_lossless_delta = 1;
+	a.n_bits = 12;
+	a.temporal_group_size = 8;
+	a.temporal_wavelet = CMP_WAVELET_5_3;
+	a.packet_size = 256;
 	a.checksum_enabled = 0;
 	a.uncompressed_fallback_enabled = 1;
+	a.compact_header_enabled = 1;
 
 	str = cmp_params_to_string(arena, &a);
 	status = cmp_params_parse(str, &b);
@@ -71,6 +71,73 @@ void test_diff_preprocessing_for_multiple_values(const struct cmp_test_fixture *
 }
 
 
+#define MED_PREPROC_SRC_VALUES 1, 3, 0, 7, 5, 4, 6, 1
+const uint16_t test_med_u16[8] = { MED_PREPROC_SRC_VALUES };
+const int16_t test_med_i16[8] = { MED_PREPROC_SRC_VALUES };
+const int32_t test_med_i16_in_i32[8] = { MED_PREPROC_SRC_VALUES };
+
+TEST_CASE(&cmp_fixture_u16, ARRAY_AND_SIZE(test_med_u16))
+TEST_CASE(&cmp_fixture_i16, ARRAY_AND_SIZE(test_med_i16))
+TEST_CASE(&cmp_fixture_i16_in_i32, ARRAY_AND_SIZE(test_med_i16_in_i32))
+
+void test_med_preprocessing_of_a_2d_frame(const struct cmp_test_fixture *fix, const void *src,
+					  uint32_t src_size)
+{
+	/*
+	 * 1 3 0    1  2 -3   first row: difference to the left neighbour
+	 * 7 5 4 -> 6 -2  2   first column: difference to the upper neighbour
+	 * 6 1      -1 -4
+	 */
+	const int16_t expected_med[ARRAY_SIZE(test_med_u16)] = { 1, 2, -3, 6, -2, 2, -1, -4 };
+	DST_ALIGNED_U8 output_buf[CMP_UNCOMPRESSED_BOUND(sizeof(expected_med))];
+	uint32_t output_size;
+	struct cmp_context ctx;
+	struct cmp_hdr expected_hdr = { 0 };
+	struct cmp_params params = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_MED;
+	params.width = 3;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	output_size = fix->compress(&ctx, output_buf, sizeof(output_buf), src, src_size);
+
+	TEST_ASSERT_CMP_SUCCESS(output_size);
+	assert_preprocessing_data(expected_med, ARRAY_SIZE(expected_med), output_buf);
+	expected_hdr.compressed_size = output_size;
+	expected_hdr.original_size = sizeof(test_med_u16);
+	expected_hdr.original_dtype = fix->dtype;
+	expected_hdr.encoder_type = params.primary_encoder_type;
+	expected_hdr.preprocessing = params.primary_preprocessing;
+	expected_hdr.width = params.width;
+	TEST_ASSERT_CMP_HDR(output_buf, output_size, expected_hdr);
+}
+
+
+void test_med_preprocessing_compares_u16_samples_unsigned(void)
+{
+	/*
+	 * 0x7FFF 0x8001    32767  2   up-left <= min(left, up) predicts
+	 * 0x8000 0x8002 ->     1  1   max(left, up) = 0x8001
+	 */
+	const uint16_t src[4] = { 0x7FFF, 0x8001, 0x8000, 0x8002 };
+	const int16_t expected_med[ARRAY_SIZE(src)] = { INT16_MAX, 2, 1, 1 };
+	DST_ALIGNED_U8 output_buf[CMP_UNCOMPRESSED_BOUND(sizeof(expected_med))];
+	uint32_t output_size;
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_MED;
+	params.width = 2;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	output_size = cmp_compress_u16(&ctx, output_buf, sizeof(output_buf), src, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(output_size);
+	assert_preprocessing_data(expected_med, ARRAY_SIZE(expected_med), output_buf);
+}
+
 const int16_t g_iwt_input_1[] = { 42 };
 const int32_t g_iwt_input_1_i32[] = { 42 };
 const int16_t g_iwt_exp_out_1[] = { 42 };
@@ -144,6 +211,180 @@ void test_iwt_transform(const struct cmp_test_fixture *fix, const void *input, u
 }
 
 
+const int16_t g_haar_exp_out_8[8] = { 1, 5, 2, 4, 2, 7, 2, 7 };
+const int16_t g_ts_exp_out_8[8] = { 1, 4, 1, 3, 2, 6, 1, 6 };
+const int16_t g_iwt97m_exp_out_8[8] = { 0, 4, 2, 4, 1, 6, 3, 7 };
+
+TEST_CASE(CMP_WAVELET_5_3, g_iwt_exp_out_8)
+TEST_CASE(CMP_WAVELET_HAAR, g_haar_exp_out_8)
+TEST_CASE(CMP_WAVELET_2_6, g_ts_exp_out_8)
+TEST_CASE(CMP_WAVELET_9_7_M, g_iwt97m_exp_out_8)
+
+void test_iwt_with_selected_wavelet_kernel(enum cmp_wavelet wavelet, const int16_t *exp_output)
+{
+	uint32_t dst_size;
+	struct test_env *e;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr expected_hdr = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.wavelet = wavelet;
+	e = make_env(&params, sizeof(g_iwt_input_8));
+
+	dst_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, g_iwt_input_8,
+				    sizeof(g_iwt_input_8));
+
+	TEST_ASSERT_CMP_SUCCESS(dst_size);
+	assert_preprocessing_data(exp_output, ARRAY_SIZE(g_iwt_input_8), e->dst);
+	expected_hdr.compressed_size = dst_size;
+	expected_hdr.original_size = sizeof(g_iwt_input_8);
+	expected_hdr.original_dtype = CMP_I16;
+	expected_hdr.encoder_type = params.primary_encoder_type;
+	expected_hdr.preprocessing = params.primary_preprocessing;
+	expected_hdr.preprocess_param = wavelet;
+	TEST_ASSERT_CMP_HDR(e->dst, dst_size, expected_hdr);
+
+	free_env(e);
+}
+
+
+const int16_t g_fixed_input[8] = { 1, 4, 9, 16, 25, 36, 49, 64 };
+const int16_t g_fixed_exp_out_1[8] = { 1, 3, 5, 7, 9, 11, 13, 15 };
+const int16_t g_fixed_exp_out_2[8] = { 1, 3, 2, 2, 2, 2, 2, 2 };
+const int16_t g_fixed_exp_out_3[8] = { 1, 3, 2, 0, 0, 0, 0, 0 };
+
+TEST_CASE(0, g_fixed_input, 0)
+TEST_CASE(1, g_fixed_exp_out_1, 1)
+TEST_CASE(2, g_fixed_exp_out_2, 2)
+TEST_CASE(3, g_fixed_exp_out_3, 3)
+TEST_CASE(CMP_FIXED_ORDER_AUTO, g_fixed_exp_out_3, 3)
+
+void test_fixed_predictor_preprocessing(uint32_t order, const int16_t *exp_output,
+					uint32_t exp_order)
+{
+	uint32_t dst_size;
+	struct test_env *e;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr expected_hdr = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_FIXED;
+	params.fixed_order = order;
+	e = make_env(&params, sizeof(g_fixed_input));
+
+	dst_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, g_fixed_input,
+				    sizeof(g_fixed_input));
+
+	TEST_ASSERT_CMP_SUCCESS(dst_size);
+	assert_preprocessing_data(exp_output, ARRAY_SIZE(g_fixed_input), e->dst);
+	expected_hdr.compressed_size = dst_size;
+	expected_hdr.original_size = sizeof(g_fixed_input);
+	expected_hdr.original_dtype = CMP_I16;
+	expected_hdr.encoder_type = params.primary_encoder_type;
+	expected_hdr.preprocessing = params.primary_preprocessing;
+	expected_hdr.preprocess_param = exp_order;
+	TEST_ASSERT_CMP_HDR(e->dst, dst_size, expected_hdr);
+
+	free_env(e);
+}
+
+
+#define IWT_2D_SRC_VALUES -3, 2, -1, 3, -2, 5, 0
+const int16_t test_iwt_2d_i16[7] = { IWT_2D_SRC_VALUES };
+const int32_t test_iwt_2d_i16_in_i32[7] = { IWT_2D_SRC_VALUES };
+
+TEST_CASE(&cmp_fixture_u16, ARRAY_AND_SIZE(test_iwt_2d_i16))
+TEST_CASE(&cmp_fixture_i16, ARRAY_AND_SIZE(test_iwt_2d_i16))
+TEST_CASE(&cmp_fixture_i16_in_i32, ARRAY_AND_SIZE(test_iwt_2d_i16_in_i32))
+
+void test_iwt_2d_transform_of_rows_and_columns(const struct cmp_test_fixture *fix,
+					       const void *input, uint32_t input_size)
+{
+	/*
+	 * -3  2 -1    rows     0  4  2    columns   0  -1  2
+	 *  3 -2  5    ---->    1 -6  2    ------>   1 -10  0
+	 *  0                   0                    0
+	 */
+	const int16_t exp_output[ARRAY_SIZE(test_iwt_2d_i16)] = { 0, -1, 2, 1, -10, 0, 0 };
+	uint32_t dst_size;
+	struct test_env *e;
+	struct cmp_params params = { 0 };
+	struct cmp_hdr expected_hdr = { 0 };
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_IWT_2D;
+	params.width = 3;
+	e = make_env(&params, sizeof(exp_output));
+
+	dst_size = fix->compress(&e->ctx, e->dst, e->dst_cap, input, input_size);
+
+	TEST_ASSERT_CMP_SUCCESS(dst_size);
+	TEST_ASSERT_EQUAL(CMP_UNCOMPRESSED_BOUND(sizeof(exp_output)), dst_size);
+	assert_preprocessing_data(exp_output, ARRAY_SIZE(exp_output), e->dst);
+	expected_hdr.compressed_size = dst_size;
+	expected_hdr.original_size = sizeof(exp_output);
+	expected_hdr.original_dtype = fix->dtype;
+	expected_hdr.encoder_type = params.primary_encoder_type;
+	expected_hdr.preprocessing = params.primary_preprocessing;
+	expected_hdr.width = params.width;
+	TEST_ASSERT_CMP_HDR(e->dst, dst_size, expected_hdr);
+
+	free_env(e);
+}
+
+
+static int16_t read_preprocessed_sample(const void *compressed_data, uint32_t i)
+{
+	const uint8_t *p = cmp_hdr_get_cmp_data(compressed_data);
+
+	return (int16_t)(p[i * 2] << 8 | p[i * 2 + 1]);
+}
+
+
+TEST_MATRIX([CMP_WAVELET_5_3, CMP_WAVELET_HAAR, CMP_WAVELET_2_6, CMP_WAVELET_9_7_M])
+void test_iwt_2d_columns_wider_than_a_tile(enum cmp_wavelet wavelet)
+{
+	/*
+	 * Every column is constant, so the column transform keeps the
+	 * transformed first row and zeros everything below it. A frame wider
+	 * than one tile of columns checks that no tile mixes up its columns.
+	 */
+	enum { WIDTH = 40, HEIGHT = 4 };
+	int16_t row[WIDTH];
+	int16_t frame[WIDTH * HEIGHT];
+	uint32_t i, dst_size;
+	struct test_env *row_env, *e;
+	struct cmp_params params = { 0 };
+
+	for (i = 0; i < WIDTH; i++)
+		row[i] = (int16_t)((i * i * 7) % 101 - 50);
+	for (i = 0; i < WIDTH * HEIGHT; i++)
+		frame[i] = row[i % WIDTH];
+
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.wavelet = wavelet;
+	row_env = make_env(&params, sizeof(row));
+	params.primary_preprocessing = CMP_PREPROCESS_IWT_2D;
+	params.width = WIDTH;
+	e = make_env(&params, sizeof(frame));
+
+	TEST_ASSERT_CMP_SUCCESS(
+		cmp_compress_i16(&row_env->ctx, row_env->dst, row_env->dst_cap, row, sizeof(row)));
+	dst_size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, frame, sizeof(frame));
+
+	TEST_ASSERT_CMP_SUCCESS(dst_size);
+	for (i = 0; i < WIDTH; i++)
+		TEST_ASSERT_EQUAL_INT16(read_preprocessed_sample(row_env->dst, i),
+					read_preprocessed_sample(e->dst, i));
+	for (; i < WIDTH * HEIGHT; i++)
+		TEST_ASSERT_EQUAL_INT16(0, read_preprocessed_sample(e->dst, i));
+
+	free_env(row_env);
+	free_env(e);
+}
+
 TEST_MATRIX([&cmp_fixture_u16, &cmp_fixture_i16])
 void test_model_preprocessing_for_multiple_values(const struct cmp_test_fixture *fix)
 {